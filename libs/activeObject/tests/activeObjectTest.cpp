@@ -580,8 +580,13 @@ TEST_CLASS_EX (ActiveObjectTest, LibletAwareMemLeakDetection)
     // Do not call Finalize if not initialized
     TestContext context{Ctor::NotInQueue | Initialize::NotCalled | Finalize::NotCalled | Dtor::NotInQueue};
 
+    // Block the queue to make sure that it is shutdown before the Initialize has a chance to run.
+    Mso::ManualResetEvent queueBlocker;
+    context.Queue().Post([queueBlocker]() noexcept { queueBlocker.Wait(); });
+
     auto obj = Mso::Make<TestObjectWithInitializeAndFinalize>(context);
     context.ShutdownQueue();
+    queueBlocker.Set();
 
     context.WaitSync();
   }
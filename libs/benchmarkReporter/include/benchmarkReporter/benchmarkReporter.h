@@ -0,0 +1,117 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace Mso {
+
+//! Output format of the benchmark results.
+enum class BenchmarkFormat
+{
+  Text, //!< Human readable lines printed as soon as each benchmark completes.
+  Json, //!< JSON document with the run context and an array of results.
+  Csv, //!< CSV table with a header line.
+};
+
+//! Command line options of a benchmark executable.
+struct BenchmarkOptions
+{
+  BenchmarkFormat Format{BenchmarkFormat::Text};
+  std::string OutputPath; //!< Write results to this file instead of stdout.
+  std::string Filter; //!< Run only benchmarks which "name/variant" contains this substring.
+  uint32_t RunCount{3}; //!< The best time of the runs is reported.
+  bool IsQuick{false}; //!< Run ten times fewer operations to smoke test the benchmarks.
+};
+
+//! Parses the command line options:
+//! [--format=text|json|csv] [--output=<path>] [--filter=<substring>] [--runs=<count>] [--quick]
+//! Prints the usage to stderr and returns false if an option is unknown.
+bool TryParseBenchmarkOptions(int argc, char** argv, /*out*/ BenchmarkOptions& options) noexcept;
+
+//! The best time and the fewest allocations of all benchmark runs.
+struct BenchmarkMeasurement
+{
+  std::chrono::nanoseconds Time{0};
+  uint64_t Allocations{0}; //!< Zero if the reporter has no allocation counter.
+};
+
+//! Result of one benchmark.
+struct BenchmarkResult
+{
+  std::string Name; //!< Benchmark scenario such as "post-throughput" or "then-chain".
+  std::string Variant; //!< Scenario variant such as the queue kind or the number of inputs.
+  uint32_t Threads{0}; //!< Number of producer threads or queues that the scenario uses.
+  uint64_t Operations{0}; //!< Number of measured operations: tasks, round trips, futures, etc.
+  BenchmarkMeasurement Best;
+  uint32_t ProcessThreadCount{0}; //!< Max number of process threads during the run, or zero if not measured.
+};
+
+//! Returns the number of heap allocations made by all threads since the process start.
+using BenchmarkAllocationCounter = uint64_t (*)() noexcept;
+
+//! Runs benchmarks selected by options and reports their results in the requested format.
+//! The variantName names the BenchmarkResult::Variant column, e.g. "queue" or "size".
+//! If the allocationCounter is set, then the results also report the allocations per operation.
+struct BenchmarkReporter
+{
+  BenchmarkReporter(
+      BenchmarkOptions const& options,
+      char const* variantName,
+      BenchmarkAllocationCounter allocationCounter = nullptr) noexcept;
+
+  //! True if the benchmark is selected by the filter.
+  bool ShouldRun(char const* name, char const* variant) const noexcept;
+
+  //! True if the benchmarks run fewer operations to smoke test them.
+  bool IsQuick() const noexcept;
+
+  //! Returns the operation count for the benchmark adjusted for the quick mode.
+  uint32_t Scale(uint32_t operationCount) const noexcept;
+
+  //! Adds a flag to the JSON run context.
+  void AddContext(char const* name, bool value) noexcept;
+
+  //! Calls run RunCount times and returns the best time and the fewest allocations. The run returns its time.
+  template <typename TRun>
+  BenchmarkMeasurement MeasureBest(TRun&& run) const noexcept
+  {
+    BenchmarkMeasurement best{std::chrono::nanoseconds::max(), m_allocationCounter ? UINT64_MAX : 0};
+    for (uint32_t i = 0; i < m_options.RunCount; ++i)
+    {
+      uint64_t startAllocations = m_allocationCounter ? m_allocationCounter() : 0;
+      best.Time = std::min(best.Time, std::chrono::nanoseconds{run()});
+      if (m_allocationCounter)
+      {
+        best.Allocations = std::min(best.Allocations, m_allocationCounter() - startAllocations);
+      }
+    }
+
+    return best;
+  }
+
+  void Report(BenchmarkResult&& result) noexcept;
+
+  //! Writes the collected results for the machine readable formats. Returns false if the output cannot be written.
+  bool Finish() noexcept;
+
+private:
+  void WriteJson(FILE* file) const noexcept;
+  void WriteCsv(FILE* file) const noexcept;
+
+private:
+  const BenchmarkOptions m_options;
+  const std::string m_variantName;
+  const BenchmarkAllocationCounter m_allocationCounter;
+  std::vector<std::pair<std::string, bool>> m_context;
+  std::vector<BenchmarkResult> m_results;
+};
+
+} // namespace Mso
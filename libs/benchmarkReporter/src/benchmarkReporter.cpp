@@ -0,0 +1,225 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "benchmarkReporter/benchmarkReporter.h"
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+namespace Mso {
+
+bool TryParseBenchmarkOptions(int argc, char** argv, /*out*/ BenchmarkOptions& options) noexcept
+{
+  for (int i = 1; i < argc; ++i)
+  {
+    char const* arg = argv[i];
+    if (std::strcmp(arg, "--format=text") == 0)
+    {
+      options.Format = BenchmarkFormat::Text;
+    }
+    else if (std::strcmp(arg, "--format=json") == 0)
+    {
+      options.Format = BenchmarkFormat::Json;
+    }
+    else if (std::strcmp(arg, "--format=csv") == 0)
+    {
+      options.Format = BenchmarkFormat::Csv;
+    }
+    else if (std::strncmp(arg, "--output=", 9) == 0)
+    {
+      options.OutputPath = arg + 9;
+    }
+    else if (std::strncmp(arg, "--filter=", 9) == 0)
+    {
+      options.Filter = arg + 9;
+    }
+    else if (std::strncmp(arg, "--runs=", 7) == 0 && std::atoi(arg + 7) > 0)
+    {
+      options.RunCount = static_cast<uint32_t>(std::atoi(arg + 7));
+    }
+    else if (std::strcmp(arg, "--quick") == 0)
+    {
+      options.IsQuick = true;
+    }
+    else
+    {
+      std::fprintf(stderr, "Unknown option: %s\n", arg);
+      std::fprintf(
+          stderr,
+          "Usage: %s [--format=text|json|csv] [--output=<path>] [--filter=<substring>] [--runs=<count>] [--quick]\n",
+          argv[0]);
+      return false;
+    }
+  }
+
+  return true;
+}
+
+//=============================================================================
+// BenchmarkReporter implementation.
+//=============================================================================
+
+BenchmarkReporter::BenchmarkReporter(
+    BenchmarkOptions const& options,
+    char const* variantName,
+    BenchmarkAllocationCounter allocationCounter) noexcept
+    : m_options{options}, m_variantName{variantName}, m_allocationCounter{allocationCounter}
+{
+}
+
+bool BenchmarkReporter::ShouldRun(char const* name, char const* variant) const noexcept
+{
+  return m_options.Filter.empty() || (std::string{name} + "/" + variant).find(m_options.Filter) != std::string::npos;
+}
+
+bool BenchmarkReporter::IsQuick() const noexcept
+{
+  return m_options.IsQuick;
+}
+
+uint32_t BenchmarkReporter::Scale(uint32_t operationCount) const noexcept
+{
+  return m_options.IsQuick ? std::max(operationCount / 10, 1u) : operationCount;
+}
+
+void BenchmarkReporter::AddContext(char const* name, bool value) noexcept
+{
+  m_context.emplace_back(name, value);
+}
+
+void BenchmarkReporter::Report(BenchmarkResult&& result) noexcept
+{
+  if (m_options.Format == BenchmarkFormat::Text)
+  {
+    double seconds = std::chrono::duration<double>(result.Best.Time).count();
+    std::printf(
+        "%-18s %s=%-12s threads=%-5u ops=%-8llu time=%9.2fms ns/op=%9.1f ops/s=%12.0f",
+        result.Name.c_str(),
+        m_variantName.c_str(),
+        result.Variant.c_str(),
+        result.Threads,
+        static_cast<unsigned long long>(result.Operations),
+        seconds * 1000,
+        seconds * 1e9 / result.Operations,
+        result.Operations / seconds);
+    if (m_allocationCounter)
+    {
+      std::printf(" allocs/op=%6.2f", static_cast<double>(result.Best.Allocations) / result.Operations);
+    }
+
+    if (result.ProcessThreadCount != 0)
+    {
+      std::printf(" process-threads=%u", result.ProcessThreadCount);
+    }
+
+    std::printf("\n");
+    std::fflush(stdout);
+  }
+
+  m_results.push_back(std::move(result));
+}
+
+bool BenchmarkReporter::Finish() noexcept
+{
+  if (m_options.Format == BenchmarkFormat::Text)
+  {
+    return true;
+  }
+
+  FILE* file = m_options.OutputPath.empty() ? stdout : std::fopen(m_options.OutputPath.c_str(), "w");
+  if (!file)
+  {
+    std::fprintf(stderr, "Cannot open %s\n", m_options.OutputPath.c_str());
+    return false;
+  }
+
+  if (m_options.Format == BenchmarkFormat::Json)
+  {
+    WriteJson(file);
+  }
+  else
+  {
+    WriteCsv(file);
+  }
+
+  return file == stdout ? std::fflush(file) == 0 : std::fclose(file) == 0;
+}
+
+void BenchmarkReporter::WriteJson(FILE* file) const noexcept
+{
+  std::fprintf(
+      file,
+      "{\n  \"context\": {\"hardware_concurrency\": %u, \"runs\": %u, \"quick\": %s",
+      std::thread::hardware_concurrency(),
+      m_options.RunCount,
+      m_options.IsQuick ? "true" : "false");
+  for (auto const& entry : m_context)
+  {
+    std::fprintf(file, ", \"%s\": %s", entry.first.c_str(), entry.second ? "true" : "false");
+  }
+
+  std::fprintf(file, "},\n  \"benchmarks\": [");
+  for (size_t i = 0; i < m_results.size(); ++i)
+  {
+    BenchmarkResult const& result = m_results[i];
+    std::fprintf(
+        file,
+        "%s\n    {\"name\": \"%s\", \"%s\": \"%s\", \"threads\": %u, \"operations\": %llu, \"time_ns\": %lld, "
+        "\"ns_per_op\": %.3f, \"process_threads\": %u",
+        i == 0 ? "" : ",",
+        result.Name.c_str(),
+        m_variantName.c_str(),
+        result.Variant.c_str(),
+        result.Threads,
+        static_cast<unsigned long long>(result.Operations),
+        static_cast<long long>(result.Best.Time.count()),
+        static_cast<double>(result.Best.Time.count()) / result.Operations,
+        result.ProcessThreadCount);
+    if (m_allocationCounter)
+    {
+      std::fprintf(
+          file,
+          ", \"allocations\": %llu, \"allocations_per_op\": %.3f",
+          static_cast<unsigned long long>(result.Best.Allocations),
+          static_cast<double>(result.Best.Allocations) / result.Operations);
+    }
+
+    std::fprintf(file, "}");
+  }
+
+  std::fprintf(file, "\n  ]\n}\n");
+}
+
+void BenchmarkReporter::WriteCsv(FILE* file) const noexcept
+{
+  std::fprintf(
+      file,
+      "name,%s,threads,operations,time_ns,ns_per_op,process_threads%s\n",
+      m_variantName.c_str(),
+      m_allocationCounter ? ",allocations,allocations_per_op" : "");
+  for (BenchmarkResult const& result : m_results)
+  {
+    std::fprintf(
+        file,
+        "%s,%s,%u,%llu,%lld,%.3f,%u",
+        result.Name.c_str(),
+        result.Variant.c_str(),
+        result.Threads,
+        static_cast<unsigned long long>(result.Operations),
+        static_cast<long long>(result.Best.Time.count()),
+        static_cast<double>(result.Best.Time.count()) / result.Operations,
+        result.ProcessThreadCount);
+    if (m_allocationCounter)
+    {
+      std::fprintf(
+          file,
+          ",%llu,%.3f",
+          static_cast<unsigned long long>(result.Best.Allocations),
+          static_cast<double>(result.Best.Allocations) / result.Operations);
+    }
+
+    std::fprintf(file, "\n");
+  }
+}
+
+} // namespace Mso
@@ -29,4 +29,16 @@
 #endif
 #endif
 
+// Check if compiler supports C++20 coroutines
+#ifndef MSO_HAS_COROUTINES
+#if defined(__cpp_impl_coroutine) && defined(__has_include)
+#if __has_include(<coroutine>)
+#define MSO_HAS_COROUTINES 1
+#endif
+#endif
+#ifndef MSO_HAS_COROUTINES
+#define MSO_HAS_COROUTINES 0
+#endif
+#endif // MSO_HAS_COROUTINES
+
 #endif // MSO_COMPILERADAPTERS_COMPILERFEATURES_H
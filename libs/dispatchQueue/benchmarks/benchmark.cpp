@@ -0,0 +1,60 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+// Runs the dispatchQueue benchmarks and reports their results.
+//
+// Usage: dispatchQueue_benchmarks [--format=text|json|csv] [--output=<path>] [--filter=<substring>] [--runs=<count>]
+//                                 [--quick]
+//
+// Use the JSON or CSV output to compare results between builds and to track regressions. The results depend on the
+// machine, thus compare only the results collected on the same machine.
+
+#include "benchmark.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace DispatchQueueBenchmarks {
+
+//=============================================================================
+// Helper functions.
+//=============================================================================
+
+uint32_t GetProcessThreadCount() noexcept
+{
+  uint32_t threadCount{0};
+#if defined(MS_TARGET_LINUX)
+  if (FILE* status = std::fopen("/proc/self/status", "r"))
+  {
+    char line[256];
+    while (std::fgets(line, sizeof(line), status))
+    {
+      if (std::strncmp(line, "Threads:", 8) == 0)
+      {
+        threadCount = static_cast<uint32_t>(std::strtoul(line + 8, nullptr, 10));
+        break;
+      }
+    }
+
+    std::fclose(status);
+  }
+#endif
+  return threadCount;
+}
+
+} // namespace DispatchQueueBenchmarks
+
+int main(int argc, char** argv)
+{
+  using namespace DispatchQueueBenchmarks;
+  Mso::BenchmarkOptions options;
+  if (!Mso::TryParseBenchmarkOptions(argc, argv, /*out*/ options))
+  {
+    return 2;
+  }
+
+  BenchmarkReporter reporter{options, "queue"};
+  RunPostBenchmarks(reporter);
+  RunSchedulerBenchmarks(reporter);
+  return reporter.Finish() ? 0 : 1;
+}
@@ -0,0 +1,41 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+#include "benchmarkReporter/benchmarkReporter.h"
+#include "dispatchQueue/dispatchQueue.h"
+
+namespace DispatchQueueBenchmarks {
+
+using Mso::BenchmarkMeasurement;
+using Mso::BenchmarkReporter;
+
+//! Kinds of schedulers used by the serial queues in the benchmarks.
+enum class BenchmarkScheduler
+{
+  ThreadPool, //!< DispatchQueue::MakeSerialQueue that runs on the platform thread pool.
+  Looper, //!< DispatchQueue::MakeLooperQueue that runs on its own thread.
+  Custom, //!< DispatchQueue::MakeCustomQueue with a scheduler that forwards the work to the concurrent queue.
+};
+
+constexpr BenchmarkScheduler AllBenchmarkSchedulers[]{
+    BenchmarkScheduler::ThreadPool, BenchmarkScheduler::Looper, BenchmarkScheduler::Custom};
+
+char const* GetSchedulerName(BenchmarkScheduler scheduler) noexcept;
+
+//! Create a serial queue that uses the scheduler.
+Mso::DispatchQueue MakeBenchmarkQueue(BenchmarkScheduler scheduler) noexcept;
+
+//! Returns number of threads in the current process, or zero if it is unknown.
+uint32_t GetProcessThreadCount() noexcept;
+
+// Benchmark suites.
+void RunPostBenchmarks(BenchmarkReporter& reporter) noexcept;
+void RunSchedulerBenchmarks(BenchmarkReporter& reporter) noexcept;
+
+} // namespace DispatchQueueBenchmarks
@@ -0,0 +1,204 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+// Measures DispatchQueue::Post throughput when multiple producer threads post into the same queue,
+// when one producer posts into many serial queues, and when tasks recursively post more tasks.
+// The serial queues are measured with each of the benchmark schedulers.
+
+#include "benchmark.h"
+#include <atomic>
+#include <thread>
+#include "eventWaitHandle/eventWaitHandle.h"
+
+namespace DispatchQueueBenchmarks {
+
+namespace {
+
+constexpr uint32_t TaskCount{1000000};
+constexpr uint32_t ProducerCounts[]{1, 4, 16};
+constexpr uint32_t ManyQueueCount{10000};
+constexpr uint32_t FanOutDepth{20}; // Number of tasks is 2^FanOutDepth - 1.
+
+// Posts taskCount tasks from producerCount threads and returns time until all of them are invoked.
+std::chrono::nanoseconds RunPostThroughput(
+    Mso::DispatchQueue const& queue,
+    uint32_t producerCount,
+    uint32_t taskCount) noexcept
+{
+  std::atomic<uint32_t> remaining{taskCount};
+  std::atomic<bool> isStarted{false};
+  Mso::ManualResetEvent finished;
+
+  std::vector<std::thread> producers;
+  producers.reserve(producerCount);
+  for (uint32_t i = 0; i < producerCount; ++i)
+  {
+    uint32_t postCount = taskCount / producerCount + (i < taskCount % producerCount ? 1 : 0);
+    producers.emplace_back([&queue, &remaining, &isStarted, &finished, postCount]() noexcept {
+      while (!isStarted.load(std::memory_order_acquire))
+      {
+        std::this_thread::yield();
+      }
+
+      for (uint32_t j = 0; j < postCount; ++j)
+      {
+        queue.Post([&remaining, &finished]() noexcept {
+          if (remaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+          {
+            finished.Set();
+          }
+        });
+      }
+    });
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  isStarted.store(true, std::memory_order_release);
+  for (auto& producer : producers)
+  {
+    producer.join();
+  }
+
+  finished.Wait();
+  return std::chrono::steady_clock::now() - start;
+}
+
+template <typename TMakeQueue>
+void RunPostScenario(BenchmarkReporter& reporter, char const* queueName, TMakeQueue&& makeQueue) noexcept
+{
+  if (!reporter.ShouldRun("post-throughput", queueName))
+  {
+    return;
+  }
+
+  uint32_t taskCount = reporter.Scale(TaskCount);
+  for (uint32_t producerCount : ProducerCounts)
+  {
+    BenchmarkMeasurement best = reporter.MeasureBest([&]() noexcept {
+      auto queue = makeQueue();
+      auto time = RunPostThroughput(queue, producerCount, taskCount);
+      queue.AwaitTermination();
+      return time;
+    });
+
+    reporter.Report({"post-throughput", queueName, producerCount, taskCount, best});
+  }
+}
+
+// Posts TaskCount tasks round-robin into ManyQueueCount serial queues from one thread.
+void RunManyQueuesScenario(BenchmarkReporter& reporter) noexcept
+{
+  if (!reporter.ShouldRun("many-serial", "thread-pool"))
+  {
+    return;
+  }
+
+  uint32_t taskCount = reporter.Scale(TaskCount);
+  uint32_t maxThreadCount{0};
+  BenchmarkMeasurement best = reporter.MeasureBest([&]() noexcept {
+    std::vector<Mso::DispatchQueue> queues;
+    queues.reserve(ManyQueueCount);
+    for (uint32_t i = 0; i < ManyQueueCount; ++i)
+    {
+      queues.push_back(Mso::DispatchQueue::MakeSerialQueue());
+    }
+
+    std::atomic<uint32_t> remaining{taskCount};
+    Mso::ManualResetEvent finished;
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < taskCount; ++i)
+    {
+      queues[i % ManyQueueCount].Post([&remaining, &finished]() noexcept {
+        if (remaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+          finished.Set();
+        }
+      });
+    }
+
+    maxThreadCount = std::max(maxThreadCount, GetProcessThreadCount());
+    finished.Wait();
+    auto time = std::chrono::steady_clock::now() - start;
+
+    for (auto& queue : queues)
+    {
+      queue.AwaitTermination();
+    }
+
+    return time;
+  });
+
+  reporter.Report({"many-serial", "thread-pool", ManyQueueCount, taskCount, best, maxThreadCount});
+}
+
+// Each task posts two child tasks until the tree of tasks reaches FanOutDepth.
+struct FanOutTree
+{
+  FanOutTree(Mso::DispatchQueue const& queue, uint32_t depth) noexcept : Queue{queue}, Remaining{(1u << depth) - 1} {}
+
+  void PostNode(uint32_t depth) noexcept
+  {
+    Queue.Post([this, depth]() noexcept {
+      if (depth > 1)
+      {
+        PostNode(depth - 1);
+        PostNode(depth - 1);
+      }
+
+      if (Remaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+      {
+        Finished.Set();
+      }
+    });
+  }
+
+  Mso::DispatchQueue Queue;
+  std::atomic<uint32_t> Remaining;
+  Mso::ManualResetEvent Finished;
+};
+
+void RunFanOutScenario(
+    BenchmarkReporter& reporter,
+    char const* schedulerName,
+    Mso::ConcurrentQueueScheduler scheduler) noexcept
+{
+  if (!reporter.ShouldRun("fan-out-tree", schedulerName))
+  {
+    return;
+  }
+
+  Mso::UnitTest_UninitConcurrentQueue();
+  Mso::SetConcurrentQueueScheduler(scheduler);
+
+  uint32_t depth = reporter.IsQuick() ? FanOutDepth - 3 : FanOutDepth; // The quick run has 8 times fewer tasks.
+  BenchmarkMeasurement best = reporter.MeasureBest([depth]() noexcept {
+    FanOutTree tree{Mso::DispatchQueue::ConcurrentQueue(), depth};
+    auto start = std::chrono::steady_clock::now();
+    tree.PostNode(depth);
+    tree.Finished.Wait();
+    return std::chrono::steady_clock::now() - start;
+  });
+
+  Mso::UnitTest_UninitConcurrentQueue();
+  Mso::SetConcurrentQueueScheduler(Mso::ConcurrentQueueScheduler::ThreadPool);
+
+  reporter.Report({"fan-out-tree", schedulerName, 1, (1u << depth) - 1, best});
+}
+
+} // namespace
+
+void RunPostBenchmarks(BenchmarkReporter& reporter) noexcept
+{
+  RunPostScenario(reporter, "concurrent", []() noexcept { return Mso::DispatchQueue::MakeConcurrentQueue(0); });
+  for (BenchmarkScheduler scheduler : AllBenchmarkSchedulers)
+  {
+    RunPostScenario(
+        reporter, GetSchedulerName(scheduler), [scheduler]() noexcept { return MakeBenchmarkQueue(scheduler); });
+  }
+
+  RunManyQueuesScenario(reporter);
+  RunFanOutScenario(reporter, "thread-pool", Mso::ConcurrentQueueScheduler::ThreadPool);
+  RunFanOutScenario(reporter, "work-stealing", Mso::ConcurrentQueueScheduler::WorkStealing);
+}
+
+} // namespace DispatchQueueBenchmarks
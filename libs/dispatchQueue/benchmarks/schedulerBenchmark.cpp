@@ -0,0 +1,300 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+// Measures the serial queue schedulers: the thread pool scheduler, the looper scheduler, and a custom scheduler.
+// The scenarios are the ping-pong latency between two serial queues, fan-out/fan-in between a producer, worker queues
+// and a collector queue, posting while another thread suspends and resumes the queue, and posting task batches.
+
+#include "benchmark.h"
+#include <atomic>
+#include <thread>
+#include "eventWaitHandle/eventWaitHandle.h"
+
+namespace DispatchQueueBenchmarks {
+
+namespace {
+
+constexpr uint32_t RoundTripCount{100000};
+constexpr uint32_t FanOutTaskCount{200000};
+constexpr uint32_t FanOutWorkerCount{4};
+constexpr uint32_t SuspendStormTaskCount{200000};
+constexpr uint32_t BatchTaskCount{1000000};
+constexpr uint32_t BatchSize{64};
+
+//! Custom scheduler that runs the queue tasks on the concurrent queue. It posts one draining task at a time to
+//! keep the queue serial. It is how applications usually integrate the dispatch queues with their own executors.
+struct ForwardingScheduler : Mso::UnknownObject<Mso::IDispatchQueueScheduler>
+{
+  void IntializeScheduler(Mso::WeakPtr<Mso::IDispatchQueueService>&& queue) noexcept override
+  {
+    m_queue = std::move(queue);
+  }
+
+  bool HasThreadAccess() noexcept override
+  {
+    return m_drainingThreadId.load(std::memory_order_relaxed) == std::this_thread::get_id();
+  }
+
+  bool IsSerial() noexcept override
+  {
+    return true;
+  }
+
+  void Post(size_t /*taskCount*/) noexcept override
+  {
+    if (!m_isDraining.exchange(true))
+    {
+      Mso::DispatchQueue::ConcurrentQueue().Post([self = Mso::CntPtr{this}]() noexcept { self->Drain(); });
+    }
+  }
+
+  void Shutdown() noexcept override {}
+
+  void AwaitTermination() noexcept override
+  {
+    while (m_isDraining.load())
+    {
+      std::this_thread::yield();
+    }
+  }
+
+private:
+  void Drain() noexcept
+  {
+    for (;;)
+    {
+      bool hasTasks{false};
+      if (auto queue = m_queue.GetStrongPtr())
+      {
+        m_drainingThreadId.store(std::this_thread::get_id(), std::memory_order_relaxed);
+        Mso::DispatchTask task;
+        while (queue->TryDequeTask(/*out*/ task))
+        {
+          queue->InvokeTask(std::move(task), std::nullopt);
+        }
+
+        m_drainingThreadId.store(std::thread::id{}, std::memory_order_relaxed);
+
+        // Check for the tasks posted after the draining loop, because their Post calls did not post a new Drain.
+        // The queue is released after the flag is reset to let its destructor complete AwaitTermination.
+        m_isDraining.store(false);
+        hasTasks = queue->HasTasks();
+      }
+      else
+      {
+        m_isDraining.store(false);
+      }
+
+      if (!hasTasks || m_isDraining.exchange(true))
+      {
+        return;
+      }
+    }
+  }
+
+private:
+  Mso::WeakPtr<Mso::IDispatchQueueService> m_queue;
+  std::atomic<bool> m_isDraining{false};
+  std::atomic<std::thread::id> m_drainingThreadId{};
+};
+
+// Sends a task back and forth between two serial queues and returns time of all round trips.
+std::chrono::nanoseconds RunPingPong(BenchmarkScheduler scheduler, uint32_t roundTripCount) noexcept
+{
+  struct PingPong
+  {
+    PingPong(BenchmarkScheduler scheduler, uint32_t roundTripCount) noexcept
+        : First{MakeBenchmarkQueue(scheduler)}, Second{MakeBenchmarkQueue(scheduler)}, Remaining{roundTripCount}
+    {
+    }
+
+    void Ping() noexcept
+    {
+      First.Post([this]() noexcept {
+        Second.Post([this]() noexcept {
+          // The queues invoke the round trips one after another. Thus, the counter needs no synchronization.
+          if (--Remaining == 0)
+          {
+            Finished.Set();
+          }
+          else
+          {
+            Ping();
+          }
+        });
+      });
+    }
+
+    Mso::DispatchQueue First;
+    Mso::DispatchQueue Second;
+    uint32_t Remaining;
+    Mso::ManualResetEvent Finished;
+  };
+
+  PingPong pingPong{scheduler, roundTripCount};
+  auto start = std::chrono::steady_clock::now();
+  pingPong.Ping();
+  pingPong.Finished.Wait();
+  auto time = std::chrono::steady_clock::now() - start;
+  pingPong.First.AwaitTermination();
+  pingPong.Second.AwaitTermination();
+  return time;
+}
+
+// Posts tasks round-robin to the worker queues. Each worker task posts a task to the collector queue.
+// Returns time until the collector queue invokes all tasks.
+std::chrono::nanoseconds RunFanOutFanIn(BenchmarkScheduler scheduler, uint32_t taskCount) noexcept
+{
+  std::vector<Mso::DispatchQueue> workers;
+  for (uint32_t i = 0; i < FanOutWorkerCount; ++i)
+  {
+    workers.push_back(MakeBenchmarkQueue(scheduler));
+  }
+
+  Mso::DispatchQueue collector = MakeBenchmarkQueue(scheduler);
+  uint32_t remaining{taskCount}; // Only the collector queue tasks change it.
+  Mso::ManualResetEvent finished;
+  auto start = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < taskCount; ++i)
+  {
+    workers[i % FanOutWorkerCount].Post([&collector, &remaining, &finished]() noexcept {
+      collector.Post([&remaining, &finished]() noexcept {
+        if (--remaining == 0)
+        {
+          finished.Set();
+        }
+      });
+    });
+  }
+
+  finished.Wait();
+  auto time = std::chrono::steady_clock::now() - start;
+  for (auto& worker : workers)
+  {
+    worker.AwaitTermination();
+  }
+
+  collector.AwaitTermination();
+  return time;
+}
+
+// Posts tasks while another thread suspends and resumes the queue in a loop.
+// Returns time until the queue invokes all tasks.
+std::chrono::nanoseconds RunSuspendStorm(BenchmarkScheduler scheduler, uint32_t taskCount) noexcept
+{
+  Mso::DispatchQueue queue = MakeBenchmarkQueue(scheduler);
+  std::atomic<uint32_t> remaining{taskCount};
+  std::atomic<bool> isFinished{false};
+  Mso::ManualResetEvent finished;
+  std::thread storm{[&queue, &isFinished]() noexcept {
+    while (!isFinished.load(std::memory_order_relaxed))
+    {
+      Mso::DispatchSuspendGuard suspendGuard = queue.Suspend();
+    }
+  }};
+
+  auto start = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < taskCount; ++i)
+  {
+    queue.Post([&remaining, &finished]() noexcept {
+      if (remaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+      {
+        finished.Set();
+      }
+    });
+  }
+
+  finished.Wait();
+  auto time = std::chrono::steady_clock::now() - start;
+  isFinished.store(true, std::memory_order_relaxed);
+  storm.join();
+  queue.AwaitTermination();
+  return time;
+}
+
+// Posts tasks in batches of BatchSize tasks. Returns time until the queue invokes all tasks.
+std::chrono::nanoseconds RunBatching(BenchmarkScheduler scheduler, uint32_t taskCount) noexcept
+{
+  Mso::DispatchQueue queue = MakeBenchmarkQueue(scheduler);
+  std::atomic<uint32_t> remaining{taskCount};
+  Mso::ManualResetEvent finished;
+  auto start = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < taskCount; i += BatchSize)
+  {
+    Mso::DispatchTaskBatch batch = queue.StartTaskBatching();
+    for (uint32_t j = i; j < std::min(i + BatchSize, taskCount); ++j)
+    {
+      queue.Post([&remaining, &finished]() noexcept {
+        if (remaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+          finished.Set();
+        }
+      });
+    }
+  }
+
+  finished.Wait();
+  auto time = std::chrono::steady_clock::now() - start;
+  queue.AwaitTermination();
+  return time;
+}
+
+// Runs the scenario for each scheduler. The run function returns time of operationCount operations.
+void RunForEachScheduler(
+    BenchmarkReporter& reporter,
+    char const* name,
+    uint32_t threadCount,
+    uint32_t operationCount,
+    std::chrono::nanoseconds (*run)(BenchmarkScheduler, uint32_t)) noexcept
+{
+  operationCount = reporter.Scale(operationCount);
+  for (BenchmarkScheduler scheduler : AllBenchmarkSchedulers)
+  {
+    if (reporter.ShouldRun(name, GetSchedulerName(scheduler)))
+    {
+      auto best = reporter.MeasureBest([&]() noexcept { return run(scheduler, operationCount); });
+      reporter.Report({name, GetSchedulerName(scheduler), threadCount, operationCount, best});
+    }
+  }
+}
+
+} // namespace
+
+char const* GetSchedulerName(BenchmarkScheduler scheduler) noexcept
+{
+  switch (scheduler)
+  {
+    case BenchmarkScheduler::ThreadPool:
+      return "thread-pool";
+    case BenchmarkScheduler::Looper:
+      return "looper";
+    case BenchmarkScheduler::Custom:
+      return "custom";
+  }
+
+  return "unknown";
+}
+
+Mso::DispatchQueue MakeBenchmarkQueue(BenchmarkScheduler scheduler) noexcept
+{
+  switch (scheduler)
+  {
+    case BenchmarkScheduler::ThreadPool:
+      return Mso::DispatchQueue::MakeSerialQueue();
+    case BenchmarkScheduler::Looper:
+      return Mso::DispatchQueue::MakeLooperQueue();
+    case BenchmarkScheduler::Custom:
+    default:
+      return Mso::DispatchQueue::MakeCustomQueue(Mso::Make<ForwardingScheduler, Mso::IDispatchQueueScheduler>());
+  }
+}
+
+void RunSchedulerBenchmarks(BenchmarkReporter& reporter) noexcept
+{
+  RunForEachScheduler(reporter, "ping-pong", 2, RoundTripCount, &RunPingPong);
+  RunForEachScheduler(reporter, "fan-out-fan-in", FanOutWorkerCount + 1, FanOutTaskCount, &RunFanOutFanIn);
+  RunForEachScheduler(reporter, "suspend-storm", 2, SuspendStormTaskCount, &RunSuspendStorm);
+  RunForEachScheduler(reporter, "batching", 1, BatchTaskCount, &RunBatching);
+}
+
+} // namespace DispatchQueueBenchmarks
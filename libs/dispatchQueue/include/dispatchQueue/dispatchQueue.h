@@ -5,34 +5,47 @@
 #ifndef MSO_DISPATCHQUEUE_DISPATCHQUEUE_H
 #define MSO_DISPATCHQUEUE_DISPATCHQUEUE_H
 
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <new>
 #include <optional>
+#include <string>
 #include <thread>
+#include <type_traits>
+#include <utility>
+#include "compilerAdapters/compilerFeatures.h"
 #include "functional/functor.h"
 #include "object/unknownObject.h"
 #include "span/span.h"
 #include "typeTraits/tags.h"
 
-namespace Mso {
+#if MSO_HAS_COROUTINES
+#include <coroutine>
+#endif
 
-//! Most of dispatch tasks implement just IVoidFunctor.
-//! They can optionally implement ICancellationListener to observe cancellation.
-//! They can implement any other interfaces if needed.
-using DispatchTask = VoidFunctor;
+namespace Mso {
 
 // Forward declarations
+struct DispatchBlockingScope;
 struct DispatchLocalValueGuard;
+struct DispatchPartitionedQueue;
 struct DispatchQueue;
 struct DispatchSuspendGuard;
+struct DispatchTask;
 struct DispatchTaskBatch;
+struct DispatchTimer;
 template <typename TInvoke, typename TCancel>
 struct DispatchTaskImpl;
 template <typename TInvoke>
 struct DispatchCleanupTaskImpl;
 struct ICancellationListener;
+struct IDispatchPartitionedQueue;
 struct IDispatchQueue;
 struct IDispatchQueueScheduler;
 struct IDispatchQueueService;
 struct IDispatchQueueStatic;
+struct IDispatchTimer;
 
 //! A reason for a task being invoked to yield.
 enum class TaskYieldReason
@@ -49,6 +62,49 @@ enum class PendingTaskAction
   Cancel,
 };
 
+//! Scheduler used by the DispatchQueue::ConcurrentQueue.
+enum class ConcurrentQueueScheduler
+{
+  //! Platform specific thread pool. It is the default scheduler.
+  ThreadPool,
+
+  //! Work-stealing scheduler with a task deque per worker thread.
+  //! Tasks posted from a worker thread are invoked by the same thread unless idle workers steal them.
+  //! It has one worker per available processor, and it does not add workers when tasks block. Thus, use it only
+  //! for short non-blocking tasks, and compare it with the ThreadPool using the dispatchQueue benchmarks.
+  //! The worker deques store task pointers. Thus, each task posted from a worker thread is allocated on the heap
+  //! even if it fits into the DispatchTask inline buffer.
+  WorkStealing,
+};
+
+//! Priority of a task posted to a DispatchQueue. Tasks of the same priority are invoked in their posting order.
+//! A queue invokes higher priority tasks first, but it lets a lower priority task run after higher priority tasks
+//! passed it a few times to avoid its starvation. Serial queues still invoke their tasks one at a time.
+enum class DispatchPriority
+{
+  Low,
+  Normal,
+  High,
+};
+
+//! Number of buckets in the DispatchQueueMetrics time histograms. The bucket zero counts times below 1 us.
+//! The bucket i counts times in the [2^(i-1), 2^i) us range. The last bucket also counts all longer times.
+constexpr size_t DispatchQueueHistogramBucketCount{24};
+
+//! Runtime metrics of a DispatchQueue. The counters start after the DispatchQueue::EnableMetrics call.
+struct DispatchQueueMetrics
+{
+  uint64_t EnqueueCount{0}; //!< Tasks added to the queue.
+  uint64_t DequeueCount{0}; //!< Tasks taken from the queue for invocation.
+  size_t Depth{0}; //!< Pending tasks at the time of the GetMetrics call.
+  size_t PeakDepth{0}; //!< Max number of pending tasks. It is the same as DispatchQueue::GetHighWaterMark.
+  uint64_t DeferredCount{0}; //!< Tasks added to the deferred tasks of the running task by DeferElsePost.
+  uint64_t BatchedCount{0}; //!< Tasks added to a task batch instead of the queue.
+  uint64_t OverCapacityCount{0}; //!< Tasks that Post methods added above the SetCapacity limit.
+  std::array<uint64_t, DispatchQueueHistogramBucketCount> WaitTimeHistogram{}; //!< From enqueue to invoke start.
+  std::array<uint64_t, DispatchQueueHistogramBucketCount> ExecutionTimeHistogram{}; //!< Task and its deferred tasks.
+};
+
 //! Callback type to handle queue local values
 using SwapDispatchLocalValueCallback = void (*)(void** localValue, void* tlsValue) noexcept;
 
@@ -63,13 +119,235 @@ template <typename TValue>
 void SwapDispatchLocalValue(void** localValue, void* tlsValue) noexcept;
 
 template <typename TInvoke, typename TOnCancel>
-Mso::VoidFunctor MakeDispatchTask(TInvoke&& invoke, TOnCancel&& onCancel) noexcept;
+DispatchTask MakeDispatchTask(TInvoke&& invoke, TOnCancel&& onCancel) noexcept;
 
 template <typename TInvoke>
-Mso::VoidFunctor MakeDispatchCleanupTask(TInvoke&& invoke) noexcept;
+DispatchTask MakeDispatchCleanupTask(TInvoke&& invoke) noexcept;
 
 void UnitTest_UninitConcurrentQueue() noexcept;
 
+//! Set scheduler for the DispatchQueue::ConcurrentQueue. It must be called before the ConcurrentQueue is created.
+void SetConcurrentQueueScheduler(ConcurrentQueueScheduler scheduler) noexcept;
+
+//! Set the time slice for the thread pool queues. A thread pool thread runs tasks of a queue until the time slice
+//! expires, and then switches to other queues. Tasks invoked after the time slice expiration observe ShouldYield
+//! returning true with the TaskYieldReason::TimeExpired. The default time slice is 100 ms.
+void SetDispatchQueueTimeSlice(std::chrono::steady_clock::duration timeSlice) noexcept;
+
+//! How a thread pool worker waits for new work after it runs out of work. The worker spins with a CPU pause
+//! instruction first, then yields its processor, and then parks until new work is submitted. The spinning and
+//! yielding workers pick up the work submitted shortly after without the cost of waking up a parked thread.
+//! To leave the processors to the busy threads, at most half of the available processors, but at least one, have
+//! spinning or yielding workers at a time. Other idle workers park right away.
+struct ThreadPoolIdlePolicy
+{
+  uint32_t SpinCount{1024}; //!< Spin iterations before the worker starts to yield. Zero disables spinning.
+  uint32_t YieldCount{8}; //!< Yields before the worker parks. Zero disables yielding.
+};
+
+//! Counters of the thread pool worker idle stages.
+struct ThreadPoolIdleStats
+{
+  uint64_t SpinCount{0}; //!< Idle workers that started to spin.
+  uint64_t SpinWakeUpCount{0}; //!< Spinning workers that found new work.
+  uint64_t YieldCount{0}; //!< Idle workers that started to yield.
+  uint64_t YieldWakeUpCount{0}; //!< Yielding workers that found new work.
+  uint64_t ParkCount{0}; //!< Idle workers that parked until new work was submitted.
+  uint64_t RetireCount{0}; //!< Parked workers that exited after the ThreadPoolConfig::IdleTimeout.
+};
+
+//! Set the idle policy of the thread pool workers. It applies to workers that become idle after the call.
+//! It has no effect for the platform thread pools that manage their own threads.
+void SetThreadPoolIdlePolicy(ThreadPoolIdlePolicy const& policy) noexcept;
+
+//! Returns the thread pool worker idle stage counters since the process start.
+ThreadPoolIdleStats GetThreadPoolIdleStats() noexcept;
+
+//! Thread count limits of the thread pool. The pool starts workers on demand up to the number of available
+//! processors, and adds more workers up to the MaxThreadCount only when all workers are blocked. Parked workers
+//! above the MinThreadCount exit after the IdleTimeout.
+struct ThreadPoolConfig
+{
+  uint32_t MinThreadCount{0}; //!< Workers that never exit. They are started when the config is set.
+  uint32_t MaxThreadCount{0}; //!< Max number of workers. Zero means the bigger of 256 and the processor count.
+  std::chrono::steady_clock::duration IdleTimeout{std::chrono::seconds{20}}; //!< Parking time before a worker exits.
+
+  //! Adjust the target thread count by the measured throughput instead of keeping it equal to the processor count.
+  //! After each ControllerInterval with pending work, the controller moves the target by one thread. It keeps the
+  //! direction while the number of completed tasks grows, and reverses the direction when it drops.
+  bool UseThreadCountController{false};
+  std::chrono::steady_clock::duration ControllerInterval{std::chrono::milliseconds{500}};
+};
+
+//! State of the thread count controller for diagnostics.
+struct ThreadPoolControllerState
+{
+  bool IsEnabled{false}; //!< ThreadPoolConfig::UseThreadCountController value.
+  uint32_t ThreadCount{0}; //!< Started workers that did not exit yet.
+  uint32_t TargetThreadCount{0}; //!< Workers that the pool starts on demand without waiting for starvation.
+  uint64_t Throughput{0}; //!< Tasks per second completed in the last controller interval.
+  int32_t LastAdjustment{0}; //!< Change of the target thread count after the last controller interval.
+  uint64_t AdjustmentCount{0}; //!< Controller intervals that changed the target thread count.
+  uint32_t BlockedThreadCount{0}; //!< Workers in a DispatchBlockingScope.
+};
+
+//! Returns the current state of the thread pool thread count controller.
+ThreadPoolControllerState GetThreadPoolControllerState() noexcept;
+
+//! Start a region where the current thread blocks. Prefer using the DispatchBlockingScope.
+void BeginDispatchBlocking() noexcept;
+
+//! End the region started by BeginDispatchBlocking in the same thread.
+void EndDispatchBlocking() noexcept;
+
+//! Set the thread count limits of the thread pool. Existing workers above the new MaxThreadCount exit when they
+//! become idle. It has no effect for the platform thread pools that manage their own threads.
+void SetThreadPoolConfig(ThreadPoolConfig const& config) noexcept;
+
+//! Returns the number of processors that the process can use: the hardware concurrency limited by the CPU quota
+//! of the process cgroup on Linux. It is used as the default number of the thread pool workers.
+uint32_t GetAvailableProcessorCount() noexcept;
+
+//! Kind of an event recorded by the dispatch tracing.
+enum class DispatchTraceEventKind : uint8_t
+{
+  Post, //!< A task is added to a queue. The event id starts a flow to the TaskStart event with the same id.
+  Dequeue, //!< A queue takes a task to invoke it.
+  InvokeStart, //!< A queue starts to invoke a task and the tasks deferred by it.
+  InvokeEnd, //!< A queue completes the invocation started by the InvokeStart.
+  TaskStart, //!< A posted task starts to run. The event id ends the flow started by the Post event.
+  TaskEnd, //!< A posted task completes.
+  Defer, //!< A task is deferred to run after the current task. The event id starts a flow like the Post event.
+  Cancel, //!< A queue cancels a task.
+  FuturePost, //!< A future continuation is posted. The event id starts a flow to the FutureInvokeStart event.
+  FutureInvokeStart, //!< A future starts to run its task. The event id ends the flow started by the FuturePost.
+  FutureInvokeEnd, //!< A future completes its task.
+};
+
+//! Start recording the dispatch queue and future events of all threads. Each thread records events into its own
+//! fixed-size ring buffer without locks, and keeps only the last eventsPerThread events. It discards the events
+//! of the previous tracing.
+void StartDispatchTracing(size_t eventsPerThread = 1 << 16) noexcept;
+
+//! Stop recording the dispatch events. The recorded events are kept until the next StartDispatchTracing.
+void StopDispatchTracing() noexcept;
+
+//! True if the dispatch events are being recorded.
+bool IsDispatchTracingEnabled() noexcept;
+
+//! Record an event into the current thread ring buffer if the tracing is enabled.
+//! The id connects the Post and TaskStart, or the FuturePost and FutureInvokeStart events into a flow.
+//! The scope is the object that produces the event, e.g. a queue.
+void RecordDispatchTraceEvent(DispatchTraceEventKind kind, uint64_t id, const void* scope) noexcept;
+
+//! Returns the recorded events in the Chrome trace event JSON format that can be opened in chrome://tracing or
+//! ui.perfetto.dev. Flow arrows connect task posts with their invocations. It can be called while the tracing is
+//! enabled. Then it skips the events that other threads overwrite in their ring buffers during the call.
+std::string GetDispatchTraceJson() noexcept;
+
+namespace Details {
+
+struct IInlineDispatchTask;
+
+//! Max size of a task implementation that DispatchTask stores inline.
+constexpr size_t DispatchTaskInlineSize = 6 * sizeof(void*);
+
+} // namespace Details
+
+//! A task posted to a dispatch queue. It owns an IVoidFunctor implementation.
+//! Most of dispatch tasks implement just IVoidFunctor.
+//! They can optionally implement ICancellationListener to observe cancellation.
+//! They can implement any other interfaces if needed.
+//!
+//! DispatchTask is move-only. Small noexcept function objects are stored inline in the DispatchTask without a heap
+//! allocation. Bigger function objects and IVoidFunctor implementations are kept in ref-counted heap objects.
+//! The pointer returned by Get() is valid only until the DispatchTask is moved or destroyed.
+struct DispatchTask
+{
+private:
+  template <typename T>
+  using EnableIfIVoidFunctor = std::enable_if_t<std::is_convertible_v<T*, IVoidFunctor*>, int>;
+  template <typename T>
+  using EnableIfFunctionObject = std::enable_if_t<
+      Mso::Details::IsFunctionObject<T, void>::Value
+          && !std::is_convertible_v<Mso::Details::Decay_t<T>*, IVoidFunctor*>
+          && !Mso::Details::IsMsoFunctor<Mso::Details::Decay_t<T>>::value
+          && !std::is_same_v<Mso::Details::Decay_t<T>, DispatchTask>,
+      int>;
+
+public:
+  //! Create an empty DispatchTask.
+  DispatchTask() noexcept = default;
+
+  //! Create an empty DispatchTask.
+  _Allow_implicit_ctor_ DispatchTask(std::nullptr_t) noexcept;
+
+  //! Create DispatchTask from a function object. It is stored inline if it is noexcept, small enough, and has a
+  //! noexcept move constructor. Otherwise, it is wrapped up into a Mso::VoidFunctor.
+  template <typename TFunc, EnableIfFunctionObject<TFunc> = 0>
+  _Allow_implicit_ctor_ DispatchTask(TFunc&& func) noexcept;
+
+  //! Create DispatchTask that shares the functor implementation.
+  _Allow_implicit_ctor_ DispatchTask(const VoidFunctor& functor) noexcept;
+
+  //! Create DispatchTask that takes the functor implementation.
+  _Allow_implicit_ctor_ DispatchTask(VoidFunctor&& functor) noexcept;
+
+  //! Create DispatchTask that adds a reference to the IVoidFunctor implementation.
+  template <typename T, EnableIfIVoidFunctor<T> = 0>
+  _Allow_implicit_ctor_ DispatchTask(_In_ T* impl) noexcept;
+
+  //! Create DispatchTask that attaches to the IVoidFunctor implementation without adding a reference.
+  template <typename T, EnableIfIVoidFunctor<T> = 0>
+  DispatchTask(_In_ T* impl, Mso::AttachTagType) noexcept;
+
+  //! Create DispatchTask that shares the IVoidFunctor implementation.
+  template <typename T, EnableIfIVoidFunctor<T> = 0>
+  _Allow_implicit_ctor_ DispatchTask(const Mso::CntPtr<T>& impl) noexcept;
+
+  //! Create DispatchTask that takes the IVoidFunctor implementation.
+  template <typename T, EnableIfIVoidFunctor<T> = 0>
+  _Allow_implicit_ctor_ DispatchTask(Mso::CntPtr<T>&& impl) noexcept;
+
+  //! Create DispatchTask with an inline task implementation constructed in place.
+  //! Use Details::CanStoreInlineTask to check that TImpl fits into the DispatchTask.
+  template <typename TImpl, typename... TArgs>
+  DispatchTask(std::in_place_type_t<TImpl>, TArgs&&... args) noexcept;
+
+  DispatchTask(DispatchTask&& other) noexcept;
+  DispatchTask& operator=(DispatchTask&& other) noexcept;
+  DispatchTask& operator=(std::nullptr_t) noexcept;
+  ~DispatchTask() noexcept;
+
+  DispatchTask(const DispatchTask& other) = delete;
+  DispatchTask& operator=(const DispatchTask& other) = delete;
+
+  //! Convert to Mso::VoidFunctor that takes the task implementation. DispatchTask has no call operator to avoid
+  //! Mso::VoidFunctor wrapping it up into another function object and hiding the ICancellationListener.
+  operator VoidFunctor() && noexcept;
+
+  bool IsEmpty() const noexcept;
+  explicit operator bool() const noexcept;
+
+  //! True if the task implementation is stored inline.
+  bool IsInline() const noexcept;
+
+  IVoidFunctor* Get() const noexcept;
+
+  //! Release ownership of the task implementation. The inline implementation is moved to the heap first.
+  IVoidFunctor* Detach() noexcept;
+
+private:
+  void MoveFrom(DispatchTask& other) noexcept;
+  void Reset() noexcept;
+  Details::IInlineDispatchTask* GetInline() const noexcept;
+
+private:
+  alignas(std::max_align_t) unsigned char m_buffer[Details::DispatchTaskInlineSize];
+  IVoidFunctor* m_impl{nullptr};
+  bool m_isInline{false};
+};
+
 //! RAII class to unlock the queue local value by swapping it back with TLS variable.
 struct DispatchLocalValueGuard
 {
@@ -139,6 +417,10 @@ struct DispatchQueue
   //! running tasks.
   static DispatchQueue MakeConcurrentQueue(uint32_t maxThreads) noexcept;
 
+  //! Create a partitioned queue on top of a concurrent queue that uses up to maxThreads threads.
+  //! See MakeConcurrentQueue for the maxThreads meaning.
+  static DispatchPartitionedQueue MakePartitionedQueue(uint32_t maxThreads) noexcept;
+
   //! Create a dispatch queue on top of custom IDispatchQueueScheduler.
   //! The IDispatchQueueScheduler defines how the dispatch queue items are handled.
   static DispatchQueue MakeCustomQueue(Mso::CntPtr<IDispatchQueueScheduler>&& scheduler) noexcept;
@@ -149,6 +431,61 @@ struct DispatchQueue
   //! Post the task to the end of the queue for asynchronous invocation.
   void Post(DispatchTask&& task) const noexcept;
 
+  //! Post the task after the pending tasks of the same priority and before the pending tasks of lower priority.
+  //! The High priority tasks are also preferred by the shared thread pool over the work of other queues.
+  //! The Low and High priority tasks are not added to the current thread task batch.
+  void Post(DispatchTask&& task, DispatchPriority priority) const noexcept;
+
+  //! Post the tasks to the end of the queue in their order. The tasks are moved out of the span.
+  //! It is cheaper than posting the tasks one by one because the queue state is checked only once.
+  void PostRange(Mso::Span<DispatchTask> tasks) const noexcept;
+
+  //! Set the max number of pending tasks for TryPost and PostWhenSpace. Zero means no limit, and it is the default.
+  //! Other Post methods ignore the capacity, but their pending tasks count toward it. The queue metrics count the
+  //! tasks that they add above the capacity.
+  void SetCapacity(size_t capacity) const noexcept;
+
+  //! Post the task to the end of the queue if the number of pending tasks is below the capacity and no PostWhenSpace
+  //! tasks wait for space. Otherwise, return false without moving the task out.
+  //! After the queue shutdown, the task is canceled and it returns true as Post does.
+  [[nodiscard]] bool TryPost(DispatchTask&& task) const noexcept;
+
+  //! Post the task to the end of the queue when the number of pending tasks drops below the capacity.
+  //! The waiting tasks are posted in their order before any TryPost task. The onPosted is invoked after the task is
+  //! posted: inline if the queue has space, or in the concurrent queue if the task had to wait.
+  //! Both tasks are canceled if the queue is shut down before the task is posted.
+  //! Use Mso::PostWhenSpace from the future liblet to get a future instead of the onPosted callback.
+  void PostWhenSpace(DispatchTask&& task, DispatchTask&& onPosted) const noexcept;
+
+  //! Returns the max number of pending tasks observed right after posting a task to the queue.
+  size_t GetHighWaterMark() const noexcept;
+
+  //! Start collecting the queue metrics. The metrics cannot be disabled after that.
+  //! The counters are sharded by thread. Each posted task is wrapped to record its enqueue time, and the wrapper is
+  //! allocated on the heap. Thus, enable metrics only for the queues where this per-task allocation is acceptable.
+  void EnableMetrics() const noexcept;
+
+  //! Returns the queue metrics. The counters and histograms are zero if metrics are not enabled.
+  DispatchQueueMetrics GetMetrics() const noexcept;
+
+  //! Post the task to the end of the queue after the delay.
+  //! The task is canceled if the queue is shut down before the delay expires.
+  void PostAfter(std::chrono::steady_clock::duration delay, DispatchTask&& task) const noexcept;
+
+  //! Post the task to the end of the queue at the provided time.
+  //! The task is canceled if the queue is shut down before the time arrives.
+  void PostAt(std::chrono::steady_clock::time_point time, DispatchTask&& task) const noexcept;
+
+  //! Post the task to the end of the queue after the delay unless the returned DispatchTimer is canceled or destroyed
+  //! before that. The task is canceled if the timer is canceled or the queue is shut down before the delay expires.
+  [[nodiscard]] DispatchTimer StartTimer(std::chrono::steady_clock::duration delay, DispatchTask&& task) const noexcept;
+
+  //! Post the task to the end of the queue every period until the returned DispatchTimer is canceled or destroyed.
+  //! The next period starts after the task invocation. Thus, invocations never overlap even in concurrent queues.
+  //! The task is canceled when the timer is canceled or the queue is shut down.
+  [[nodiscard]] DispatchTimer PostPeriodic(std::chrono::steady_clock::duration period, DispatchTask&& task) const
+      noexcept;
+
   //! Invoke the task immediately if the queue uses the current thread. Otherwise, post it.
   //! The immediate execution ignores the suspend or shutdown states.
   void InvokeElsePost(DispatchTask&& task) const noexcept;
@@ -219,7 +556,7 @@ struct DispatchSuspendGuard
   //! Create empty DispatchSuspendGuard.
   DispatchSuspendGuard(std::nullptr_t = nullptr) noexcept;
 
-  //! Create new DispatchSuspendGuard with provided state.
+  //! Create new DispatchSuspendGuard with provided state. It calls IDispatchQueue::Suspend().
   DispatchSuspendGuard(Mso::CntPtr<IDispatchQueueService> const& state) noexcept;
 
   //! Copy calls IDispatchQueue::Suspend()
@@ -291,6 +628,102 @@ private:
   Mso::CntPtr<IDispatchQueueService> m_state;
 };
 
+//! Dispatch queue that invokes tasks posted with the same key in their posting order, and tasks with different keys
+//! concurrently. It is built on top of a concurrent queue. Only the keys with pending or running tasks have a state.
+//! DispatchPartitionedQueue is just a shared pointer to internal state. It is OK to copy and move.
+struct DispatchPartitionedQueue
+{
+  //! Create empty DispatchPartitionedQueue.
+  DispatchPartitionedQueue(std::nullptr_t = nullptr) noexcept;
+
+  //! Create new DispatchPartitionedQueue with provided state.
+  DispatchPartitionedQueue(Mso::CntPtr<IDispatchPartitionedQueue>&& state) noexcept;
+
+  //! True if state is not empty.
+  explicit operator bool() const noexcept;
+
+  //! Post the task after the pending tasks that have the same key.
+  //! The task is not invoked concurrently with other tasks of the same key.
+  void Post(uint64_t key, DispatchTask&& task) const noexcept;
+
+  //! Shutdown the underlying concurrent queue. All new asynchronous tasks are going to be canceled.
+  //! Pending tasks are going to be completed or canceled depending on pendingTaskAction.
+  void Shutdown(PendingTaskAction pendingTaskAction) const noexcept;
+
+  //! Waits until all pending tasks are completed after shutdown.
+  void AwaitTermination() const noexcept;
+
+private:
+  Mso::CntPtr<IDispatchPartitionedQueue> m_state;
+};
+
+//! RAII class to cancel a timer task created by DispatchQueue::StartTimer or DispatchQueue::PostPeriodic.
+//! The timer task is canceled in the destructor unless Cancel is called explicitly. It cannot be copied and only
+//! can be moved.
+struct DispatchTimer
+{
+  //! Create an invalid empty DispatchTimer.
+  DispatchTimer(std::nullptr_t = nullptr) noexcept;
+
+  //! Create new DispatchTimer that owns the provided timer.
+  DispatchTimer(Mso::CntPtr<IDispatchTimer>&& state) noexcept;
+
+  // Prohibit DispatchTimer copy.
+  DispatchTimer(DispatchTimer const& other) = delete;
+  DispatchTimer& operator=(DispatchTimer const& other) = delete;
+
+  // Allow DispatchTimer move. The move assignment cancels the current timer.
+  DispatchTimer(DispatchTimer&& other) = default;
+  DispatchTimer& operator=(DispatchTimer&& other) noexcept;
+
+  //! Cancel the timer if its state is not empty.
+  ~DispatchTimer() noexcept;
+
+  //! True if state is not empty.
+  explicit operator bool() const noexcept;
+
+  //! Cancel the timer and clear the state.
+  void Cancel() noexcept;
+
+private:
+  Mso::CntPtr<IDispatchTimer> m_state;
+};
+
+//! RAII class that marks a region where the current task blocks its thread, e.g. in a blocking system call or in
+//! FutureWait. While a thread pool worker is in the region, the thread pool starts or wakes up another worker to run
+//! the pending work, and lets one worker exit after the region ends. It does nothing in other threads.
+//! Blocking scopes can be nested. It cannot be copied or moved because it must end in the thread where it started.
+struct DispatchBlockingScope
+{
+  //! Call BeginDispatchBlocking().
+  DispatchBlockingScope() noexcept;
+
+  //! Call EndDispatchBlocking().
+  ~DispatchBlockingScope() noexcept;
+
+  // Prohibit DispatchBlockingScope copy and move.
+  DispatchBlockingScope(DispatchBlockingScope const& other) = delete;
+  DispatchBlockingScope& operator=(DispatchBlockingScope const& other) = delete;
+};
+
+#if MSO_HAS_COROUTINES
+
+//! Awaiter returned by co_await for a DispatchQueue. It resumes the coroutine in a task posted to the queue.
+//! If the queue cancels the task on shutdown, then the suspended coroutine frame is destroyed.
+struct DispatchQueueAwaiter
+{
+  bool await_ready() const noexcept;
+  void await_suspend(std::coroutine_handle<> handle) const noexcept;
+  void await_resume() const noexcept;
+
+  DispatchQueue Queue;
+};
+
+//! Switch the coroutine to the queue: co_await queue;
+DispatchQueueAwaiter operator co_await(DispatchQueue const& queue) noexcept;
+
+#endif // MSO_HAS_COROUTINES
+
 //! A dispatch queue task. The task can be either invoked or canceled.
 MSO_GUID(ICancellationListener, "ec0f1ee4-b72d-4f50-8ba2-3131aeeb3663")
 struct ICancellationListener : IUnknown
@@ -299,6 +732,29 @@ struct ICancellationListener : IUnknown
   virtual void OnCancel() noexcept = 0;
 };
 
+//! A timer that posts a task to a dispatch queue once or periodically.
+MSO_GUID(IDispatchTimer, "6f0a5e0d-8b8c-4b5e-9d7a-2c1f3e4b5a69")
+struct IDispatchTimer : IUnknown
+{
+  //! Stop posting the task and cancel it. It does nothing if a one-shot task is already posted.
+  //! It is safe to call it multiple times.
+  virtual void Cancel() noexcept = 0;
+};
+
+//! Partitioned dispatch queue state that orders tasks per key.
+MSO_GUID(IDispatchPartitionedQueue, "3e1fa956-fe0f-4791-a994-de08cd049c5a")
+struct IDispatchPartitionedQueue : IUnknown
+{
+  //! Add task to the end of the key's tasks for asynchronous invocation.
+  virtual void Post(uint64_t key, DispatchTask&& task) noexcept = 0;
+
+  //! Shutdown the underlying queue.
+  virtual void Shutdown(PendingTaskAction pendingTaskAction) noexcept = 0;
+
+  //! Waits until all pending tasks are completed after shutdown.
+  virtual void AwaitTermination() noexcept = 0;
+};
+
 //! Simple dispatch queue interface that posts tasks for asynchronous invocation.
 MSO_GUID(IDispatchQueue, "45b16d36-d4d7-4fe2-8af0-626bc39e1d3b")
 struct IDispatchQueue : IUnknown
@@ -322,8 +778,9 @@ struct IDispatchQueueScheduler : IUnknown
   //! True if queue is running on current thread or associated with it.
   virtual bool HasThreadAccess() noexcept = 0;
 
-  //! Schedule handling of dispatch queue tasks.
-  virtual void Post() noexcept = 0;
+  //! Schedule handling of the taskCount tasks added to the dispatch queue.
+  //! The scheduler should wake up only as many threads as can make progress on these tasks.
+  virtual void Post(size_t taskCount) noexcept = 0;
 
   //! Shutdown the scheduler. It initiates the shutdown process and cleans up resources.
   virtual void Shutdown() noexcept = 0;
@@ -339,6 +796,42 @@ struct IDispatchQueueService : IUnknown
   //! Add task to the end of asynchronous queue for invocation.
   virtual void Post(DispatchTask&& task) noexcept = 0;
 
+  //! Add task to the end of the asynchronous queue tasks that have the same priority.
+  virtual void PostWithPriority(DispatchTask&& task, DispatchPriority priority) noexcept = 0;
+
+  //! Add tasks to the end of asynchronous queue for invocation. The tasks are moved out of the span.
+  virtual void PostRange(Mso::Span<DispatchTask> tasks) noexcept = 0;
+
+  //! Set the max number of pending tasks for TryPost and PostWhenSpace. Zero means no limit.
+  virtual void SetCapacity(size_t capacity) noexcept = 0;
+
+  //! Add task to the end of asynchronous queue if it is below the capacity. The task is not moved out on failure.
+  virtual bool TryPost(DispatchTask&& task) noexcept = 0;
+
+  //! Add task to the end of asynchronous queue when it is below the capacity, and then invoke or post onPosted.
+  virtual void PostWhenSpace(DispatchTask&& task, DispatchTask&& onPosted) noexcept = 0;
+
+  //! Returns the max number of pending tasks observed after adding a task.
+  virtual size_t GetHighWaterMark() noexcept = 0;
+
+  //! Start collecting the queue metrics.
+  virtual void EnableMetrics() noexcept = 0;
+
+  //! Returns the queue metrics.
+  virtual DispatchQueueMetrics GetMetrics() noexcept = 0;
+
+  //! Add task to the end of asynchronous queue when the time arrives.
+  //! The task is canceled if the returned timer is canceled or the queue is shut down before the time arrives.
+  virtual Mso::CntPtr<IDispatchTimer> PostAt(
+      std::chrono::steady_clock::time_point time,
+      DispatchTask&& task) noexcept = 0;
+
+  //! Add task to the end of asynchronous queue every period after the previous invocation completes.
+  //! The task is canceled when the returned timer is canceled or the queue is shut down.
+  virtual Mso::CntPtr<IDispatchTimer> PostPeriodic(
+      std::chrono::steady_clock::duration period,
+      DispatchTask&& task) noexcept = 0;
+
   //! Invoke the task immediately if the queue uses the current thread. Otherwise, post it.
   //! The immediate execution ignores the suspend or shutdown states.
   virtual void InvokeElsePost(DispatchTask&& task) noexcept = 0;
@@ -402,6 +895,9 @@ struct IDispatchQueueService : IUnknown
   //! Returns true if the queue has tasks to invoke.
   virtual bool HasTasks() noexcept = 0;
 
+  //! Returns true if the queue has High priority tasks to invoke.
+  virtual bool HasHighPriorityTasks() noexcept = 0;
+
   //! Try to dequeue a task from dispatch queue for processing. It returns true if task is not empty.
   virtual bool TryDequeTask(/*out*/ DispatchTask& task) noexcept = 0;
 
@@ -449,11 +945,19 @@ struct IDispatchQueueStatic : IUnknown
   //! running tasks.
   virtual DispatchQueue MakeConcurrentQueue(uint32_t maxThreads) noexcept = 0;
 
+  //! Create a partitioned queue on top of a concurrent queue that uses up to maxThreads threads.
+  virtual DispatchPartitionedQueue MakePartitionedQueue(uint32_t maxThreads) noexcept = 0;
+
   //! Create a dispatch queue on top of custom IDispatchQueueScheduler.
   //! The IDispatchQueueScheduler defines how the dispatch queue items are handled.
   virtual DispatchQueue MakeCustomQueue(Mso::CntPtr<IDispatchQueueScheduler>&& scheduler) noexcept = 0;
 };
 
+namespace Details {
+template <typename TInvoke, typename TOnCancel>
+struct InlineDispatchTaskImpl;
+} // namespace Details
+
 //! DispatchTask implementation based on invoke and cancel function objects.
 template <typename TInvoke, typename TOnCancel>
 struct DispatchTaskImpl final : Mso::UnknownObject<Mso::QueryCastHidden<Mso::IVoidFunctor>, Mso::ICancellationListener>
@@ -466,6 +970,8 @@ struct DispatchTaskImpl final : Mso::UnknownObject<Mso::QueryCastHidden<Mso::IVo
   void OnCancel() noexcept override;
 
 private:
+  friend struct Details::InlineDispatchTaskImpl<TInvoke, TOnCancel>; // To carry over m_isCalled in MoveToHeap.
+
   TInvoke m_invoke;
   TOnCancel m_onCancel;
   std::atomic<bool> m_isCalled{false};
@@ -485,6 +991,69 @@ private:
   TInvoke m_invoke;
 };
 
+namespace Details {
+
+//! Task implementation stored inline in the DispatchTask.
+//! It is not ref-counted: the owning DispatchTask moves and destroys it.
+struct DECLSPEC_NOVTABLE IInlineDispatchTask : IVoidFunctor
+{
+  //! Move the implementation to the buffer of another DispatchTask and destroy this instance.
+  virtual IVoidFunctor* MoveTo(void* buffer) noexcept = 0;
+
+  //! Move the implementation to a new ref-counted heap object and destroy this instance.
+  virtual IVoidFunctor* MoveToHeap() noexcept = 0;
+
+  //! Destroy this instance without releasing its memory.
+  virtual void Destroy() noexcept = 0;
+};
+
+//! True if the inline task implementation fits into the DispatchTask buffer and its function objects can be moved
+//! between DispatchTask instances without throwing.
+template <typename TImpl, typename... TFuncs>
+constexpr bool CanStoreInlineTask = sizeof(TImpl) <= DispatchTaskInlineSize
+    && alignof(TImpl) <= alignof(std::max_align_t) && (std::is_nothrow_move_constructible_v<TFuncs> && ...);
+
+//! Inline task implementation that calls a function object.
+template <typename TFunc>
+struct InlineFunctorTask final : Mso::UnknownObject<Mso::RefCountStrategy::NoRefCountNoQuery, IInlineDispatchTask>
+{
+  template <typename TFuncArg>
+  InlineFunctorTask(TFuncArg&& func) noexcept;
+
+  void Invoke() noexcept override;
+  IVoidFunctor* MoveTo(void* buffer) noexcept override;
+  IVoidFunctor* MoveToHeap() noexcept override;
+  void Destroy() noexcept override;
+
+private:
+  TFunc m_func;
+};
+
+//! Inline version of the DispatchTaskImpl created by MakeDispatchTask.
+template <typename TInvoke, typename TOnCancel>
+struct InlineDispatchTaskImpl final : Mso::UnknownObject<
+                                          Mso::RefCountStrategy::NoRefCount,
+                                          Mso::QueryCastHidden<IInlineDispatchTask>,
+                                          Mso::ICancellationListener>
+{
+  template <typename TInvokeArg, typename TOnCancelArg>
+  InlineDispatchTaskImpl(TInvokeArg&& invoke, TOnCancelArg&& onCancel) noexcept;
+  ~InlineDispatchTaskImpl() noexcept;
+
+  void Invoke() noexcept override;
+  void OnCancel() noexcept override;
+  IVoidFunctor* MoveTo(void* buffer) noexcept override;
+  IVoidFunctor* MoveToHeap() noexcept override;
+  void Destroy() noexcept override;
+
+private:
+  TInvoke m_invoke;
+  TOnCancel m_onCancel;
+  bool m_isCalled{false};
+};
+
+} // namespace Details
+
 //=============================================================================
 // Standalone inline implementations
 //=============================================================================
@@ -515,18 +1084,192 @@ void SwapQueueLocalValue(void** localValue, void* tlsValue) noexcept
 }
 
 template <typename TInvoke, typename TOnCancel>
-inline Mso::VoidFunctor MakeDispatchTask(TInvoke&& invoke, TOnCancel&& onCancel) noexcept
+inline DispatchTask MakeDispatchTask(TInvoke&& invoke, TOnCancel&& onCancel) noexcept
 {
-  using DispatchTaskType = DispatchTaskImpl<std::decay_t<TInvoke>, std::decay_t<TOnCancel>>;
-  return Mso::VoidFunctor(
-      Mso::Make<DispatchTaskType, IVoidFunctor>(std::forward<TInvoke>(invoke), std::forward<TOnCancel>(onCancel)));
+  using InvokeType = std::decay_t<TInvoke>;
+  using OnCancelType = std::decay_t<TOnCancel>;
+  using InlineDispatchTaskType = Details::InlineDispatchTaskImpl<InvokeType, OnCancelType>;
+  if constexpr (Details::CanStoreInlineTask<InlineDispatchTaskType, InvokeType, OnCancelType>)
+  {
+    return DispatchTask{
+        std::in_place_type<InlineDispatchTaskType>, std::forward<TInvoke>(invoke), std::forward<TOnCancel>(onCancel)};
+  }
+  else
+  {
+    using DispatchTaskType = DispatchTaskImpl<InvokeType, OnCancelType>;
+    return DispatchTask{
+        Mso::Make<DispatchTaskType, IVoidFunctor>(std::forward<TInvoke>(invoke), std::forward<TOnCancel>(onCancel))};
+  }
 }
 
 template <typename TInvoke>
-inline Mso::VoidFunctor MakeDispatchCleanupTask(TInvoke&& invoke) noexcept
+inline DispatchTask MakeDispatchCleanupTask(TInvoke&& invoke) noexcept
 {
   using DispatchCleanupTaskType = DispatchCleanupTaskImpl<std::decay_t<TInvoke>>;
-  return Mso::VoidFunctor(Mso::Make<DispatchCleanupTaskType, IVoidFunctor>(std::forward<TInvoke>(invoke)));
+  return DispatchTask{Mso::Make<DispatchCleanupTaskType, IVoidFunctor>(std::forward<TInvoke>(invoke))};
+}
+
+//=============================================================================
+// DispatchTask inline implementation
+//=============================================================================
+
+inline DispatchTask::DispatchTask(std::nullptr_t) noexcept {}
+
+template <typename TFunc, DispatchTask::EnableIfFunctionObject<TFunc>>
+inline DispatchTask::DispatchTask(TFunc&& func) noexcept
+{
+  using FuncType = Mso::Details::Decay_t<TFunc>;
+  using InlineTaskType = Details::InlineFunctorTask<FuncType>;
+  if constexpr (
+      Mso::Details::IsNoExceptFunctionObject<TFunc>::Value && Details::CanStoreInlineTask<InlineTaskType, FuncType>)
+  {
+    m_impl = ::new (static_cast<void*>(m_buffer)) InlineTaskType{std::forward<TFunc>(func)};
+    m_isInline = true;
+  }
+  else
+  {
+    m_impl = VoidFunctor{std::forward<TFunc>(func)}.Detach();
+  }
+}
+
+inline DispatchTask::DispatchTask(const VoidFunctor& functor) noexcept : m_impl{functor.Get()}
+{
+  if (m_impl)
+  {
+    m_impl->AddRef();
+  }
+}
+
+inline DispatchTask::DispatchTask(VoidFunctor&& functor) noexcept : m_impl{functor.Detach()} {}
+
+template <typename T, DispatchTask::EnableIfIVoidFunctor<T>>
+inline DispatchTask::DispatchTask(_In_ T* impl) noexcept : m_impl{impl}
+{
+  if (m_impl)
+  {
+    m_impl->AddRef();
+  }
+}
+
+template <typename T, DispatchTask::EnableIfIVoidFunctor<T>>
+inline DispatchTask::DispatchTask(_In_ T* impl, Mso::AttachTagType) noexcept : m_impl{impl}
+{
+}
+
+template <typename T, DispatchTask::EnableIfIVoidFunctor<T>>
+inline DispatchTask::DispatchTask(const Mso::CntPtr<T>& impl) noexcept : DispatchTask{impl.Get()}
+{
+}
+
+template <typename T, DispatchTask::EnableIfIVoidFunctor<T>>
+inline DispatchTask::DispatchTask(Mso::CntPtr<T>&& impl) noexcept : m_impl{impl.Detach()}
+{
+}
+
+template <typename TImpl, typename... TArgs>
+inline DispatchTask::DispatchTask(std::in_place_type_t<TImpl>, TArgs&&... args) noexcept
+    : m_impl{::new (static_cast<void*>(m_buffer)) TImpl{std::forward<TArgs>(args)...}}, m_isInline{true}
+{
+  static_assert(Details::CanStoreInlineTask<TImpl>, "Task implementation does not fit into DispatchTask");
+}
+
+inline DispatchTask::DispatchTask(DispatchTask&& other) noexcept
+{
+  MoveFrom(other);
+}
+
+inline DispatchTask& DispatchTask::operator=(DispatchTask&& other) noexcept
+{
+  if (this != &other)
+  {
+    Reset();
+    MoveFrom(other);
+  }
+
+  return *this;
+}
+
+inline DispatchTask& DispatchTask::operator=(std::nullptr_t) noexcept
+{
+  Reset();
+  return *this;
+}
+
+inline DispatchTask::~DispatchTask() noexcept
+{
+  Reset();
+}
+
+inline DispatchTask::operator VoidFunctor() && noexcept
+{
+  return VoidFunctor{Detach(), AttachTag};
+}
+
+inline bool DispatchTask::IsEmpty() const noexcept
+{
+  return m_impl == nullptr;
+}
+
+inline DispatchTask::operator bool() const noexcept
+{
+  return m_impl != nullptr;
+}
+
+inline bool DispatchTask::IsInline() const noexcept
+{
+  return m_isInline;
+}
+
+inline IVoidFunctor* DispatchTask::Get() const noexcept
+{
+  return m_impl;
+}
+
+inline IVoidFunctor* DispatchTask::Detach() noexcept
+{
+  if (m_isInline)
+  {
+    m_impl = GetInline()->MoveToHeap();
+    m_isInline = false;
+  }
+
+  return std::exchange(m_impl, nullptr);
+}
+
+inline void DispatchTask::MoveFrom(DispatchTask& other) noexcept
+{
+  if (other.m_isInline)
+  {
+    m_impl = other.GetInline()->MoveTo(m_buffer);
+    m_isInline = true;
+    other.m_isInline = false;
+    other.m_impl = nullptr;
+  }
+  else
+  {
+    m_impl = std::exchange(other.m_impl, nullptr);
+  }
+}
+
+inline void DispatchTask::Reset() noexcept
+{
+  if (IVoidFunctor* impl = std::exchange(m_impl, nullptr))
+  {
+    if (m_isInline)
+    {
+      m_isInline = false;
+      static_cast<Details::IInlineDispatchTask*>(impl)->Destroy();
+    }
+    else
+    {
+      impl->Release();
+    }
+  }
+}
+
+inline Details::IInlineDispatchTask* DispatchTask::GetInline() const noexcept
+{
+  return static_cast<Details::IInlineDispatchTask*>(m_impl);
 }
 
 //=============================================================================
@@ -600,6 +1343,11 @@ inline /*static*/ DispatchQueue DispatchQueue::MakeConcurrentQueue(uint32_t maxT
   return IDispatchQueueStatic::Instance()->MakeConcurrentQueue(maxThreads);
 }
 
+inline /*static*/ DispatchPartitionedQueue DispatchQueue::MakePartitionedQueue(uint32_t maxThreads) noexcept
+{
+  return IDispatchQueueStatic::Instance()->MakePartitionedQueue(maxThreads);
+}
+
 inline /*static*/ DispatchQueue DispatchQueue::MakeCustomQueue(
     Mso::CntPtr<IDispatchQueueScheduler>&& scheduler) noexcept
 {
@@ -616,6 +1364,68 @@ inline void DispatchQueue::Post(DispatchTask&& task) const noexcept
   m_state->Post(std::move(task));
 }
 
+inline void DispatchQueue::Post(DispatchTask&& task, DispatchPriority priority) const noexcept
+{
+  m_state->PostWithPriority(std::move(task), priority);
+}
+
+inline void DispatchQueue::PostRange(Mso::Span<DispatchTask> tasks) const noexcept
+{
+  m_state->PostRange(tasks);
+}
+
+inline void DispatchQueue::SetCapacity(size_t capacity) const noexcept
+{
+  m_state->SetCapacity(capacity);
+}
+
+inline bool DispatchQueue::TryPost(DispatchTask&& task) const noexcept
+{
+  return m_state->TryPost(std::move(task));
+}
+
+inline void DispatchQueue::PostWhenSpace(DispatchTask&& task, DispatchTask&& onPosted) const noexcept
+{
+  m_state->PostWhenSpace(std::move(task), std::move(onPosted));
+}
+
+inline size_t DispatchQueue::GetHighWaterMark() const noexcept
+{
+  return m_state->GetHighWaterMark();
+}
+
+inline void DispatchQueue::EnableMetrics() const noexcept
+{
+  m_state->EnableMetrics();
+}
+
+inline DispatchQueueMetrics DispatchQueue::GetMetrics() const noexcept
+{
+  return m_state->GetMetrics();
+}
+
+inline void DispatchQueue::PostAfter(std::chrono::steady_clock::duration delay, DispatchTask&& task) const noexcept
+{
+  m_state->PostAt(std::chrono::steady_clock::now() + delay, std::move(task));
+}
+
+inline void DispatchQueue::PostAt(std::chrono::steady_clock::time_point time, DispatchTask&& task) const noexcept
+{
+  m_state->PostAt(time, std::move(task));
+}
+
+inline DispatchTimer DispatchQueue::StartTimer(std::chrono::steady_clock::duration delay, DispatchTask&& task) const
+    noexcept
+{
+  return DispatchTimer{m_state->PostAt(std::chrono::steady_clock::now() + delay, std::move(task))};
+}
+
+inline DispatchTimer DispatchQueue::PostPeriodic(std::chrono::steady_clock::duration period, DispatchTask&& task) const
+    noexcept
+{
+  return DispatchTimer{m_state->PostPeriodic(period, std::move(task))};
+}
+
 inline void DispatchQueue::InvokeElsePost(DispatchTask&& task) const noexcept
 {
   m_state->InvokeElsePost(std::move(task));
@@ -698,6 +1508,10 @@ inline DispatchSuspendGuard::DispatchSuspendGuard(std::nullptr_t) noexcept {}
 inline DispatchSuspendGuard::DispatchSuspendGuard(Mso::CntPtr<IDispatchQueueService> const& state) noexcept
     : m_state{state}
 {
+  if (m_state)
+  {
+    m_state->Suspend();
+  }
 }
 
 inline DispatchSuspendGuard::DispatchSuspendGuard(DispatchSuspendGuard const& other) noexcept : m_state{other.m_state}
@@ -790,6 +1604,117 @@ inline void DispatchTaskBatch::Cancel() noexcept
   }
 }
 
+//=============================================================================
+// DispatchPartitionedQueue inline implementation
+//=============================================================================
+
+inline DispatchPartitionedQueue::DispatchPartitionedQueue(std::nullptr_t) noexcept {}
+
+inline DispatchPartitionedQueue::DispatchPartitionedQueue(Mso::CntPtr<IDispatchPartitionedQueue>&& state) noexcept
+    : m_state{std::move(state)}
+{
+}
+
+inline DispatchPartitionedQueue::operator bool() const noexcept
+{
+  return m_state != nullptr;
+}
+
+inline void DispatchPartitionedQueue::Post(uint64_t key, DispatchTask&& task) const noexcept
+{
+  m_state->Post(key, std::move(task));
+}
+
+inline void DispatchPartitionedQueue::Shutdown(PendingTaskAction pendingTaskAction) const noexcept
+{
+  m_state->Shutdown(pendingTaskAction);
+}
+
+inline void DispatchPartitionedQueue::AwaitTermination() const noexcept
+{
+  m_state->AwaitTermination();
+}
+
+//=============================================================================
+// DispatchTimer inline implementation
+//=============================================================================
+
+inline DispatchTimer::DispatchTimer(std::nullptr_t) noexcept {}
+
+inline DispatchTimer::DispatchTimer(Mso::CntPtr<IDispatchTimer>&& state) noexcept : m_state{std::move(state)} {}
+
+inline DispatchTimer& DispatchTimer::operator=(DispatchTimer&& other) noexcept
+{
+  if (this != &other)
+  {
+    Cancel();
+    m_state = std::move(other.m_state);
+  }
+
+  return *this;
+}
+
+inline DispatchTimer::~DispatchTimer() noexcept
+{
+  if (m_state)
+  {
+    m_state->Cancel();
+  }
+}
+
+inline DispatchTimer::operator bool() const noexcept
+{
+  return m_state != nullptr;
+}
+
+inline void DispatchTimer::Cancel() noexcept
+{
+  if (m_state)
+  {
+    m_state->Cancel();
+    m_state = nullptr;
+  }
+}
+
+//=============================================================================
+// DispatchBlockingScope inline implementation
+//=============================================================================
+
+inline DispatchBlockingScope::DispatchBlockingScope() noexcept
+{
+  BeginDispatchBlocking();
+}
+
+inline DispatchBlockingScope::~DispatchBlockingScope() noexcept
+{
+  EndDispatchBlocking();
+}
+
+#if MSO_HAS_COROUTINES
+
+//=============================================================================
+// DispatchQueueAwaiter inline implementation
+//=============================================================================
+
+inline bool DispatchQueueAwaiter::await_ready() const noexcept
+{
+  return false;
+}
+
+inline void DispatchQueueAwaiter::await_suspend(std::coroutine_handle<> handle) const noexcept
+{
+  Queue.Post(MakeDispatchTask([handle]() noexcept { handle.resume(); }, [handle]() noexcept { handle.destroy(); }));
+}
+
+inline void DispatchQueueAwaiter::await_resume() const noexcept {}
+
+inline DispatchQueueAwaiter operator co_await(DispatchQueue const& queue) noexcept
+{
+  return DispatchQueueAwaiter{queue};
+}
+
+#endif // MSO_HAS_COROUTINES
+
 //=============================================================================
 // DispatchTaskImpl inline implementation
 //=============================================================================
@@ -881,6 +1806,124 @@ inline void DispatchCleanupTaskImpl<TInvoke>::OnCancel() noexcept
   }
 }
 
+//=============================================================================
+// InlineFunctorTask inline implementation
+//=============================================================================
+
+namespace Details {
+
+template <typename TFunc>
+template <typename TFuncArg>
+inline InlineFunctorTask<TFunc>::InlineFunctorTask(TFuncArg&& func) noexcept : m_func{std::forward<TFuncArg>(func)}
+{
+}
+
+template <typename TFunc>
+inline void InlineFunctorTask<TFunc>::Invoke() noexcept
+{
+  m_func();
+}
+
+template <typename TFunc>
+inline IVoidFunctor* InlineFunctorTask<TFunc>::MoveTo(void* buffer) noexcept
+{
+  IVoidFunctor* result = ::new (buffer) InlineFunctorTask{std::move(m_func)};
+  Destroy();
+  return result;
+}
+
+template <typename TFunc>
+inline IVoidFunctor* InlineFunctorTask<TFunc>::MoveToHeap() noexcept
+{
+  IVoidFunctor* result = VoidFunctor{std::move(m_func)}.Detach();
+  Destroy();
+  return result;
+}
+
+template <typename TFunc>
+inline void InlineFunctorTask<TFunc>::Destroy() noexcept
+{
+  this->~InlineFunctorTask();
+}
+
+//=============================================================================
+// InlineDispatchTaskImpl inline implementation
+//=============================================================================
+
+template <typename TInvoke, typename TOnCancel>
+template <typename TInvokeArg, typename TOnCancelArg>
+inline InlineDispatchTaskImpl<TInvoke, TOnCancel>::InlineDispatchTaskImpl(
+    TInvokeArg&& invoke, TOnCancelArg&& onCancel) noexcept
+    : m_invoke{std::forward<TInvokeArg>(invoke)}, m_onCancel{std::forward<TOnCancelArg>(onCancel)}
+{
+}
+
+template <typename TInvoke, typename TOnCancel>
+inline InlineDispatchTaskImpl<TInvoke, TOnCancel>::~InlineDispatchTaskImpl() noexcept
+{
+  if (!m_isCalled)
+  {
+    m_onCancel();
+  }
+}
+
+template <typename TInvoke, typename TOnCancel>
+inline void InlineDispatchTaskImpl<TInvoke, TOnCancel>::Invoke() noexcept
+{
+  if constexpr (std::is_nothrow_invocable_r_v<void, decltype(m_invoke)>)
+  {
+    m_invoke();
+    m_isCalled = true;
+  }
+  else
+  {
+    MustBeNoExceptVoidFunctor<decltype(m_invoke)>();
+  }
+}
+
+template <typename TInvoke, typename TOnCancel>
+inline void InlineDispatchTaskImpl<TInvoke, TOnCancel>::OnCancel() noexcept
+{
+  if constexpr (std::is_nothrow_invocable_r_v<void, decltype(m_onCancel)>)
+  {
+    m_onCancel();
+    m_isCalled = true;
+  }
+  else
+  {
+    MustBeNoExceptVoidFunctor<decltype(m_onCancel)>();
+  }
+}
+
+template <typename TInvoke, typename TOnCancel>
+inline IVoidFunctor* InlineDispatchTaskImpl<TInvoke, TOnCancel>::MoveTo(void* buffer) noexcept
+{
+  auto result = ::new (buffer) InlineDispatchTaskImpl{std::move(m_invoke), std::move(m_onCancel)};
+  result->m_isCalled = m_isCalled;
+  m_isCalled = true; // The moved-from instance must not call m_onCancel.
+  Destroy();
+  return result;
+}
+
+template <typename TInvoke, typename TOnCancel>
+inline IVoidFunctor* InlineDispatchTaskImpl<TInvoke, TOnCancel>::MoveToHeap() noexcept
+{
+  using DispatchTaskType = DispatchTaskImpl<TInvoke, TOnCancel>;
+  Mso::CntPtr<DispatchTaskType> result = Mso::Make<DispatchTaskType>(std::move(m_invoke), std::move(m_onCancel));
+  result->m_isCalled = m_isCalled;
+  m_isCalled = true; // The moved-from instance must not call m_onCancel.
+  Destroy();
+  return static_cast<IVoidFunctor*>(result.Detach());
+}
+
+template <typename TInvoke, typename TOnCancel>
+inline void InlineDispatchTaskImpl<TInvoke, TOnCancel>::Destroy() noexcept
+{
+  this->~InlineDispatchTaskImpl();
+}
+
+} // namespace Details
+
 } // namespace Mso
 
 #endif // MSO_DISPATCHQUEUE_DISPATCHQUEUE_H
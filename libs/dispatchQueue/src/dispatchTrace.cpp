@@ -0,0 +1,360 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "dispatchTrace.h"
+#include <atomic>
+#include <cinttypes>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace Mso {
+
+namespace {
+
+//! An event recorded in a TraceBuffer.
+struct TraceEvent
+{
+  std::chrono::steady_clock::time_point Time;
+  uint64_t Id;
+  const void* Scope;
+  DispatchTraceEventKind Kind;
+};
+
+//! A TraceBuffer slot that GetJson may read while the owning thread overwrites it.
+//! It is a sequence lock: the Sequence is odd while the event at the index is written, and it is 2 * (index + 1)
+//! after it is written. A reader skips the slot if the Sequence does not match the index before and after the read.
+struct TraceSlot
+{
+  std::atomic<uint64_t> Sequence{0};
+  std::atomic<std::chrono::steady_clock::rep> Time{0};
+  std::atomic<uint64_t> Id{0};
+  std::atomic<const void*> Scope{nullptr};
+  std::atomic<DispatchTraceEventKind> Kind{DispatchTraceEventKind::Post};
+};
+
+//! Ring buffer of the events recorded by one thread.
+//! Only the owning thread writes events. It publishes them by the WriteCount release store.
+struct TraceBuffer
+{
+  TraceBuffer(uint32_t threadIndex, uint64_t session, size_t capacity) noexcept
+      : ThreadIndex{threadIndex}, Session{session}, Slots(capacity)
+  {
+  }
+
+  void Add(DispatchTraceEventKind kind, uint64_t id, const void* scope) noexcept
+  {
+    uint64_t writeCount = WriteCount.load(std::memory_order_relaxed);
+    TraceSlot& slot = Slots[writeCount % Slots.size()];
+    slot.Sequence.store(2 * writeCount + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.Time.store(std::chrono::steady_clock::now().time_since_epoch().count(), std::memory_order_relaxed);
+    slot.Id.store(id, std::memory_order_relaxed);
+    slot.Scope.store(scope, std::memory_order_relaxed);
+    slot.Kind.store(kind, std::memory_order_relaxed);
+    slot.Sequence.store(2 * writeCount + 2, std::memory_order_release);
+    WriteCount.store(writeCount + 1, std::memory_order_release);
+  }
+
+  //! Read the event with the index. Returns false if the owning thread has overwritten it.
+  bool TryGet(uint64_t index, /*out*/ TraceEvent& event) const noexcept
+  {
+    const TraceSlot& slot = Slots[index % Slots.size()];
+    uint64_t sequence = 2 * index + 2;
+    if (slot.Sequence.load(std::memory_order_acquire) != sequence)
+    {
+      return false;
+    }
+
+    event.Time = std::chrono::steady_clock::time_point{
+        std::chrono::steady_clock::duration{slot.Time.load(std::memory_order_relaxed)}};
+    event.Id = slot.Id.load(std::memory_order_relaxed);
+    event.Scope = slot.Scope.load(std::memory_order_relaxed);
+    event.Kind = slot.Kind.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return slot.Sequence.load(std::memory_order_relaxed) == sequence;
+  }
+
+  const uint32_t ThreadIndex;
+  const uint64_t Session;
+  std::vector<TraceSlot> Slots;
+  std::atomic<uint64_t> WriteCount{0};
+};
+
+//! The process wide dispatch tracing state.
+//!
+//! The tracing session starts with StartDispatchTracing. A thread registers its buffer under the mutex when it
+//! records the first event in the session. After that it records events without locks. The registered buffers stay
+//! alive until the next session starts, even if their threads exit, to keep their events for GetDispatchTraceJson.
+//! GetJson may run while threads record events: it skips the events that their threads overwrite during the read.
+struct DispatchTracer
+{
+  static DispatchTracer& Instance() noexcept
+  {
+    static DispatchTracer s_instance;
+    return s_instance;
+  }
+
+  void Start(size_t eventsPerThread) noexcept
+  {
+    VerifyElseCrashSz(eventsPerThread > 0, "The trace buffer must have at least one event");
+    std::lock_guard lock{m_mutex};
+    m_buffers.clear();
+    m_capacity = eventsPerThread;
+    m_startTime = std::chrono::steady_clock::now();
+    m_session.fetch_add(1, std::memory_order_release);
+    m_isEnabled.store(true, std::memory_order_release);
+  }
+
+  void Stop() noexcept
+  {
+    m_isEnabled.store(false, std::memory_order_release);
+  }
+
+  bool IsEnabled() const noexcept
+  {
+    return m_isEnabled.load(std::memory_order_relaxed);
+  }
+
+  uint64_t NextFlowId() noexcept
+  {
+    return m_nextFlowId.fetch_add(1, std::memory_order_relaxed) + 1;
+  }
+
+  void Record(DispatchTraceEventKind kind, uint64_t id, const void* scope) noexcept
+  {
+    if (!IsEnabled())
+    {
+      return;
+    }
+
+    TraceBuffer* buffer = tls_buffer.get();
+    if (!buffer || buffer->Session != m_session.load(std::memory_order_acquire))
+    {
+      buffer = RegisterThreadBuffer();
+    }
+
+    buffer->Add(kind, id, scope);
+  }
+
+  std::string GetJson() noexcept
+  {
+    std::lock_guard lock{m_mutex};
+    std::string json{"{\"traceEvents\":["};
+    bool isFirst{true};
+    for (const auto& buffer : m_buffers)
+    {
+      uint64_t writeCount = buffer->WriteCount.load(std::memory_order_acquire);
+      size_t capacity = buffer->Slots.size();
+      for (uint64_t i = writeCount > capacity ? writeCount - capacity : 0; i < writeCount; ++i)
+      {
+        TraceEvent event;
+        if (buffer->TryGet(i, /*out*/ event))
+        {
+          AppendEvent(json, event, buffer->ThreadIndex, /*ref*/ isFirst);
+        }
+      }
+    }
+
+    json += "],\"displayTimeUnit\":\"ns\"}";
+    return json;
+  }
+
+private:
+  TraceBuffer* RegisterThreadBuffer() noexcept
+  {
+    std::lock_guard lock{m_mutex};
+    auto buffer = std::make_shared<TraceBuffer>(
+        static_cast<uint32_t>(m_buffers.size() + 1), m_session.load(std::memory_order_relaxed), m_capacity);
+    m_buffers.push_back(buffer);
+    tls_buffer = std::move(buffer);
+    return tls_buffer.get();
+  }
+
+  void AppendEvent(std::string& json, const TraceEvent& event, uint32_t threadIndex, bool& isFirst) const noexcept
+  {
+    double ts = std::chrono::duration<double, std::micro>(event.Time - m_startTime).count();
+    switch (event.Kind)
+    {
+      case DispatchTraceEventKind::Post:
+        AppendSpan(json, isFirst, "Post", "X", ts, threadIndex, event.Scope);
+        AppendFlow(json, isFirst, "Task", "dispatch", "s", ts, threadIndex, event.Id);
+        break;
+      case DispatchTraceEventKind::Dequeue:
+        AppendSpan(json, isFirst, "Dequeue", "i", ts, threadIndex, event.Scope);
+        break;
+      case DispatchTraceEventKind::InvokeStart:
+        AppendSpan(json, isFirst, "Invoke", "B", ts, threadIndex, event.Scope);
+        break;
+      case DispatchTraceEventKind::InvokeEnd:
+        AppendSpan(json, isFirst, "Invoke", "E", ts, threadIndex, event.Scope);
+        break;
+      case DispatchTraceEventKind::TaskStart:
+        AppendSpan(json, isFirst, "Task", "B", ts, threadIndex, event.Scope);
+        AppendFlow(json, isFirst, "Task", "dispatch", "f", ts, threadIndex, event.Id);
+        break;
+      case DispatchTraceEventKind::TaskEnd:
+        AppendSpan(json, isFirst, "Task", "E", ts, threadIndex, event.Scope);
+        break;
+      case DispatchTraceEventKind::Defer:
+        AppendSpan(json, isFirst, "Defer", "X", ts, threadIndex, event.Scope);
+        AppendFlow(json, isFirst, "Task", "dispatch", "s", ts, threadIndex, event.Id);
+        break;
+      case DispatchTraceEventKind::Cancel:
+        AppendSpan(json, isFirst, "Cancel", "i", ts, threadIndex, event.Scope);
+        break;
+      case DispatchTraceEventKind::FuturePost:
+        AppendSpan(json, isFirst, "FuturePost", "X", ts, threadIndex, event.Scope);
+        AppendFlow(json, isFirst, "Future", "future", "s", ts, threadIndex, event.Id);
+        break;
+      case DispatchTraceEventKind::FutureInvokeStart:
+        AppendSpan(json, isFirst, "Future", "B", ts, threadIndex, event.Scope);
+        AppendFlow(json, isFirst, "Future", "future", "f", ts, threadIndex, event.Id);
+        break;
+      case DispatchTraceEventKind::FutureInvokeEnd:
+        AppendSpan(json, isFirst, "Future", "E", ts, threadIndex, event.Scope);
+        break;
+    }
+  }
+
+  // The instant and zero duration events let the flow start events bind to them.
+  static void AppendSpan(
+      std::string& json,
+      bool& isFirst,
+      const char* name,
+      const char* phase,
+      double ts,
+      uint32_t threadIndex,
+      const void* scope) noexcept
+  {
+    char buffer[256];
+    std::snprintf(
+        buffer,
+        sizeof(buffer),
+        "%s{\"name\":\"%s\",\"cat\":\"dispatch\",\"ph\":\"%s\",\"ts\":%.3f,\"pid\":1,\"tid\":%" PRIu32 "%s"
+        ",\"args\":{\"scope\":\"%p\"}}",
+        isFirst ? "" : ",",
+        name,
+        phase,
+        ts,
+        threadIndex,
+        phase[0] == 'X' ? ",\"dur\":0" : (phase[0] == 'i' ? ",\"s\":\"t\"" : ""),
+        scope);
+    json += buffer;
+    isFirst = false;
+  }
+
+  // The flow end events bind to the enclosing slice that starts at the same time.
+  static void AppendFlow(
+      std::string& json,
+      bool& isFirst,
+      const char* name,
+      const char* category,
+      const char* phase,
+      double ts,
+      uint32_t threadIndex,
+      uint64_t id) noexcept
+  {
+    char buffer[256];
+    std::snprintf(
+        buffer,
+        sizeof(buffer),
+        "%s{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"%s\",\"ts\":%.3f,\"pid\":1,\"tid\":%" PRIu32
+        ",\"id\":\"0x%" PRIx64 "\"%s}",
+        isFirst ? "" : ",",
+        name,
+        category,
+        phase,
+        ts,
+        threadIndex,
+        id,
+        phase[0] == 'f' ? ",\"bp\":\"e\"" : "");
+    json += buffer;
+    isFirst = false;
+  }
+
+private:
+  static thread_local std::shared_ptr<TraceBuffer> tls_buffer;
+
+  std::atomic<bool> m_isEnabled{false};
+  std::atomic<uint64_t> m_session{0};
+  std::atomic<uint64_t> m_nextFlowId{0};
+  std::mutex m_mutex;
+  std::vector<std::shared_ptr<TraceBuffer>> m_buffers; // Guarded by m_mutex.
+  size_t m_capacity{0}; // Guarded by m_mutex.
+  std::chrono::steady_clock::time_point m_startTime; // Guarded by m_mutex.
+};
+
+/*static*/ thread_local std::shared_ptr<TraceBuffer> DispatchTracer::tls_buffer;
+
+//! Task wrapper that connects the task post with its invocation by a trace flow.
+struct TracedTask final : Mso::UnknownObject<Mso::QueryCastHidden<Mso::IVoidFunctor>, Mso::ICancellationListener>
+{
+  TracedTask(DispatchTask&& task, DispatchTraceEventKind postKind, const void* queue) noexcept
+      : m_task{std::move(task)}, m_queue{queue}, m_flowId{DispatchTracer::Instance().NextFlowId()}
+  {
+    DispatchTracer::Instance().Record(postKind, m_flowId, m_queue);
+  }
+
+  void Invoke() noexcept override
+  {
+    DispatchTracer& tracer = DispatchTracer::Instance();
+    tracer.Record(DispatchTraceEventKind::TaskStart, m_flowId, m_queue);
+    DispatchTask taskToInvoke{std::move(m_task)};
+    taskToInvoke.Get()->Invoke();
+    tracer.Record(DispatchTraceEventKind::TaskEnd, m_flowId, m_queue);
+  }
+
+  void OnCancel() noexcept override
+  {
+    DispatchTask taskToCancel{std::move(m_task)};
+    if (auto cancellation = query_cast<ICancellationListener*>(taskToCancel.Get()))
+    {
+      cancellation->OnCancel();
+    }
+  }
+
+private:
+  DispatchTask m_task;
+  const void* const m_queue;
+  const uint64_t m_flowId;
+};
+
+} // namespace
+
+DispatchTask MakeTracedTask(DispatchTask&& task, DispatchTraceEventKind postKind, const void* queue) noexcept
+{
+  return DispatchTask{Mso::Make<TracedTask, IVoidFunctor>(std::move(task), postKind, queue)};
+}
+
+//=============================================================================
+// Dispatch tracing functions.
+//=============================================================================
+
+void StartDispatchTracing(size_t eventsPerThread) noexcept
+{
+  DispatchTracer::Instance().Start(eventsPerThread);
+}
+
+void StopDispatchTracing() noexcept
+{
+  DispatchTracer::Instance().Stop();
+}
+
+bool IsDispatchTracingEnabled() noexcept
+{
+  return DispatchTracer::Instance().IsEnabled();
+}
+
+void RecordDispatchTraceEvent(DispatchTraceEventKind kind, uint64_t id, const void* scope) noexcept
+{
+  DispatchTracer::Instance().Record(kind, id, scope);
+}
+
+std::string GetDispatchTraceJson() noexcept
+{
+  return DispatchTracer::Instance().GetJson();
+}
+
+} // namespace Mso
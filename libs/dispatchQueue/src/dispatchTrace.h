@@ -0,0 +1,14 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include "dispatchQueue/dispatchQueue.h"
+
+namespace Mso {
+
+//! Wrap the task to trace its invocation. It records the postKind event with a new flow id, and then the TaskStart
+//! and TaskEnd events with the same id around the task invocation. It must be called only when the tracing is enabled.
+DispatchTask MakeTracedTask(DispatchTask&& task, DispatchTraceEventKind postKind, const void* queue) noexcept;
+
+} // namespace Mso
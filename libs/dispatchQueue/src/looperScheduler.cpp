@@ -18,7 +18,7 @@ public: // IDispatchQueueScheduler
   void IntializeScheduler(Mso::WeakPtr<IDispatchQueueService>&& queue) noexcept override;
   bool HasThreadAccess() noexcept override;
   bool IsSerial() noexcept override;
-  void Post() noexcept override;
+  void Post(size_t taskCount) noexcept override;
   void Shutdown() noexcept override;
   void AwaitTermination() noexcept override;
 
@@ -87,8 +87,9 @@ bool LooperScheduler::IsSerial() noexcept
   return true;
 }
 
-void LooperScheduler::Post() noexcept
+void LooperScheduler::Post(size_t /*taskCount*/) noexcept
 {
+  // The looper thread invokes all queue tasks after it wakes up.
   m_wakeUpEvent.Set();
 }
 
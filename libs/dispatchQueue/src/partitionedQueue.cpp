@@ -0,0 +1,152 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "queueService.h"
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace Mso {
+
+//! Partitioned queue on top of a concurrent DispatchQueue.
+//!
+//! Each key with pending tasks has an entry in one of the shards. The first task posted for an idle key creates the
+//! entry and posts a runner task to the concurrent queue. Next tasks for the key are appended to the entry while the
+//! runner is pending or running. The runner takes all the entry tasks, invokes them in order, and then either removes
+//! the entry if no new tasks were added, or posts itself again to let the other keys make progress. Thus, at most one
+//! runner per key exists at any time, and the idle keys have no state.
+struct PartitionedQueue : Mso::UnknownObject<IDispatchPartitionedQueue>
+{
+  PartitionedQueue(DispatchQueue&& queue) noexcept;
+
+public: // IDispatchPartitionedQueue
+  void Post(uint64_t key, DispatchTask&& task) noexcept override;
+  void Shutdown(PendingTaskAction pendingTaskAction) noexcept override;
+  void AwaitTermination() noexcept override;
+
+private:
+  struct Shard
+  {
+    std::mutex Mutex;
+    std::unordered_map<uint64_t, std::vector<DispatchTask>> PendingTasks; // Pending tasks of the active keys.
+  };
+
+  Shard& GetShard(uint64_t key) noexcept;
+  void PostRunner(uint64_t key) noexcept;
+  void RunTasks(uint64_t key) noexcept;
+  void CancelTasks(uint64_t key) noexcept;
+
+private:
+  constexpr static size_t ShardCount{16};
+  constexpr static uint32_t ShardShift{60}; // Keeps the top 4 bits of the key hash to select one of the 16 shards.
+
+  const DispatchQueue m_queue;
+  Shard m_shards[ShardCount];
+};
+
+//=============================================================================
+// PartitionedQueue implementation.
+//=============================================================================
+
+PartitionedQueue::PartitionedQueue(DispatchQueue&& queue) noexcept : m_queue{std::move(queue)} {}
+
+void PartitionedQueue::Post(uint64_t key, DispatchTask&& task) noexcept
+{
+  VerifyElseCrashSz(task, "The task is empty");
+  Shard& shard = GetShard(key);
+  {
+    std::lock_guard lock{shard.Mutex};
+    auto [it, isInserted] = shard.PendingTasks.try_emplace(key);
+    it->second.push_back(std::move(task));
+    if (!isInserted)
+    {
+      // The key runner is already posted. It is going to invoke the task.
+      return;
+    }
+  }
+
+  PostRunner(key);
+}
+
+void PartitionedQueue::Shutdown(PendingTaskAction pendingTaskAction) noexcept
+{
+  m_queue.Shutdown(pendingTaskAction);
+}
+
+void PartitionedQueue::AwaitTermination() noexcept
+{
+  m_queue.AwaitTermination();
+}
+
+PartitionedQueue::Shard& PartitionedQueue::GetShard(uint64_t key) noexcept
+{
+  // Fibonacci hashing spreads the sequential keys between shards.
+  return m_shards[(key * 0x9E3779B97F4A7C15) >> ShardShift];
+}
+
+void PartitionedQueue::PostRunner(uint64_t key) noexcept
+{
+  Mso::CntPtr<PartitionedQueue> self{this};
+  m_queue.Post(Mso::MakeDispatchTask(
+      [self, key]() noexcept { self->RunTasks(key); }, [self, key]() noexcept { self->CancelTasks(key); }));
+}
+
+void PartitionedQueue::RunTasks(uint64_t key) noexcept
+{
+  Shard& shard = GetShard(key);
+  std::vector<DispatchTask> tasks;
+  {
+    std::lock_guard lock{shard.Mutex};
+    tasks.swap(shard.PendingTasks[key]);
+  }
+
+  for (DispatchTask& task : tasks)
+  {
+    DispatchTask taskToInvoke{std::move(task)};
+    taskToInvoke.Get()->Invoke();
+  }
+
+  {
+    std::lock_guard lock{shard.Mutex};
+    auto it = shard.PendingTasks.find(key);
+    if (it->second.empty())
+    {
+      shard.PendingTasks.erase(it);
+      return;
+    }
+  }
+
+  PostRunner(key);
+}
+
+void PartitionedQueue::CancelTasks(uint64_t key) noexcept
+{
+  Shard& shard = GetShard(key);
+  std::vector<DispatchTask> tasks;
+  {
+    std::lock_guard lock{shard.Mutex};
+    auto it = shard.PendingTasks.find(key);
+    tasks.swap(it->second);
+    shard.PendingTasks.erase(it);
+  }
+
+  for (DispatchTask& task : tasks)
+  {
+    DispatchTask taskToCancel{std::move(task)};
+    if (auto cancellation = query_cast<ICancellationListener*>(taskToCancel.Get()))
+    {
+      cancellation->OnCancel();
+    }
+  }
+}
+
+//=============================================================================
+// DispatchQueueStatic::MakePartitionedQueue implementation
+//=============================================================================
+
+DispatchPartitionedQueue DispatchQueueStatic::MakePartitionedQueue(uint32_t maxThreads) noexcept
+{
+  return Mso::Make<PartitionedQueue, IDispatchPartitionedQueue>(MakeConcurrentQueue(maxThreads));
+}
+
+} // namespace Mso
@@ -0,0 +1,120 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "queueMetrics.h"
+#include <algorithm>
+
+namespace Mso {
+
+//=============================================================================
+// QueueMetrics::TimedTask implementation.
+//=============================================================================
+
+//! Task wrapper that records the time between the task enqueue and its invocation.
+struct QueueMetrics::TimedTask final
+    : Mso::UnknownObject<Mso::QueryCastHidden<Mso::IVoidFunctor>, Mso::ICancellationListener>
+{
+  TimedTask(QueueMetrics* metrics, DispatchTask&& task) noexcept : m_metrics{metrics}, m_task{std::move(task)} {}
+
+  void Invoke() noexcept override
+  {
+    AddTime(m_metrics->GetShard().WaitTimeHistogram, std::chrono::steady_clock::now() - m_enqueueTime);
+    DispatchTask taskToInvoke{std::move(m_task)};
+    taskToInvoke.Get()->Invoke();
+  }
+
+  void OnCancel() noexcept override
+  {
+    DispatchTask taskToCancel{std::move(m_task)};
+    if (auto cancellation = query_cast<ICancellationListener*>(taskToCancel.Get()))
+    {
+      cancellation->OnCancel();
+    }
+  }
+
+private:
+  QueueMetrics* const m_metrics;
+  DispatchTask m_task;
+  const std::chrono::steady_clock::time_point m_enqueueTime{std::chrono::steady_clock::now()};
+};
+
+//=============================================================================
+// QueueMetrics implementation.
+//=============================================================================
+
+void QueueMetrics::AddEnqueued() noexcept
+{
+  GetShard().EnqueueCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+void QueueMetrics::AddDequeued() noexcept
+{
+  GetShard().DequeueCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+void QueueMetrics::AddDeferred() noexcept
+{
+  GetShard().DeferredCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+void QueueMetrics::AddBatched(size_t count) noexcept
+{
+  GetShard().BatchedCount.fetch_add(count, std::memory_order_relaxed);
+}
+
+void QueueMetrics::AddOverCapacity(size_t count) noexcept
+{
+  GetShard().OverCapacityCount.fetch_add(count, std::memory_order_relaxed);
+}
+
+void QueueMetrics::AddExecutionTime(std::chrono::steady_clock::duration time) noexcept
+{
+  AddTime(GetShard().ExecutionTimeHistogram, time);
+}
+
+DispatchTask QueueMetrics::MakeTimedTask(DispatchTask&& task) noexcept
+{
+  return DispatchTask{Mso::Make<TimedTask, IVoidFunctor>(this, std::move(task))};
+}
+
+void QueueMetrics::Collect(/*out*/ DispatchQueueMetrics& metrics) const noexcept
+{
+  for (const Shard& shard : m_shards)
+  {
+    metrics.EnqueueCount += shard.EnqueueCount.load(std::memory_order_relaxed);
+    metrics.DequeueCount += shard.DequeueCount.load(std::memory_order_relaxed);
+    metrics.DeferredCount += shard.DeferredCount.load(std::memory_order_relaxed);
+    metrics.BatchedCount += shard.BatchedCount.load(std::memory_order_relaxed);
+    metrics.OverCapacityCount += shard.OverCapacityCount.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < DispatchQueueHistogramBucketCount; ++i)
+    {
+      metrics.WaitTimeHistogram[i] += shard.WaitTimeHistogram[i].load(std::memory_order_relaxed);
+      metrics.ExecutionTimeHistogram[i] += shard.ExecutionTimeHistogram[i].load(std::memory_order_relaxed);
+    }
+  }
+}
+
+QueueMetrics::Shard& QueueMetrics::GetShard() noexcept
+{
+  // Threads get their shard index in the order of their first use of any queue metrics.
+  static std::atomic<size_t> s_nextShardIndex{0};
+  static thread_local size_t tls_shardIndex{s_nextShardIndex.fetch_add(1, std::memory_order_relaxed) % ShardCount};
+  return m_shards[tls_shardIndex];
+}
+
+/*static*/ void QueueMetrics::AddTime(Histogram& histogram, std::chrono::steady_clock::duration time) noexcept
+{
+  // The bucket index is the number of significant bits in the time microseconds.
+  uint64_t us = static_cast<uint64_t>(std::max<int64_t>(
+      std::chrono::duration_cast<std::chrono::microseconds>(time).count(), 0));
+  size_t bucket{0};
+  while (us != 0 && bucket + 1 < DispatchQueueHistogramBucketCount)
+  {
+    us >>= 1;
+    ++bucket;
+  }
+
+  histogram[bucket].fetch_add(1, std::memory_order_relaxed);
+}
+
+} // namespace Mso
@@ -0,0 +1,56 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include <atomic>
+#include "dispatchQueue/dispatchQueue.h"
+
+namespace Mso {
+
+//! Metrics counters of a QueueService.
+//!
+//! The counters are split into cache line aligned shards. Each thread updates only its own shard with relaxed
+//! atomic operations. Thus, threads that post to the same queue do not contend on the counters. GetMetrics sums up
+//! all shards. The sum is not an atomic snapshot, but each counter is exact after the concurrent updates complete.
+struct QueueMetrics
+{
+  void AddEnqueued() noexcept;
+  void AddDequeued() noexcept;
+  void AddDeferred() noexcept;
+  void AddBatched(size_t count) noexcept;
+  void AddOverCapacity(size_t count) noexcept;
+  void AddExecutionTime(std::chrono::steady_clock::duration time) noexcept;
+
+  //! Wrap the task to record its queue wait time when it is invoked. The wrapper is allocated on the heap because
+  //! the queue task stores keep only DispatchTask instances.
+  //! The QueueMetrics must outlive the task. It is true for tasks stored in the queue that owns the QueueMetrics.
+  DispatchTask MakeTimedTask(DispatchTask&& task) noexcept;
+
+  //! Add the counters to the metrics.
+  void Collect(/*out*/ DispatchQueueMetrics& metrics) const noexcept;
+
+private:
+  struct TimedTask;
+  using Histogram = std::atomic<uint64_t>[DispatchQueueHistogramBucketCount];
+
+  struct alignas(64) Shard
+  {
+    std::atomic<uint64_t> EnqueueCount{0};
+    std::atomic<uint64_t> DequeueCount{0};
+    std::atomic<uint64_t> DeferredCount{0};
+    std::atomic<uint64_t> BatchedCount{0};
+    std::atomic<uint64_t> OverCapacityCount{0};
+    Histogram WaitTimeHistogram{};
+    Histogram ExecutionTimeHistogram{};
+  };
+
+  Shard& GetShard() noexcept;
+  static void AddTime(Histogram& histogram, std::chrono::steady_clock::duration time) noexcept;
+
+private:
+  constexpr static size_t ShardCount{16};
+  Shard m_shards[ShardCount];
+};
+
+} // namespace Mso
@@ -2,9 +2,13 @@
 // Licensed under the MIT license.
 
 #include "queueService.h"
+#include "dispatchTrace.h"
+#include "queueTimer.h"
 #include "taskBatch.h"
 #include "taskContext.h"
 
+#include <algorithm>
+
 namespace Mso {
 
 //=============================================================================
@@ -13,6 +17,8 @@ namespace Mso {
 
 QueueService::QueueService(Mso::CntPtr<IDispatchQueueScheduler>&& scheduler) noexcept
     : m_scheduler{std::move(scheduler)}
+    , m_taskStore{query_cast<IDispatchTaskStore*>(m_scheduler.Get())}
+    , m_priorityScheduler{query_cast<IDispatchPriorityScheduler*>(m_scheduler.Get())}
 {
   m_scheduler->IntializeScheduler(this);
 }
@@ -24,45 +30,414 @@ QueueService::~QueueService() noexcept
 
 void QueueService::Post(DispatchTask&& task) noexcept
 {
-  VerifyElseCrashSz(task, "The task is empty");
+  PostTasks(Mso::Span<DispatchTask>{&task, 1}, DispatchPriority::Normal);
+}
+
+void QueueService::PostWithPriority(DispatchTask&& task, DispatchPriority priority) noexcept
+{
+  VerifyElseCrashSz(static_cast<size_t>(priority) < PriorityLevelCount, "Unknown task priority");
+  PostTasks(Mso::Span<DispatchTask>{&task, 1}, priority);
+}
 
-  bool isShutdown = false;
-  bool shouldSchedule = false;
+void QueueService::PostRange(Mso::Span<DispatchTask> tasks) noexcept
+{
+  PostTasks(tasks, DispatchPriority::Normal);
+}
 
+void QueueService::PostTasks(Mso::Span<DispatchTask> tasks, DispatchPriority priority) noexcept
+{
+  for (DispatchTask& task : tasks)
   {
+    VerifyElseCrashSz(task, "The task is empty");
+  }
+
+  // The task batch is posted as one Normal priority task. Thus, it keeps only the Normal priority tasks.
+  if (!tasks || (priority == DispatchPriority::Normal && TryAddToTaskBatch(tasks)))
+  {
+    return;
+  }
+
+  if (IsShutdown(m_state.fetch_add(PostCountUnit)))
+  {
+    m_state.fetch_sub(PostCountUnit);
+    for (DispatchTask& task : tasks)
+    {
+      CancelTask(std::move(task));
+    }
+
+    return;
+  }
+
+  for (DispatchTask& task : tasks)
+  {
+    EnqueueTask(std::move(task), priority);
+  }
+
+  UpdateHighWaterMark();
+  if (GetSuspendCount(m_state.fetch_sub(PostCountUnit)) == 0)
+  {
+    PostToScheduler(tasks.Size(), priority);
+  }
+
+  // The Post methods ignore the capacity. Count the tasks above it to show that a bounded queue is misused.
+  if (size_t capacity = m_capacity.load(std::memory_order_relaxed))
+  {
+    if (QueueMetrics* metrics = m_metrics.load(std::memory_order_acquire))
+    {
+      size_t taskCount = GetTaskCount();
+      if (taskCount > capacity)
+      {
+        metrics->AddOverCapacity(std::min(tasks.Size(), taskCount - capacity));
+      }
+    }
+  }
+}
+
+void QueueService::PostToScheduler(size_t taskCount, DispatchPriority priority) noexcept
+{
+  if (priority == DispatchPriority::High && m_priorityScheduler)
+  {
+    m_priorityScheduler->PostHighPriority(taskCount);
+  }
+  else
+  {
+    m_scheduler->Post(taskCount);
+  }
+}
+
+void QueueService::SetCapacity(size_t capacity) noexcept
+{
+  {
+    std::lock_guard lock{m_mutex};
+    m_capacity.store(capacity);
+  }
+
+  // The bigger capacity may let the waiting tasks in.
+  PostSpaceWaiters();
+}
+
+bool QueueService::TryPost(DispatchTask&& task) noexcept
+{
+  VerifyElseCrashSz(task, "The task is empty");
+  if (m_capacity.load(std::memory_order_relaxed) == 0)
+  {
+    Post(std::move(task));
+    return true;
+  }
+
+  bool isShutdown{false};
+  {
+    // Shutdown sets its flag under the same lock. Thus, the task is either enqueued or canceled.
     std::lock_guard lock{m_mutex};
-    auto it = m_taskBatches.find(std::this_thread::get_id());
-    if (it != m_taskBatches.end())
+    isShutdown = IsShutdown(m_state.load());
+    if (!isShutdown)
     {
-      it->second->AddTask(std::move(task));
+      if (!HasSpace())
+      {
+        return false;
+      }
+
+      EnqueueTask(std::move(task), DispatchPriority::Normal);
+      UpdateHighWaterMark();
     }
-    else
+  }
+
+  if (isShutdown)
+  {
+    CancelTask(std::move(task));
+  }
+  else if (GetSuspendCount(m_state.load()) == 0)
+  {
+    m_scheduler->Post(/*taskCount:*/ 1);
+  }
+
+  return true;
+}
+
+void QueueService::PostWhenSpace(DispatchTask&& task, DispatchTask&& onPosted) noexcept
+{
+  VerifyElseCrashSz(task, "The task is empty");
+  VerifyElseCrashSz(onPosted, "The onPosted task is empty");
+  bool isShutdown{false};
+  bool isWaiting{false};
+  {
+    std::lock_guard lock{m_mutex};
+    isShutdown = IsShutdown(m_state.load());
+    if (!isShutdown)
     {
-      isShutdown = m_shutdownAction.has_value();
-      if (!isShutdown)
+      if (HasSpace())
       {
-        m_queue.Enqueue(std::move(task));
-        shouldSchedule = (m_suspendCounter == 0);
+        EnqueueTask(std::move(task), DispatchPriority::Normal);
+        UpdateHighWaterMark();
+      }
+      else
+      {
+        m_spaceWaiters.push_back(SpaceWaiter{std::move(task), std::move(onPosted)});
+        m_hasSpaceWaiters.store(true);
+        isWaiting = true;
       }
     }
   }
 
-  if (shouldSchedule)
+  if (isWaiting)
   {
-    m_scheduler->Post();
+    // A consumer could dequeue a task before it saw m_hasSpaceWaiters. Check the space again after setting it.
+    PostSpaceWaiters();
+    return;
   }
-  else if (isShutdown)
+
+  if (isShutdown)
   {
     CancelTask(std::move(task));
+    CancelTask(std::move(onPosted));
+    return;
+  }
+
+  if (GetSuspendCount(m_state.load()) == 0)
+  {
+    m_scheduler->Post(/*taskCount:*/ 1);
+  }
+
+  DispatchTask onPostedToInvoke{std::move(onPosted)};
+  onPostedToInvoke.Get()->Invoke();
+}
+
+size_t QueueService::GetHighWaterMark() noexcept
+{
+  return m_highWaterMark.load();
+}
+
+void QueueService::EnableMetrics() noexcept
+{
+  std::lock_guard lock{m_mutex};
+  if (!m_metricsStorage)
+  {
+    m_metricsStorage = std::make_unique<QueueMetrics>();
+    m_metrics.store(m_metricsStorage.get(), std::memory_order_release);
+  }
+}
+
+DispatchQueueMetrics QueueService::GetMetrics() noexcept
+{
+  DispatchQueueMetrics metrics;
+  if (QueueMetrics* queueMetrics = m_metrics.load(std::memory_order_acquire))
+  {
+    queueMetrics->Collect(/*out*/ metrics);
+  }
+
+  metrics.Depth = GetTaskCount();
+  metrics.PeakDepth = m_highWaterMark.load();
+  return metrics;
+}
+
+bool QueueService::HasSpace() noexcept
+{
+  size_t capacity = m_capacity.load();
+  return capacity == 0 || (m_spaceWaiters.empty() && GetTaskCount() < capacity);
+}
+
+void QueueService::PostSpaceWaiters() noexcept
+{
+  std::vector<DispatchTask> onPostedTasks;
+  {
+    std::lock_guard lock{m_mutex};
+    size_t capacity = m_capacity.load();
+    while (!m_spaceWaiters.empty() && (capacity == 0 || GetTaskCount() < capacity))
+    {
+      EnqueueTask(std::move(m_spaceWaiters.front().Task), DispatchPriority::Normal);
+      onPostedTasks.push_back(std::move(m_spaceWaiters.front().OnPosted));
+      m_spaceWaiters.pop_front();
+    }
+
+    m_hasSpaceWaiters.store(!m_spaceWaiters.empty());
+    if (!onPostedTasks.empty())
+    {
+      UpdateHighWaterMark();
+    }
+  }
+
+  if (onPostedTasks.empty())
+  {
+    return;
+  }
+
+  if (GetSuspendCount(m_state.load()) == 0)
+  {
+    m_scheduler->Post(onPostedTasks.size());
+  }
+
+  // The consumers call this method from TryDequeTask outside of any task context. Thus, do not invoke the onPosted
+  // callbacks and their continuations there.
+  DispatchQueue::ConcurrentQueue().PostRange(Mso::Span<DispatchTask>{onPostedTasks.data(), onPostedTasks.size()});
+}
+
+void QueueService::UpdateHighWaterMark() noexcept
+{
+  size_t taskCount = GetTaskCount();
+  size_t highWaterMark = m_highWaterMark.load(std::memory_order_relaxed);
+  while (taskCount > highWaterMark
+         && !m_highWaterMark.compare_exchange_weak(highWaterMark, taskCount, std::memory_order_relaxed))
+  {
+  }
+}
+
+bool QueueService::TryAddToTaskBatch(Mso::Span<DispatchTask> tasks) noexcept
+{
+  if (TaskBatch* taskBatch = ThreadTaskBatches::Find(this))
+  {
+    if (QueueMetrics* metrics = m_metrics.load(std::memory_order_acquire))
+    {
+      metrics->AddBatched(tasks.Size());
+    }
+
+    for (DispatchTask& task : tasks)
+    {
+      taskBatch->AddTask(std::move(task));
+    }
+
+    return true;
+  }
+
+  return false;
+}
+
+void QueueService::EnqueueTask(DispatchTask&& task, DispatchPriority priority) noexcept
+{
+  if (QueueMetrics* metrics = m_metrics.load(std::memory_order_acquire))
+  {
+    metrics->AddEnqueued();
+    task = metrics->MakeTimedTask(std::move(task));
+  }
+
+  if (IsDispatchTracingEnabled())
+  {
+    task = MakeTracedTask(std::move(task), DispatchTraceEventKind::Post, this);
+  }
+
+  size_t level = static_cast<size_t>(priority);
+  if (level == NormalLevel && m_taskStore)
+  {
+    m_taskStore->Enqueue(std::move(task));
+  }
+  else
+  {
+    m_queues[level].Enqueue(std::move(task));
+  }
+}
+
+bool QueueService::TryDequeueByPriority(/*out*/ DispatchTask& task) noexcept
+{
+  // Let the lower priority task go first if higher priority tasks passed it too many times.
+  for (size_t level = 0; level + 1 < PriorityLevelCount; ++level)
+  {
+    if (m_passCounts[level].load(std::memory_order_relaxed) >= PriorityStarvationLimit
+        && TryDequeueAt(level, /*out*/ task))
+    {
+      m_passCounts[level].store(0, std::memory_order_relaxed);
+      return true;
+    }
+  }
+
+  for (size_t level = PriorityLevelCount; level-- > 0;)
+  {
+    if (TryDequeueAt(level, /*out*/ task))
+    {
+      m_passCounts[level].store(0, std::memory_order_relaxed);
+      for (size_t lowerLevel = 0; lowerLevel < level; ++lowerLevel)
+      {
+        if (!IsEmptyAt(lowerLevel))
+        {
+          m_passCounts[lowerLevel].fetch_add(1, std::memory_order_relaxed);
+        }
+      }
+
+      return true;
+    }
+  }
+
+  return false;
+}
+
+bool QueueService::TryDequeueAt(size_t level, /*out*/ DispatchTask& task) noexcept
+{
+  // Check the size first to avoid the TryDequeue memory fence for the priority levels that are typically empty.
+  return (level == NormalLevel && m_taskStore)
+      ? m_taskStore->TryDequeue(/*out*/ task)
+      : (!m_queues[level].IsEmpty() && m_queues[level].TryDequeue(/*out*/ task));
+}
+
+bool QueueService::IsEmptyAt(size_t level) noexcept
+{
+  return (level == NormalLevel && m_taskStore) ? m_taskStore->IsEmpty() : m_queues[level].IsEmpty();
+}
+
+size_t QueueService::GetTaskCount() noexcept
+{
+  size_t taskCount{0};
+  for (size_t level = 0; level < PriorityLevelCount; ++level)
+  {
+    taskCount += (level == NormalLevel && m_taskStore) ? m_taskStore->Size() : m_queues[level].Size();
+  }
+
+  return taskCount;
+}
+
+Mso::CntPtr<IDispatchTimer> QueueService::PostAt(
+    std::chrono::steady_clock::time_point time,
+    DispatchTask&& task) noexcept
+{
+  VerifyElseCrashSz(task, "The task is empty");
+  auto timer = Mso::Make<QueueTimer>(
+      Mso::CntPtr<QueueService>{this}, std::move(task), std::chrono::steady_clock::duration::zero());
+  StartTimer(time, timer);
+  return timer;
+}
+
+Mso::CntPtr<IDispatchTimer> QueueService::PostPeriodic(
+    std::chrono::steady_clock::duration period,
+    DispatchTask&& task) noexcept
+{
+  VerifyElseCrashSz(task, "The task is empty");
+  VerifyElseCrashSz(period > std::chrono::steady_clock::duration::zero(), "The period must be positive");
+  auto timer = Mso::Make<QueueTimer>(Mso::CntPtr<QueueService>{this}, std::move(task), period);
+  StartTimer(std::chrono::steady_clock::now() + period, timer);
+  return timer;
+}
+
+void QueueService::StartTimer(std::chrono::steady_clock::time_point time, Mso::CntPtr<QueueTimer> const& timer) noexcept
+{
+  {
+    std::lock_guard lock{m_mutex};
+    if (!IsShutdown(m_state.load()))
+    {
+      m_timers.emplace(timer.Get(), timer);
+      timer->Start(time);
+      return;
+    }
+  }
+
+  timer->Cancel();
+}
+
+void QueueService::RemoveTimer(QueueTimer* timer) noexcept
+{
+  Mso::CntPtr<QueueTimer> removedTimer; // Release the timer outside of the lock.
+  std::lock_guard lock{m_mutex};
+  auto it = m_timers.find(timer);
+  if (it != m_timers.end())
+  {
+    removedTimer = std::move(it->second);
+    m_timers.erase(it);
   }
 }
 
 bool QueueService::ShouldYield(TaskYieldReason* yieldReason) noexcept
 {
   auto setReason = [&](TaskYieldReason reason) noexcept { return yieldReason ? *yieldReason = reason : reason, true; };
-  std::lock_guard lock{m_mutex};
-  return (m_shutdownAction.has_value() && setReason(TaskYieldReason::QueueShutdown))
-      || (m_suspendCounter > 0 && setReason(TaskYieldReason::QueueSuspended));
+  uint64_t state = m_state.load();
+  return (IsShutdown(state) && setReason(TaskYieldReason::QueueShutdown))
+      || (GetSuspendCount(state) > 0 && setReason(TaskYieldReason::QueueSuspended))
+      || (TaskContext::IsTimeExpired(this) && setReason(TaskYieldReason::TimeExpired));
 }
 
 bool QueueService::IsCurrentQueue() noexcept
@@ -104,6 +479,16 @@ void QueueService::DeferElsePost(DispatchTask&& task) noexcept
 {
   if (TaskContext::CurrentQueue() == this)
   {
+    if (QueueMetrics* metrics = m_metrics.load(std::memory_order_acquire))
+    {
+      metrics->AddDeferred();
+    }
+
+    if (IsDispatchTracingEnabled())
+    {
+      task = MakeTracedTask(std::move(task), DispatchTraceEventKind::Defer, this);
+    }
+
     TaskContext::CurrentContext()->Defer(std::move(task));
   }
   else
@@ -114,34 +499,13 @@ void QueueService::DeferElsePost(DispatchTask&& task) noexcept
 
 void QueueService::BeginTaskBatching() noexcept
 {
-  auto taskBatch{Mso::Make<TaskBatch>()};
-  std::lock_guard lock{m_mutex};
-  auto result = m_taskBatches.try_emplace(std::this_thread::get_id(), std::move(taskBatch));
-  if (result.second)
-  {
-    taskBatch->SetEnclosingBatch(std::move(result.first->second));
-    result.first->second = std::move(taskBatch);
-  }
+  ThreadTaskBatches::Begin(this);
 }
 
 DispatchTask QueueService::EndTaskBatching() noexcept
 {
-  Mso::CntPtr<TaskBatch> taskBatch;
-  std::lock_guard lock{m_mutex};
-  auto it = m_taskBatches.find(std::this_thread::get_id());
-  if (it != m_taskBatches.end())
-  {
-    taskBatch = std::move(it->second);
-    if (auto enclosingBatch = taskBatch->TakeEnclosingBatch())
-    {
-      it->second = std::move(enclosingBatch);
-    }
-    else
-    {
-      m_taskBatches.erase(it);
-    }
-  }
-  else
+  Mso::CntPtr<TaskBatch> taskBatch = ThreadTaskBatches::End(this);
+  if (!taskBatch)
   {
     taskBatch = Mso::Make<TaskBatch>();
   }
@@ -151,8 +515,7 @@ DispatchTask QueueService::EndTaskBatching() noexcept
 
 bool QueueService::HasTaskBatching() noexcept
 {
-  std::lock_guard lock{m_mutex};
-  return m_taskBatches.find(std::this_thread::get_id()) != m_taskBatches.end();
+  return ThreadTaskBatches::Find(this) != nullptr;
 }
 
 bool QueueService::TryLockQueueLocalValue(SwapDispatchLocalValueCallback swapLocalValue, void* tlsValue) noexcept
@@ -184,40 +547,72 @@ bool QueueService::TrySwapLocalValue(
 
 void QueueService::Suspend() noexcept
 {
-  std::lock_guard lock{m_mutex};
-  ++m_suspendCounter;
+  uint64_t prevState = m_state.fetch_add(SuspendCountUnit);
+  VerifyElseCrashSz(GetSuspendCount(prevState) < (SuspendCountMask >> SuspendCountShift), "Too many Suspend calls");
 }
 
 void QueueService::Resume() noexcept
 {
-  size_t postCount{0};
+  // Check the suspend counter before changing it to keep m_state intact on the unbalanced Resume.
+  uint64_t prevState = m_state.load();
+  do
+  {
+    VerifyElseCrashSz(GetSuspendCount(prevState) > 0, "Resume must be balanced with Suspend");
+  } while (!m_state.compare_exchange_weak(prevState, prevState - SuspendCountUnit));
 
+  if (GetSuspendCount(prevState) != 1)
   {
-    std::lock_guard lock{m_mutex};
-    VerifyElseCrashSz(m_suspendCounter > 0, "m_suspendCounter must not be negative");
+    return;
+  }
 
-    if (--m_suspendCounter == 0)
-    {
-      postCount = m_queue.Size();
-    }
+  // Only the High priority tasks may run ahead of the other queues' tasks in the scheduler.
+  size_t postCount = GetTaskCount();
+  size_t highPriorityCount = std::min(postCount, m_queues[static_cast<size_t>(DispatchPriority::High)].Size());
+  if (highPriorityCount > 0)
+  {
+    PostToScheduler(highPriorityCount, DispatchPriority::High);
   }
 
-  for (size_t i = 0; i < postCount; ++i)
+  if (postCount > highPriorityCount)
   {
-    m_scheduler->Post();
+    PostToScheduler(postCount - highPriorityCount, DispatchPriority::Normal);
   }
 }
 
 void QueueService::Shutdown(PendingTaskAction pendingTaskAction) noexcept
 {
-  std::vector<DispatchTask> tasksToCancel;
-
+  // Pending timers are canceled regardless of the pendingTaskAction because their tasks are not posted yet.
+  std::map<QueueTimer*, Mso::CntPtr<QueueTimer>> timersToCancel;
+  std::deque<SpaceWaiter> spaceWaitersToCancel;
   {
+    // Set the shutdown flag under the lock to let StartTimer either add a timer before it is swapped here or see
+    // the flag.
     std::lock_guard lock{m_mutex};
-    m_shutdownAction = pendingTaskAction;
-    if (pendingTaskAction == PendingTaskAction::Cancel)
+    m_state.fetch_or(ShutdownFlag);
+    timersToCancel.swap(m_timers);
+    spaceWaitersToCancel.swap(m_spaceWaiters);
+    m_hasSpaceWaiters.store(false);
+  }
+
+  // New Post calls cancel their tasks. Wait for Post calls that started before the shutdown to finish.
+  while (GetPostCount(m_state.load()) != 0)
+  {
+    std::this_thread::yield();
+  }
+
+  std::vector<DispatchTask> tasksToCancel;
+  if (pendingTaskAction == PendingTaskAction::Cancel)
+  {
+    for (size_t level = PriorityLevelCount; level-- > 0;)
     {
-      m_queue.DequeueAll(/*out*/ tasksToCancel);
+      if (level == NormalLevel && m_taskStore)
+      {
+        m_taskStore->DequeueAll(/*out*/ tasksToCancel);
+      }
+      else
+      {
+        m_queues[level].DequeueAll(/*out*/ tasksToCancel);
+      }
     }
   }
 
@@ -226,6 +621,17 @@ void QueueService::Shutdown(PendingTaskAction pendingTaskAction) noexcept
     CancelTask(std::move(task));
   }
 
+  for (auto& timer : timersToCancel)
+  {
+    timer.second->Cancel();
+  }
+
+  for (auto& spaceWaiter : spaceWaitersToCancel)
+  {
+    CancelTask(std::move(spaceWaiter.Task));
+    CancelTask(std::move(spaceWaiter.OnPosted));
+  }
+
   m_scheduler->Shutdown();
 }
 
@@ -237,21 +643,58 @@ void QueueService::AwaitTermination() noexcept
 
 bool QueueService::HasTasks() noexcept
 {
-  std::lock_guard lock{m_mutex};
-  return m_suspendCounter == 0 && !m_queue.IsEmpty();
+  if (GetSuspendCount(m_state.load()) != 0)
+  {
+    return false;
+  }
+
+  for (size_t level = 0; level < PriorityLevelCount; ++level)
+  {
+    if (!IsEmptyAt(level))
+    {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+bool QueueService::HasHighPriorityTasks() noexcept
+{
+  return GetSuspendCount(m_state.load()) == 0
+      && !m_queues[static_cast<size_t>(DispatchPriority::High)].IsEmpty();
 }
 
 bool QueueService::TryDequeTask(/*out*/ DispatchTask& task) noexcept
 {
-  std::lock_guard lock{m_mutex};
-  return m_suspendCounter == 0 && m_queue.TryDequeue(/*out*/ task);
+  if (GetSuspendCount(m_state.load()) != 0 || !TryDequeueByPriority(/*out*/ task))
+  {
+    return false;
+  }
+
+  // The sequentially consistent load pairs with the m_hasSpaceWaiters store before the PostWhenSpace space check.
+  if (m_hasSpaceWaiters.load())
+  {
+    PostSpaceWaiters();
+  }
+
+  if (QueueMetrics* metrics = m_metrics.load(std::memory_order_acquire))
+  {
+    metrics->AddDequeued();
+  }
+
+  RecordDispatchTraceEvent(DispatchTraceEventKind::Dequeue, 0, this);
+  return true;
 }
 
 void QueueService::InvokeTask(
     DispatchTask&& task,
     std::optional<std::chrono::steady_clock::time_point> endTime) noexcept
 {
+  QueueMetrics* metrics = m_metrics.load(std::memory_order_acquire);
+  auto startTime = metrics ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point{};
   TaskContext context{this, endTime};
+  RecordDispatchTraceEvent(DispatchTraceEventKind::InvokeStart, 0, this);
   DispatchTask taskToInvoke{std::move(task)};
   taskToInvoke.Get()->Invoke(); // Call Get()->Invoke instead of operator() to flatten call stack
 
@@ -259,10 +702,17 @@ void QueueService::InvokeTask(
   {
     taskToInvoke.Get()->Invoke();
   }
+
+  RecordDispatchTraceEvent(DispatchTraceEventKind::InvokeEnd, 0, this);
+  if (metrics)
+  {
+    metrics->AddExecutionTime(std::chrono::steady_clock::now() - startTime);
+  }
 }
 
 void QueueService::CancelTask(DispatchTask&& task) noexcept
 {
+  RecordDispatchTraceEvent(DispatchTraceEventKind::Cancel, 0, this);
   DispatchTask taskToCancel{std::move(task)};
   if (auto cancellation = query_cast<ICancellationListener*>(taskToCancel.Get()))
   {
@@ -270,6 +720,21 @@ void QueueService::CancelTask(DispatchTask&& task) noexcept
   }
 }
 
+/*static*/ uint32_t QueueService::GetPostCount(uint64_t state) noexcept
+{
+  return static_cast<uint32_t>(state & PostCountMask);
+}
+
+/*static*/ uint32_t QueueService::GetSuspendCount(uint64_t state) noexcept
+{
+  return static_cast<uint32_t>((state & SuspendCountMask) >> SuspendCountShift);
+}
+
+/*static*/ bool QueueService::IsShutdown(uint64_t state) noexcept
+{
+  return (state & ShutdownFlag) != 0;
+}
+
 //=============================================================================
 // LocalValueEntry implementation.
 //=============================================================================
@@ -329,17 +794,40 @@ DispatchQueue DispatchQueueStatic::CurrentQueue() noexcept
 
 // TODO: Use thread-safe patterns. Or better yet implement DI container.
 static DispatchQueue s_concurrentQueue{nullptr};
+static ConcurrentQueueScheduler s_concurrentQueueScheduler{ConcurrentQueueScheduler::ThreadPool};
+static std::atomic<std::chrono::steady_clock::rep> s_timeSlice{
+    std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::milliseconds{100}).count()};
 
 DispatchQueue const& DispatchQueueStatic::ConcurrentQueue() noexcept
 {
   if (!s_concurrentQueue)
   {
-    s_concurrentQueue = Mso::Make<QueueService, IDispatchQueueService>(MakeThreadPoolScheduler(0));
+    s_concurrentQueue = Mso::Make<QueueService, IDispatchQueueService>(
+        s_concurrentQueueScheduler == ConcurrentQueueScheduler::WorkStealing ? MakeWorkStealingScheduler(0)
+                                                                             : MakeThreadPoolScheduler(0));
   }
 
   return *static_cast<DispatchQueue*>(static_cast<void*>(&s_concurrentQueue));
 }
 
+void SetConcurrentQueueScheduler(ConcurrentQueueScheduler scheduler) noexcept
+{
+  VerifyElseCrashSz(!s_concurrentQueue, "The ConcurrentQueue is already created");
+  s_concurrentQueueScheduler = scheduler;
+}
+
+void SetDispatchQueueTimeSlice(std::chrono::steady_clock::duration timeSlice) noexcept
+{
+  VerifyElseCrashSz(timeSlice.count() > 0, "The time slice must be positive");
+  s_timeSlice.store(timeSlice.count(), std::memory_order_relaxed);
+}
+
+/*static*/ std::chrono::steady_clock::time_point DispatchQueueStatic::StartTimeSlice() noexcept
+{
+  return std::chrono::steady_clock::now()
+      + std::chrono::steady_clock::duration{s_timeSlice.load(std::memory_order_relaxed)};
+}
+
 void UnitTest_UninitConcurrentQueue() noexcept
 {
   using std::swap;
@@ -3,17 +3,23 @@
 
 #pragma once
 
+#include <atomic>
+#include <deque>
 #include <map>
+#include <memory>
 #include <thread>
 #include "eventWaitHandle/eventWaitHandle.h"
 #include "object/refCountedObject.h"
+#include "queueMetrics.h"
 #include "taskQueue.h"
+#include "threadMutex.h"
 
 namespace Mso {
 
 // Forward declarations
 struct QueueLocalValueEntry;
 struct QueueService;
+struct QueueTimer;
 struct TaskBatch;
 
 enum class LocalValueSwapAction
@@ -22,6 +28,28 @@ enum class LocalValueSwapAction
   Unlock,
 };
 
+//! Optional IDispatchQueueScheduler interface to store queue tasks in the scheduler instead of the QueueService.
+//! It lets the scheduler decide where tasks are stored, e.g. in the per-thread work-stealing deques.
+//! The QueueService still implements suspend, shutdown, and task batching on top of it.
+MSO_STRUCT_GUID(IDispatchTaskStore, "ca329fde-7959-49d5-882e-c0cfa6649f6a")
+struct IDispatchTaskStore : IUnknown
+{
+  virtual void Enqueue(DispatchTask&& task) noexcept = 0;
+  virtual bool TryDequeue(/*out*/ DispatchTask& task) noexcept = 0;
+  virtual bool DequeueAll(/*out*/ std::vector<DispatchTask>& tasks) noexcept = 0;
+  virtual size_t Size() noexcept = 0;
+  virtual bool IsEmpty() noexcept = 0;
+};
+
+//! Optional IDispatchQueueScheduler interface to let the High priority tasks of the queue run ahead of the work of
+//! other queues that share the same threads.
+MSO_STRUCT_GUID(IDispatchPriorityScheduler, "ae6412af-3a97-4951-b641-f435698017fb")
+struct IDispatchPriorityScheduler : IUnknown
+{
+  //! Schedule handling of the taskCount High priority tasks added to the dispatch queue.
+  virtual void PostHighPriority(size_t taskCount) noexcept = 0;
+};
+
 // A base class for serial dispatch queues
 struct QueueService : Mso::UnknownObject<Mso::RefCountStrategy::WeakRef, IDispatchQueueService, IDispatchQueue>
 {
@@ -31,8 +59,23 @@ struct QueueService : Mso::UnknownObject<Mso::RefCountStrategy::WeakRef, IDispat
   QueueService(QueueService const& other) = delete;
   QueueService& operator=(QueueService const& other) = delete;
 
+  //! Remove the timer from the pending timers that are canceled on shutdown.
+  void RemoveTimer(QueueTimer* timer) noexcept;
+
 public: // IDispatchQueueService
   void Post(DispatchTask&& task) noexcept override;
+  void PostWithPriority(DispatchTask&& task, DispatchPriority priority) noexcept override;
+  void PostRange(Mso::Span<DispatchTask> tasks) noexcept override;
+  void SetCapacity(size_t capacity) noexcept override;
+  bool TryPost(DispatchTask&& task) noexcept override;
+  void PostWhenSpace(DispatchTask&& task, DispatchTask&& onPosted) noexcept override;
+  size_t GetHighWaterMark() noexcept override;
+  void EnableMetrics() noexcept override;
+  DispatchQueueMetrics GetMetrics() noexcept override;
+  Mso::CntPtr<IDispatchTimer> PostAt(std::chrono::steady_clock::time_point time, DispatchTask&& task) noexcept
+      override;
+  Mso::CntPtr<IDispatchTimer> PostPeriodic(std::chrono::steady_clock::duration period, DispatchTask&& task) noexcept
+      override;
   bool ShouldYield(TaskYieldReason* yieldReason) noexcept override;
   bool IsCurrentQueue() noexcept override;
   bool IsSerial() noexcept override;
@@ -49,24 +92,89 @@ public: // IDispatchQueueService
   void Shutdown(PendingTaskAction pendingTaskAction) noexcept override;
   void AwaitTermination() noexcept override;
   bool HasTasks() noexcept override;
+  bool HasHighPriorityTasks() noexcept override;
   bool TryDequeTask(/*out*/ DispatchTask& task) noexcept override;
   void InvokeTask(DispatchTask&& task, std::optional<std::chrono::steady_clock::time_point> endTime) noexcept override;
   void CancelTask(DispatchTask&& task) noexcept override;
 
 private:
+  void PostTasks(Mso::Span<DispatchTask> tasks, DispatchPriority priority) noexcept;
+  void PostToScheduler(size_t taskCount, DispatchPriority priority) noexcept;
+
+  //! Add the tasks to the current thread task batch. Returns false if the thread does not batch tasks for this queue.
+  bool TryAddToTaskBatch(Mso::Span<DispatchTask> tasks) noexcept;
+  void EnqueueTask(DispatchTask&& task, DispatchPriority priority) noexcept;
+
+  //! Dequeue a task of the highest priority unless a lower priority task was passed PriorityStarvationLimit times.
+  bool TryDequeueByPriority(/*out*/ DispatchTask& task) noexcept;
+  bool TryDequeueAt(size_t level, /*out*/ DispatchTask& task) noexcept;
+  bool IsEmptyAt(size_t level) noexcept;
+  size_t GetTaskCount() noexcept;
+  void UpdateHighWaterMark() noexcept;
+
+  //! True if a bounded post can add a task now. It must be called under the m_mutex.
+  bool HasSpace() noexcept;
+
+  //! Post the PostWhenSpace tasks while the queue has space.
+  void PostSpaceWaiters() noexcept;
   bool TrySwapLocalValue(
       SwapDispatchLocalValueCallback swapLocalValue,
       void* tlsValue,
       LocalValueSwapAction action) noexcept;
+  void StartTimer(std::chrono::steady_clock::time_point time, Mso::CntPtr<QueueTimer> const& timer) noexcept;
+
+  static uint32_t GetPostCount(uint64_t state) noexcept;
+  static uint32_t GetSuspendCount(uint64_t state) noexcept;
+  static bool IsShutdown(uint64_t state) noexcept;
 
 private:
+  // m_state packs the queue state into one atomic word to read it with a single wait-free load:
+  // - The number of Post calls in progress. It allows Shutdown to wait until all concurrent Post calls either
+  //   enqueue or cancel their tasks.
+  // - The suspend counter.
+  // - The shutdown flag.
+  // The queue has work when it is not suspended and its task store is not empty. The task store keeps its own
+  // atomic size. Thus, the work check is wait-free without mirroring the size in m_state.
+  constexpr static uint64_t PostCountUnit{1};
+  constexpr static uint64_t PostCountMask{0xFFFFFFFF};
+  constexpr static uint32_t SuspendCountShift{32};
+  constexpr static uint64_t SuspendCountUnit{uint64_t{1} << SuspendCountShift};
+  constexpr static uint64_t SuspendCountMask{uint64_t{0x7FFFFFFF} << SuspendCountShift};
+  constexpr static uint64_t ShutdownFlag{uint64_t{1} << 63};
+
+  // Task queues are indexed by the DispatchPriority value.
+  constexpr static size_t PriorityLevelCount{static_cast<size_t>(DispatchPriority::High) + 1};
+  constexpr static size_t NormalLevel{static_cast<size_t>(DispatchPriority::Normal)};
+  constexpr static uint32_t PriorityStarvationLimit{16};
+
   const Mso::CntPtr<IDispatchQueueScheduler> m_scheduler;
+  IDispatchTaskStore* const m_taskStore; // Optional scheduler task store for the Normal priority tasks.
+  IDispatchPriorityScheduler* const m_priorityScheduler; // Optional scheduler support for the High priority tasks.
   ThreadMutex m_mutex;
-  TaskQueue m_queue{static_cast<IDispatchQueue*>(this)};
-  std::optional<PendingTaskAction> m_shutdownAction;
-  int32_t m_suspendCounter{0};
-  std::map<std::thread::id, Mso::CntPtr<TaskBatch>> m_taskBatches;
+  TaskQueue m_queues[PriorityLevelCount]{
+      {static_cast<IDispatchQueue*>(this)}, {static_cast<IDispatchQueue*>(this)}, {static_cast<IDispatchQueue*>(this)}};
+
+  // Number of times a lower priority task was passed by higher priority tasks since it was dequeued last time.
+  // It is a heuristic. Thus, the concurrent updates are not synchronized.
+  std::atomic<uint32_t> m_passCounts[PriorityLevelCount]{};
+  std::atomic<uint64_t> m_state{0};
   std::map<ptrdiff_t, QueueLocalValueEntry> m_localValues;
+  std::map<QueueTimer*, Mso::CntPtr<QueueTimer>> m_timers; // Pending timers to cancel on shutdown.
+
+  // Bounded posts change the queue under m_mutex to never exceed the capacity.
+  struct SpaceWaiter
+  {
+    DispatchTask Task;
+    DispatchTask OnPosted;
+  };
+
+  std::atomic<size_t> m_capacity{0};
+  std::atomic<size_t> m_highWaterMark{0};
+  std::atomic<bool> m_hasSpaceWaiters{false}; // Lets consumers check m_spaceWaiters without the lock.
+  std::deque<SpaceWaiter> m_spaceWaiters; // PostWhenSpace tasks waiting for space in their order.
+
+  std::unique_ptr<QueueMetrics> m_metricsStorage; // Created by EnableMetrics under the m_mutex and never deleted.
+  std::atomic<QueueMetrics*> m_metrics{nullptr}; // Null until metrics are enabled.
 };
 
 // Stores a queue local value
@@ -89,6 +197,10 @@ struct DispatchQueueStatic : Mso::UnknownObject<Mso::RefCountStrategy::NoRefCoun
   static Mso::CntPtr<IDispatchQueueScheduler> MakeMainUIScheduler() noexcept;
   static Mso::CntPtr<IDispatchQueueScheduler> MakeCurrentThreadUIScheduler() noexcept;
   static Mso::CntPtr<IDispatchQueueScheduler> MakeThreadPoolScheduler(uint32_t maxThreads) noexcept;
+  static Mso::CntPtr<IDispatchQueueScheduler> MakeWorkStealingScheduler(uint32_t maxThreads) noexcept;
+
+  //! Returns the end time of a time slice that starts now.
+  static std::chrono::steady_clock::time_point StartTimeSlice() noexcept;
 
 public: // IDispatchQueueStatic
   DispatchQueue CurrentQueue() noexcept override;
@@ -98,6 +210,7 @@ public: // IDispatchQueueStatic
   DispatchQueue MakeLooperQueue() noexcept override;
   DispatchQueue MakeCurrentThreadUIQueue() noexcept override;
   DispatchQueue MakeConcurrentQueue(uint32_t maxThreads) noexcept override;
+  DispatchPartitionedQueue MakePartitionedQueue(uint32_t maxThreads) noexcept override;
   DispatchQueue MakeCustomQueue(Mso::CntPtr<IDispatchQueueScheduler>&& scheduler) noexcept override;
 };
 
@@ -0,0 +1,144 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "queueTimer.h"
+#include <algorithm>
+
+namespace Mso {
+
+//=============================================================================
+// QueueTimer implementation.
+//=============================================================================
+
+QueueTimer::QueueTimer(
+    Mso::CntPtr<QueueService>&& queue,
+    DispatchTask&& task,
+    std::chrono::steady_clock::duration period) noexcept
+    : m_queue{std::move(queue)}, m_period{period}, m_task{std::move(task)}
+{
+}
+
+void QueueTimer::Start(std::chrono::steady_clock::time_point time) noexcept
+{
+  std::lock_guard lock{m_mutex};
+  if (m_state == State::Created)
+  {
+    Schedule(time);
+  }
+}
+
+void QueueTimer::Cancel() noexcept
+{
+  DispatchTask taskToCancel;
+  Mso::CntPtr<QueueTimer> wheelRef;
+  {
+    std::lock_guard lock{m_mutex};
+    State prevState = std::exchange(m_state, State::Canceled);
+    if (prevState == State::Created)
+    {
+      taskToCancel = std::move(m_task);
+    }
+    else if (prevState == State::Scheduled && TimerWheel::Instance().Cancel(this))
+    {
+      taskToCancel = std::move(m_task);
+      wheelRef = Mso::CntPtr<QueueTimer>{this, AttachTag}; // Release the reference added by Schedule.
+    }
+
+    // Otherwise, the task is canceled by OnTimerExpired or by the posted periodic task.
+  }
+
+  m_queue->RemoveTimer(this);
+  if (taskToCancel)
+  {
+    m_queue->CancelTask(std::move(taskToCancel));
+  }
+}
+
+void QueueTimer::OnTimerExpired() noexcept
+{
+  Mso::CntPtr<QueueTimer> self{this, AttachTag}; // Take the reference added by Schedule.
+  bool isCanceled{false};
+  {
+    std::lock_guard lock{m_mutex};
+    isCanceled = (m_state == State::Canceled);
+    m_state = isCanceled ? State::Canceled : State::Posted;
+  }
+
+  if (isCanceled)
+  {
+    // Cancel could not remove the timer from the wheel because it has already expired.
+    m_queue->CancelTask(std::move(m_task));
+  }
+  else if (m_period == std::chrono::steady_clock::duration::zero())
+  {
+    m_queue->RemoveTimer(this);
+    m_queue->Post(std::move(m_task));
+  }
+  else
+  {
+    m_queue->Post(Mso::MakeDispatchTask(
+        [self]() noexcept { self->InvokePeriodicTask(); }, [self]() noexcept { self->CancelPeriodicTask(); }));
+  }
+}
+
+void QueueTimer::Schedule(std::chrono::steady_clock::time_point time) noexcept
+{
+  m_state = State::Scheduled;
+  m_time = time;
+  AddRef(); // The timer is kept alive while it is in the wheel.
+  TimerWheel::Instance().Schedule(this, time);
+}
+
+void QueueTimer::InvokePeriodicTask() noexcept
+{
+  bool isCanceled{false};
+  {
+    std::lock_guard lock{m_mutex};
+    isCanceled = (m_state == State::Canceled);
+  }
+
+  if (isCanceled)
+  {
+    m_queue->CancelTask(std::move(m_task));
+    return;
+  }
+
+  m_task.Get()->Invoke();
+
+  DispatchTask taskToCancel;
+  {
+    std::lock_guard lock{m_mutex};
+    if (m_state == State::Canceled)
+    {
+      taskToCancel = std::move(m_task);
+    }
+    else
+    {
+      // Skip missed periods instead of posting them in a burst.
+      Schedule(std::max(m_time + m_period, std::chrono::steady_clock::now()));
+    }
+  }
+
+  if (taskToCancel)
+  {
+    m_queue->CancelTask(std::move(taskToCancel));
+  }
+}
+
+void QueueTimer::CancelPeriodicTask() noexcept
+{
+  DispatchTask taskToCancel;
+  {
+    std::lock_guard lock{m_mutex};
+    m_state = State::Canceled;
+    taskToCancel = std::move(m_task);
+  }
+
+  m_queue->RemoveTimer(this);
+  if (taskToCancel)
+  {
+    m_queue->CancelTask(std::move(taskToCancel));
+  }
+}
+
+} // namespace Mso
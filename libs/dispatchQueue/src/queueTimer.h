@@ -0,0 +1,57 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include <mutex>
+#include "dispatchQueue/dispatchQueue.h"
+#include "object/unknownObject.h"
+#include "queueService.h"
+#include "timerWheel.h"
+
+namespace Mso {
+
+//! A timer that posts the task to the QueueService when its time arrives.
+//! A one-shot timer posts the task itself. A periodic timer posts a task that invokes the timer task and then
+//! schedules the timer for the next period.
+//! The task is canceled by the first caller that observes the timer cancellation: Cancel, OnTimerExpired, or the
+//! periodic task posted to the queue.
+struct QueueTimer : Mso::UnknownObject<IDispatchTimer>, TimerWheelEntry
+{
+  QueueTimer(
+      Mso::CntPtr<QueueService>&& queue,
+      DispatchTask&& task,
+      std::chrono::steady_clock::duration period) noexcept;
+
+  //! Schedule the timer in the TimerWheel. It must be called only once.
+  void Start(std::chrono::steady_clock::time_point time) noexcept;
+
+public: // IDispatchTimer
+  void Cancel() noexcept override;
+
+public: // TimerWheelEntry
+  void OnTimerExpired() noexcept override;
+
+private:
+  enum class State
+  {
+    Created,
+    Scheduled,
+    Posted,
+    Canceled,
+  };
+
+  void Schedule(std::chrono::steady_clock::time_point time) noexcept;
+  void InvokePeriodicTask() noexcept;
+  void CancelPeriodicTask() noexcept;
+
+private:
+  const Mso::CntPtr<QueueService> m_queue;
+  const std::chrono::steady_clock::duration m_period; // Zero for one-shot timers.
+  std::mutex m_mutex;
+  State m_state{State::Created};
+  std::chrono::steady_clock::time_point m_time;
+  DispatchTask m_task;
+};
+
+} // namespace Mso
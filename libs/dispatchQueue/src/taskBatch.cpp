@@ -46,4 +46,69 @@ void TaskBatch::OnCancel() noexcept
   }
 }
 
+//=============================================================================
+// ThreadTaskBatches implementation.
+//=============================================================================
+
+/*static*/ void ThreadTaskBatches::Begin(IDispatchQueueService* queue) noexcept
+{
+  auto taskBatch{Mso::Make<TaskBatch>()};
+  std::vector<Entry>& entries = Entries();
+  for (Entry& entry : entries)
+  {
+    if (entry.Queue == queue)
+    {
+      taskBatch->SetEnclosingBatch(std::move(entry.Batch));
+      entry.Batch = std::move(taskBatch);
+      return;
+    }
+  }
+
+  entries.push_back(Entry{queue, std::move(taskBatch)});
+}
+
+/*static*/ Mso::CntPtr<TaskBatch> ThreadTaskBatches::End(IDispatchQueueService* queue) noexcept
+{
+  std::vector<Entry>& entries = Entries();
+  for (auto it = entries.begin(); it != entries.end(); ++it)
+  {
+    if (it->Queue == queue)
+    {
+      Mso::CntPtr<TaskBatch> taskBatch = std::move(it->Batch);
+      if (auto enclosingBatch = taskBatch->TakeEnclosingBatch())
+      {
+        it->Batch = std::move(enclosingBatch);
+      }
+      else
+      {
+        entries.erase(it);
+      }
+
+      return taskBatch;
+    }
+  }
+
+  return nullptr;
+}
+
+/*static*/ TaskBatch* ThreadTaskBatches::Find(IDispatchQueueService* queue) noexcept
+{
+  // A thread rarely batches tasks for more than one queue. Thus, the linear search is fast.
+  for (Entry& entry : Entries())
+  {
+    if (entry.Queue == queue)
+    {
+      return entry.Batch.Get();
+    }
+  }
+
+  return nullptr;
+}
+
+/*static*/ std::vector<ThreadTaskBatches::Entry>& ThreadTaskBatches::Entries() noexcept
+{
+  static thread_local std::vector<Entry> tls_entries;
+  return tls_entries;
+}
+
 } // namespace Mso
@@ -26,4 +26,29 @@ private:
   Mso::CntPtr<TaskBatch> m_enclosingBatch;
 };
 
+//! Registry of task batches started by the current thread.
+//! It lets Post check if the current thread batches tasks for a queue without taking any shared lock.
+//! A queue is identified by its address. It cannot be reused while the thread batches tasks for it because the
+//! DispatchTaskBatch keeps the queue alive.
+struct ThreadTaskBatches
+{
+  //! Start a new task batch for the queue. It becomes the enclosing batch for the new one if there is a current batch.
+  static void Begin(IDispatchQueueService* queue) noexcept;
+
+  //! Remove the current task batch for the queue and restore its enclosing batch. Returns null if there is no batch.
+  static Mso::CntPtr<TaskBatch> End(IDispatchQueueService* queue) noexcept;
+
+  //! Returns the current task batch for the queue or null.
+  static TaskBatch* Find(IDispatchQueueService* queue) noexcept;
+
+private:
+  struct Entry
+  {
+    IDispatchQueueService* Queue;
+    Mso::CntPtr<TaskBatch> Batch;
+  };
+
+  static std::vector<Entry>& Entries() noexcept;
+};
+
 } // namespace Mso
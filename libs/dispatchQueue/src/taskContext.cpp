@@ -43,4 +43,11 @@ DispatchTask TaskContext::TakeNextDeferredTask() noexcept
   return nullptr;
 }
 
+/*static*/ bool TaskContext::IsTimeExpired(IDispatchQueueService* queue) noexcept
+{
+  TaskContext* context = CurrentContext();
+  return context && context->m_queue == queue && context->m_endTime
+      && std::chrono::steady_clock::now() >= *context->m_endTime;
+}
+
 } // namespace Mso
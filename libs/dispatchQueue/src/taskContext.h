@@ -20,6 +20,9 @@ struct TaskContext
   static TaskContext* CurrentContext() noexcept;
   static IDispatchQueueService* CurrentQueue() noexcept;
 
+  //! True if the current task is invoked by the queue after the end time of its time slice.
+  static bool IsTimeExpired(IDispatchQueueService* queue) noexcept;
+
 private:
   inline static thread_local TaskContext* tls_context{nullptr};
   TaskContext* m_prevContext{nullptr};
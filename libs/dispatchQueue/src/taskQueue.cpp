@@ -2,116 +2,306 @@
 // Licensed under the MIT license.
 
 #include "taskQueue.h"
+#include <memory>
+#include <thread>
 
 namespace Mso {
 
 //=============================================================================
-// TaskReadBuffer implementation.
+// TaskQueue implementation details.
 //=============================================================================
 
-bool TaskReadBuffer::TryDequeue(DispatchTask& item) noexcept
+// Slot state bits.
+constexpr size_t SlotWritten{1}; // The task is written into the slot.
+constexpr size_t SlotRead{2}; // The task is read from the slot.
+constexpr size_t SlotDestroy{4}; // The block must be destroyed by the slot reader.
+
+// Each block has BlockLap - 1 slots. The index offset BlockCapacity is used while the next block is installed.
+constexpr size_t BlockLap{64};
+constexpr size_t BlockCapacity{BlockLap - 1};
+
+// The lowest index bit is reserved for the IndexHasNext flag.
+constexpr size_t IndexShift{1};
+constexpr size_t IndexStep{1 << IndexShift};
+constexpr size_t IndexHasNext{1};
+
+struct TaskQueue::Slot
 {
-  if (m_index < m_buffer.size())
+  Slot() noexcept {}
+  ~Slot() noexcept {}
+
+  void WaitWritten() const noexcept
   {
-    item = std::move(m_buffer[m_index]);
-    ++m_index;
-    return true;
+    while ((State.load(std::memory_order_acquire) & SlotWritten) == 0)
+    {
+      std::this_thread::yield();
+    }
   }
 
-  return false;
-}
+  union
+  {
+    DispatchTask Task;
+  };
+  std::atomic<size_t> State{0};
+};
 
-void TaskReadBuffer::SwapBuffer(std::vector<DispatchTask>& buffer) noexcept
+struct TaskQueue::Block
 {
-  // Before swapping erase deleted items in the beginning of the buffer.
-  m_buffer.erase(m_buffer.begin(), m_buffer.begin() + m_index);
-  m_index = 0;
-  m_buffer.swap(buffer);
-}
+  Block* WaitNext() const noexcept
+  {
+    for (;;)
+    {
+      if (Block* next = Next.load(std::memory_order_acquire))
+      {
+        return next;
+      }
 
-size_t TaskReadBuffer::Size() const noexcept
-{
-  return m_buffer.size() - m_index;
-}
+      std::this_thread::yield();
+    }
+  }
 
-bool TaskReadBuffer::IsEmpty() const noexcept
-{
-  return m_index == m_buffer.size();
-}
+  std::atomic<Block*> Next{nullptr};
+  Slot Slots[BlockCapacity];
+};
 
 //=============================================================================
 // TaskQueue implementation.
 //=============================================================================
 
+TaskQueue::TaskQueue() noexcept {}
+
 TaskQueue::TaskQueue(Mso::WeakPtr<IUnknown>&& weakOwnerPtr) noexcept : m_weakOwnerPtr{std::move(weakOwnerPtr)} {}
 
 TaskQueue::~TaskQueue() noexcept
 {
   VerifyElseCrashSz(IsEmpty(), "Queue must be empty before destruction.");
+
+  // All blocks before the head block are already deleted by consumers.
+  delete m_headBlock.load(std::memory_order_acquire);
 }
 
 void TaskQueue::Enqueue(DispatchTask&& task) noexcept
 {
-  bool queueWasEmpty{IsEmpty()};
-  m_writeBuffer.push_back(std::move(task));
-  if (queueWasEmpty)
+  if (m_size.fetch_add(1) == 0 && !m_weakOwnerPtr.IsEmpty())
   {
-    m_strongOwnerPtr = m_weakOwnerPtr.GetStrongPtr();
+    // Keep strong reference to the owner while queue is not empty.
+    // It is released by the consumer that makes the queue empty.
+    Mso::CntPtr<IUnknown> owner = m_weakOwnerPtr.GetStrongPtr();
+    VerifyElseCrashSz(owner, "Cannot enqueue a task into a destroyed queue");
+    owner.Detach();
   }
+
+  Push(std::move(task));
 }
 
 bool TaskQueue::TryDequeue(/*out*/ DispatchTask& task) noexcept
 {
-  if (m_readBuffer.IsEmpty() && !m_writeBuffer.empty())
+  if (!TryPop(/*out*/ task))
   {
-    m_readBuffer.SwapBuffer(m_writeBuffer);
+    return false;
   }
 
-  bool result = m_readBuffer.TryDequeue(/*out*/ task);
-  if (result && IsEmpty())
+  if (m_size.fetch_sub(1) == 1 && !m_weakOwnerPtr.IsEmpty())
   {
-    m_strongOwnerPtr = nullptr;
+    // Release the owner reference acquired by Enqueue.
+    // The owner is alive here because the consumer must hold a strong reference to it.
+    Mso::CntPtr<IUnknown> owner{m_weakOwnerPtr.GetStrongPtr()};
+    owner->Release();
   }
 
-  return result;
+  return true;
 }
 
 bool TaskQueue::DequeueAll(/*out*/ std::vector<DispatchTask>& tasks) noexcept
 {
-  if (IsEmpty())
+  bool result = false;
+  DispatchTask task;
+  while (TryDequeue(/*out*/ task))
   {
-    return false;
+    tasks.push_back(std::move(task));
+    result = true;
   }
 
-  tasks.reserve(tasks.size() + m_readBuffer.Size() + m_writeBuffer.size());
+  return result;
+}
 
-  if (!m_readBuffer.IsEmpty())
-  {
-    std::vector<DispatchTask> readBuffer;
-    m_readBuffer.SwapBuffer(readBuffer);
-    tasks.insert(tasks.end(), std::make_move_iterator(readBuffer.begin()), std::make_move_iterator(readBuffer.end()));
-  }
+size_t TaskQueue::Size() const noexcept
+{
+  return m_size.load();
+}
+
+bool TaskQueue::IsEmpty() const noexcept
+{
+  return m_size.load() == 0;
+}
+
+void TaskQueue::Push(DispatchTask&& task) noexcept
+{
+  std::unique_ptr<Block> nextBlock;
+  size_t tail = m_tailIndex.load(std::memory_order_acquire);
+  Block* block = m_tailBlock.load(std::memory_order_acquire);
 
-  if (!m_writeBuffer.empty())
+  for (;;)
   {
-    tasks.insert(
-        tasks.end(), std::make_move_iterator(m_writeBuffer.begin()), std::make_move_iterator(m_writeBuffer.end()));
-    m_writeBuffer.clear();
-  }
+    size_t offset = (tail >> IndexShift) % BlockLap;
 
-  m_strongOwnerPtr = nullptr;
+    // If we reached the end of the block, then wait until the next one is installed.
+    if (offset == BlockCapacity)
+    {
+      std::this_thread::yield();
+      tail = m_tailIndex.load(std::memory_order_acquire);
+      block = m_tailBlock.load(std::memory_order_acquire);
+      continue;
+    }
 
-  return true;
+    // If we are going to install the next block, then allocate it in advance to keep the critical window short.
+    if (offset + 1 == BlockCapacity && !nextBlock)
+    {
+      nextBlock = std::make_unique<Block>();
+    }
+
+    // The first Push allocates the first block.
+    if (!block)
+    {
+      auto newBlock = nextBlock ? std::move(nextBlock) : std::make_unique<Block>();
+      if (m_tailBlock.compare_exchange_strong(block, newBlock.get(), std::memory_order_release))
+      {
+        block = newBlock.release();
+        m_headBlock.store(block, std::memory_order_release);
+      }
+      else
+      {
+        nextBlock = std::move(newBlock);
+        tail = m_tailIndex.load(std::memory_order_acquire);
+        block = m_tailBlock.load(std::memory_order_acquire);
+        continue;
+      }
+    }
+
+    // Try to reserve the slot by moving the tail index forward.
+    if (m_tailIndex.compare_exchange_weak(tail, tail + IndexStep, std::memory_order_seq_cst, std::memory_order_acquire))
+    {
+      // If we reserved the last slot in the block, then install the next block.
+      if (offset + 1 == BlockCapacity)
+      {
+        Block* next = nextBlock.release();
+        m_tailBlock.store(next, std::memory_order_release);
+        m_tailIndex.store(tail + 2 * IndexStep, std::memory_order_release);
+        block->Next.store(next, std::memory_order_release);
+      }
+
+      Slot& slot = block->Slots[offset];
+      ::new (std::addressof(slot.Task)) DispatchTask{std::move(task)};
+      slot.State.fetch_or(SlotWritten, std::memory_order_release);
+      return;
+    }
+
+    block = m_tailBlock.load(std::memory_order_acquire);
+  }
 }
 
-size_t TaskQueue::Size() const noexcept
+bool TaskQueue::TryPop(/*out*/ DispatchTask& task) noexcept
 {
-  return m_readBuffer.Size() + m_writeBuffer.size();
+  size_t head = m_headIndex.load(std::memory_order_acquire);
+  Block* block = m_headBlock.load(std::memory_order_acquire);
+
+  for (;;)
+  {
+    size_t offset = (head >> IndexShift) % BlockLap;
+
+    // If we reached the end of the block, then wait until the next one is installed.
+    if (offset == BlockCapacity)
+    {
+      std::this_thread::yield();
+      head = m_headIndex.load(std::memory_order_acquire);
+      block = m_headBlock.load(std::memory_order_acquire);
+      continue;
+    }
+
+    size_t newHead = head + IndexStep;
+    if ((newHead & IndexHasNext) == 0)
+    {
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      size_t tail = m_tailIndex.load(std::memory_order_relaxed);
+
+      // The queue is empty if the head index equals the tail index.
+      if ((head >> IndexShift) == (tail >> IndexShift))
+      {
+        return false;
+      }
+
+      // If head and tail are in different blocks, then the head block has the next block.
+      if ((head >> IndexShift) / BlockLap != (tail >> IndexShift) / BlockLap)
+      {
+        newHead |= IndexHasNext;
+      }
+    }
+
+    // The block can be null only if the first Push is in progress.
+    if (!block)
+    {
+      std::this_thread::yield();
+      head = m_headIndex.load(std::memory_order_acquire);
+      block = m_headBlock.load(std::memory_order_acquire);
+      continue;
+    }
+
+    // Try to reserve the slot by moving the head index forward.
+    if (m_headIndex.compare_exchange_weak(head, newHead, std::memory_order_seq_cst, std::memory_order_acquire))
+    {
+      // If we reserved the last slot in the block, then move to the next block.
+      if (offset + 1 == BlockCapacity)
+      {
+        Block* next = block->WaitNext();
+        size_t nextIndex = (newHead & ~IndexHasNext) + IndexStep;
+        if (next->Next.load(std::memory_order_relaxed))
+        {
+          nextIndex |= IndexHasNext;
+        }
+
+        m_headBlock.store(next, std::memory_order_release);
+        m_headIndex.store(nextIndex, std::memory_order_release);
+      }
+
+      Slot& slot = block->Slots[offset];
+      slot.WaitWritten();
+      task = std::move(slot.Task);
+      slot.Task.~DispatchTask();
+
+      // Destroy the block if we read its last slot, or if another consumer wanted to destroy it,
+      // but could not do it because we were reading from this slot.
+      if (offset + 1 == BlockCapacity)
+      {
+        DestroyBlock(block, 0);
+      }
+      else if (slot.State.fetch_or(SlotRead, std::memory_order_acq_rel) & SlotDestroy)
+      {
+        DestroyBlock(block, offset + 1);
+      }
+
+      return true;
+    }
+
+    block = m_headBlock.load(std::memory_order_acquire);
+  }
 }
 
-bool TaskQueue::IsEmpty() const noexcept
+/*static*/ void TaskQueue::DestroyBlock(Block* block, size_t startIndex) noexcept
 {
-  return m_readBuffer.IsEmpty() && m_writeBuffer.empty();
+  // The last slot does not need the SlotDestroy bit because its reader starts the block destruction.
+  for (size_t i = startIndex; i < BlockCapacity - 1; ++i)
+  {
+    Slot& slot = block->Slots[i];
+
+    // If a consumer still reads from the slot, then it continues the block destruction.
+    if ((slot.State.load(std::memory_order_acquire) & SlotRead) == 0
+        && (slot.State.fetch_or(SlotDestroy, std::memory_order_acq_rel) & SlotRead) == 0)
+    {
+      return;
+    }
+  }
+
+  delete block;
 }
 
 } // namespace Mso
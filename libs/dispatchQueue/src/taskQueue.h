@@ -3,39 +3,23 @@
 
 #pragma once
 
+#include <atomic>
 #include <vector>
 #include "dispatchQueue/dispatchQueue.h"
-#include "threadMutex.h"
 
 namespace Mso {
 
-//! ReadBuffer is used by task queue to dequeue items.
-//! It moves read index instead of resizing buffer.
-struct TaskReadBuffer
-{
-  TaskReadBuffer() = default;
-
-  // Prohibit copy and move
-  TaskReadBuffer(TaskReadBuffer const& other) = delete;
-  TaskReadBuffer& operator=(TaskReadBuffer const& other) = delete;
-
-  bool TryDequeue(DispatchTask& task) noexcept;
-  void SwapBuffer(std::vector<DispatchTask>& buffer) noexcept;
-  size_t Size() const noexcept;
-  bool IsEmpty() const noexcept;
-
-private:
-  std::vector<DispatchTask> m_buffer;
-  size_t m_index{0};
-};
-
-//! Simple queue that uses two buffers: one for pushing items and another for popping them.
-//! Items are always enqueued under lock.
+//! Unbounded lock-free multi-producer multi-consumer queue of dispatch tasks.
+//!
+//! Tasks are stored in a single linked list of fixed size blocks. Producers reserve a slot by moving the tail index
+//! forward with a CAS operation, and consumers reserve a slot by moving the head index forward. A block is deleted
+//! by the last consumer that finishes reading from it. The algorithm follows the crossbeam's SegQueue.
 //!
-//! Internally we have two vectors: one to enqueue items (write) and another to dequeue items (read).
-//! When the read queue is empty we swap them.
+//! The queue keeps a strong reference to its owner while it is not empty. A queue created without an owner is used
+//! by objects that are never destroyed such as the WorkerPool.
 struct TaskQueue
 {
+  TaskQueue() noexcept;
   TaskQueue(Mso::WeakPtr<IUnknown>&& weakOwnerPtr) noexcept;
 
   ~TaskQueue() noexcept;
@@ -51,10 +35,29 @@ struct TaskQueue
   bool IsEmpty() const noexcept;
 
 private:
-  std::vector<DispatchTask> m_writeBuffer; // To enqueue items.
-  TaskReadBuffer m_readBuffer; // To dequeue items.
+  struct Slot;
+  struct Block;
+
+  void Push(DispatchTask&& task) noexcept;
+  bool TryPop(DispatchTask& task) noexcept;
+  static void DestroyBlock(Block* block, size_t startIndex) noexcept;
+
+private:
+  constexpr static size_t CacheLineSize{64};
+
+  // Index of the next slot to read. Its lowest bit indicates that the head block has the next block.
+  std::atomic<size_t> m_headIndex{0};
+  std::atomic<Block*> m_headBlock{nullptr};
+  uint8_t m_headPadding[CacheLineSize - sizeof(std::atomic<size_t>) - sizeof(std::atomic<Block*>)];
+
+  // Index of the next slot to write.
+  std::atomic<size_t> m_tailIndex{0};
+  std::atomic<Block*> m_tailBlock{nullptr};
+  uint8_t m_tailPadding[CacheLineSize - sizeof(std::atomic<size_t>) - sizeof(std::atomic<Block*>)];
+
+  // Number of enqueued tasks. It is incremented before a task is pushed and decremented after it is popped.
+  std::atomic<size_t> m_size{0};
   Mso::WeakPtr<IUnknown> m_weakOwnerPtr;
-  Mso::CntPtr<IUnknown> m_strongOwnerPtr; // Keep strong reference to the owner when queu is not empty;
 };
 
 } // namespace Mso
@@ -3,28 +3,33 @@
 
 #include "dispatchQueue/dispatchQueue.h"
 #include "queueService.h"
+#include "workerPool.h"
 
-#include <array>
+#include <algorithm>
+#include <atomic>
 #include <condition_variable>
 #include <mutex>
 
 namespace Mso {
 
-struct ThreadPoolSchedulerLinux : Mso::UnknownObject<IDispatchQueueScheduler>
+struct ThreadPoolSchedulerLinux : Mso::UnknownObject<IDispatchQueueScheduler, IDispatchPriorityScheduler>
 {
   ThreadPoolSchedulerLinux(uint32_t maxThreads) noexcept;
   ~ThreadPoolSchedulerLinux() noexcept override;
 
-  void RunInThread() noexcept;
+  static size_t WorkCallback(IUnknown* context) noexcept;
 
 public: // IDispatchQueueScheduler
   void IntializeScheduler(Mso::WeakPtr<IDispatchQueueService>&& queue) noexcept override;
   bool HasThreadAccess() noexcept override;
   bool IsSerial() noexcept override;
-  void Post() noexcept override;
+  void Post(size_t taskCount) noexcept override;
   void Shutdown() noexcept override;
   void AwaitTermination() noexcept override;
 
+public: // IDispatchPriorityScheduler
+  void PostHighPriority(size_t taskCount) noexcept override;
+
 private:
   struct ThreadAccessGuard
   {
@@ -38,17 +43,16 @@ private:
     static thread_local ThreadPoolSchedulerLinux* tls_scheduler;
   };
 
-private:
-  constexpr static uint32_t MaxConcurrentThreads{64};
+  void SubmitWork(size_t taskCount, bool isHighPriority) noexcept;
+  void ReleaseThread() noexcept;
+  uint32_t GetMaxThreads() const noexcept;
 
+private:
   Mso::WeakPtr<IDispatchQueueService> m_queue;
-  std::condition_variable m_wakeUpThread;
-  std::mutex m_threadMutex;
-  const uint32_t m_maxThreads{1};
-  uint32_t m_busyThreads{0};
-  uint32_t m_threadCount{0};
-  bool m_isShutdown{false};
-  std::array<std::thread, (size_t)MaxConcurrentThreads> m_threads;
+  const uint32_t m_maxThreads{1}; // Zero means that only the WorkerPool limits the number of threads.
+  std::atomic<uint32_t> m_usedThreads{0};
+  std::mutex m_terminationMutex;
+  std::condition_variable m_threadReleased;
 };
 
 //=============================================================================
@@ -56,7 +60,7 @@ private:
 //=============================================================================
 
 ThreadPoolSchedulerLinux::ThreadPoolSchedulerLinux(uint32_t maxThreads) noexcept
-    : m_maxThreads{maxThreads == 0 ? MaxConcurrentThreads : maxThreads}
+    : m_maxThreads{maxThreads}
 {
 }
 
@@ -65,41 +69,53 @@ ThreadPoolSchedulerLinux::~ThreadPoolSchedulerLinux() noexcept
   AwaitTermination();
 }
 
-void ThreadPoolSchedulerLinux::RunInThread() noexcept
+/*static*/ size_t ThreadPoolSchedulerLinux::WorkCallback(IUnknown* context) noexcept
 {
-  ThreadAccessGuard guard{this};
-  for (;;)
+  // The ThreadPoolSchedulerLinux is alive here because WorkerPool keeps the context alive during the callback.
+  // The context is submitted as the IDispatchQueueScheduler base because the IUnknown base is ambiguous.
+  auto self = static_cast<ThreadPoolSchedulerLinux*>(static_cast<IDispatchQueueScheduler*>(context));
+  size_t completedTaskCount{0};
+
+  if (auto queue = self->m_queue.GetStrongPtr())
   {
-    if (auto queue = m_queue.GetStrongPtr())
     {
+      ThreadAccessGuard guard{self};
+
+      // Run the queue tasks until the time slice expires. Then, re-submit the remaining work to the end of the
+      // WorkerPool queue to let the work of other queues run first.
+      auto endTime = DispatchQueueStatic::StartTimeSlice();
       DispatchTask task;
       while (queue->TryDequeTask(/*ref*/ task))
       {
-        queue->InvokeTask(std::move(task), std::nullopt);
-      }
-
-      std::unique_lock lock{m_threadMutex};
-      --m_busyThreads;
-      if (m_isShutdown)
-      {
-        break;
-      }
-      else if (queue->HasTasks())
-      {
-        ++m_busyThreads;
-        continue;
+        queue->InvokeTask(std::move(task), endTime);
+        ++completedTaskCount;
+        if (std::chrono::steady_clock::now() >= endTime)
+        {
+          break;
+        }
       }
+    }
 
-      queue = nullptr; // release the queue
+    self->ReleaseThread(); // We finished using this thread.
 
-      m_wakeUpThread.wait(lock);
-      ++m_busyThreads;
+    // Pairs with the fence in SubmitWork: either we see the task posted after the draining loop, or its poster sees
+    // the released thread and submits new work.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (queue->HasHighPriorityTasks())
+    {
+      self->PostHighPriority(/*taskCount:*/ 1);
     }
-    else
+    else if (queue->HasTasks())
     {
-      break;
+      self->Post(/*taskCount:*/ 1);
     }
   }
+  else
+  {
+    self->ReleaseThread();
+  }
+
+  return completedTaskCount;
 }
 
 void ThreadPoolSchedulerLinux::IntializeScheduler(Mso::WeakPtr<IDispatchQueueService>&& queue) noexcept
@@ -117,41 +133,72 @@ bool ThreadPoolSchedulerLinux::IsSerial() noexcept
   return m_maxThreads == 1;
 }
 
-void ThreadPoolSchedulerLinux::Post() noexcept
+void ThreadPoolSchedulerLinux::Post(size_t taskCount) noexcept
 {
-  std::unique_lock lock{m_threadMutex};
+  SubmitWork(taskCount, /*isHighPriority:*/ false);
+}
 
-  // See if we need to increase number of threads
-  if (m_busyThreads == m_threadCount && m_threadCount < m_maxThreads)
-  {
-    ++m_busyThreads;
-    m_threads[m_threadCount++] = std::thread(&ThreadPoolSchedulerLinux::RunInThread, this);
-  }
-  else
+void ThreadPoolSchedulerLinux::PostHighPriority(size_t taskCount) noexcept
+{
+  SubmitWork(taskCount, /*isHighPriority:*/ true);
+}
+
+void ThreadPoolSchedulerLinux::SubmitWork(size_t taskCount, bool isHighPriority) noexcept
+{
+  // Submit work to the shared WorkerPool for each new task while the number of used threads is below maxThreads.
+  // The fence orders the load after the task enqueue. It pairs with the fence in WorkCallback after ReleaseThread to
+  // avoid a lost wake up where we see all threads used while the last worker misses the new task.
+  uint32_t maxThreads = GetMaxThreads();
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  uint32_t usedThreads = m_usedThreads.load(std::memory_order_seq_cst);
+  uint32_t newThreads{0};
+  do
   {
-    m_wakeUpThread.notify_one();
-  }
+    if (usedThreads >= maxThreads)
+    {
+      return;
+    }
+
+    newThreads = static_cast<uint32_t>(std::min<size_t>(taskCount, maxThreads - usedThreads));
+  } while (!m_usedThreads.compare_exchange_weak(
+      usedThreads, usedThreads + newThreads, std::memory_order_seq_cst, std::memory_order_seq_cst));
+
+  WorkerPool::Instance().Submit(
+      &WorkCallback, Mso::CntPtr<IUnknown>{static_cast<IDispatchQueueScheduler*>(this)}, newThreads, isHighPriority);
 }
 
 void ThreadPoolSchedulerLinux::Shutdown() noexcept
 {
-  std::unique_lock lock{m_threadMutex};
-  m_isShutdown = true;
-  m_wakeUpThread.notify_all();
+  // It is not used by this scheduler
 }
 
 void ThreadPoolSchedulerLinux::AwaitTermination() noexcept
 {
-  Shutdown();
-  for (auto& thread : m_threads)
+  // When called from the queue thread, we can only wait for other threads to complete.
+  uint32_t ownThreads = HasThreadAccess() ? 1 : 0;
+  std::unique_lock lock{m_terminationMutex};
+  m_threadReleased.wait(lock, [&]() noexcept {
+    // The queue is expired when AwaitTermination is called from its destructor. No tasks can run at this point.
+    auto queue = m_queue.GetStrongPtr();
+    return !queue || (m_usedThreads.load() <= ownThreads && (ownThreads > 0 || !queue->HasTasks()));
+  });
+}
+
+void ThreadPoolSchedulerLinux::ReleaseThread() noexcept
+{
+  if (--m_usedThreads <= 1)
   {
-    if (thread.joinable())
-    {
-      thread.join();
-    }
+    // Take the lock to avoid missing the notification while AwaitTermination checks the wait condition.
+    std::lock_guard lock{m_terminationMutex};
+    m_threadReleased.notify_all();
   }
 }
 
+uint32_t ThreadPoolSchedulerLinux::GetMaxThreads() const noexcept
+{
+  return m_maxThreads != 0 ? m_maxThreads : WorkerPool::Instance().GetMaxThreadCount();
+}
+
 //=============================================================================
 // ThreadPoolSchedulerLinux::ThreadAccessGuard implementation
 //=============================================================================
@@ -3,8 +3,8 @@
 
 #include "dispatchQueue/dispatchQueue.h"
 #include "queueService.h"
-
-using namespace std::chrono_literals;
+#include <algorithm>
+#include <thread>
 
 namespace Mso {
 
@@ -27,7 +27,7 @@ public: // IDispatchQueueScheduler
   void IntializeScheduler(Mso::WeakPtr<IDispatchQueueService>&& queue) noexcept override;
   bool HasThreadAccess() noexcept override;
   bool IsSerial() noexcept override;
-  void Post() noexcept override;
+  void Post(size_t taskCount) noexcept override;
   void Shutdown() noexcept override;
   void AwaitTermination() noexcept override;
 
@@ -92,12 +92,12 @@ ThreadPoolSchedulerWin::~ThreadPoolSchedulerWin() noexcept
   {
     ThreadAccessGuard guard{self};
 
-    auto endTime = std::chrono::steady_clock::now() + 100ms;
+    auto endTime = DispatchQueueStatic::StartTimeSlice();
     DispatchTask task;
     while (queue->TryDequeTask(/*ref*/ task))
     {
       queue->InvokeTask(std::move(task), endTime);
-      if (std::chrono::steady_clock::now() > endTime)
+      if (std::chrono::steady_clock::now() >= endTime)
       {
         break;
       }
@@ -107,7 +107,7 @@ ThreadPoolSchedulerWin::~ThreadPoolSchedulerWin() noexcept
 
     if (queue->HasTasks())
     {
-      self->Post();
+      self->Post(/*taskCount:*/ 1);
     }
   }
 }
@@ -127,20 +127,26 @@ bool ThreadPoolSchedulerWin::IsSerial() noexcept
   return m_maxThreads == 1;
 }
 
-void ThreadPoolSchedulerWin::Post() noexcept
+void ThreadPoolSchedulerWin::Post(size_t taskCount) noexcept
 {
-  // Call SubmitThreadpoolWork if number of used threads is below m_maxThreads
+  // Call SubmitThreadpoolWork for each new task while the number of used threads is below m_maxThreads
   uint32_t usedThreads = m_usedThreads.load(std::memory_order_relaxed);
+  uint32_t newThreads{0};
   do
   {
     if (usedThreads == m_maxThreads)
     {
       return;
     }
+
+    newThreads = static_cast<uint32_t>(std::min<size_t>(taskCount, m_maxThreads - usedThreads));
   } while (!m_usedThreads.compare_exchange_weak(
-      usedThreads, usedThreads + 1, std::memory_order_release, std::memory_order_relaxed));
+      usedThreads, usedThreads + newThreads, std::memory_order_release, std::memory_order_relaxed));
 
-  ::SubmitThreadpoolWork(m_threadPoolWork.get());
+  for (uint32_t i = 0; i < newThreads; ++i)
+  {
+    ::SubmitThreadpoolWork(m_threadPoolWork.get());
+  }
 }
 
 void ThreadPoolSchedulerWin::Shutdown() noexcept
@@ -185,4 +191,35 @@ ThreadPoolSchedulerWin::ThreadAccessGuard::~ThreadAccessGuard() noexcept
   return Mso::Make<ThreadPoolSchedulerWin, IDispatchQueueScheduler>(maxThreads);
 }
 
+//=============================================================================
+// Thread pool configuration functions
+//=============================================================================
+
+uint32_t GetAvailableProcessorCount() noexcept
+{
+  static const uint32_t processorCount = std::max(std::thread::hardware_concurrency(), 1u);
+  return processorCount;
+}
+
+// The Windows thread pool manages its own worker threads. Thus, the idle policy, thread limits, and blocking regions
+// are not used.
+
+void SetThreadPoolIdlePolicy(ThreadPoolIdlePolicy const& /*policy*/) noexcept {}
+
+ThreadPoolIdleStats GetThreadPoolIdleStats() noexcept
+{
+  return {};
+}
+
+void SetThreadPoolConfig(ThreadPoolConfig const& /*config*/) noexcept {}
+
+ThreadPoolControllerState GetThreadPoolControllerState() noexcept
+{
+  return {};
+}
+
+void BeginDispatchBlocking() noexcept {}
+
+void EndDispatchBlocking() noexcept {}
+
 } // namespace Mso
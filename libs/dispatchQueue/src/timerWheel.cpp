@@ -0,0 +1,249 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "timerWheel.h"
+#include <algorithm>
+#include <utility>
+#include "crash/verifyElseCrash.h"
+
+namespace Mso {
+
+//=============================================================================
+// TimerWheel implementation
+//=============================================================================
+
+/*static*/ TimerWheel& TimerWheel::Instance() noexcept
+{
+  static TimerWheel* instance{new TimerWheel()};
+  return *instance;
+}
+
+TimerWheel::TimerWheel() noexcept : m_startTime{std::chrono::steady_clock::now()}
+{
+  m_thread = std::thread([this]() noexcept { Run(); });
+}
+
+void TimerWheel::Schedule(TimerWheelEntry* entry, std::chrono::steady_clock::time_point expireTime) noexcept
+{
+  std::lock_guard lock{m_mutex};
+  VerifyElseCrashSz(!entry->m_prevNext, "The timer entry is already scheduled");
+
+  // The entry must not expire before the expireTime. Thus, we round it up to the next tick.
+  entry->m_expireTick = std::max(ToTick(expireTime, /*roundUp:*/ true), m_currentTick + 1);
+  Insert(entry);
+
+  if (NextWakeUpTick() < m_wakeUpTick)
+  {
+    m_wakeUp.notify_one();
+  }
+}
+
+bool TimerWheel::Cancel(TimerWheelEntry* entry) noexcept
+{
+  std::lock_guard lock{m_mutex};
+  if (!entry->m_prevNext)
+  {
+    return false;
+  }
+
+  Remove(entry);
+  return true;
+}
+
+void TimerWheel::Run() noexcept
+{
+  std::vector<TimerWheelEntry*> expiredEntries;
+  std::unique_lock lock{m_mutex};
+  for (;;)
+  {
+    Advance(ToTick(std::chrono::steady_clock::now(), /*roundUp:*/ false), /*out*/ expiredEntries);
+    if (!expiredEntries.empty())
+    {
+      // Avoid Schedule notifications while we are not waiting.
+      m_wakeUpTick = 0;
+      lock.unlock();
+
+      for (TimerWheelEntry* entry : expiredEntries)
+      {
+        entry->OnTimerExpired();
+      }
+
+      expiredEntries.clear();
+      lock.lock();
+      continue;
+    }
+
+    m_wakeUpTick = NextWakeUpTick();
+    if (m_wakeUpTick == NoWakeUpTick)
+    {
+      m_wakeUp.wait(lock);
+    }
+    else
+    {
+      m_wakeUp.wait_until(lock, m_startTime + m_wakeUpTick * TickDuration);
+    }
+  }
+}
+
+uint64_t TimerWheel::ToTick(std::chrono::steady_clock::time_point time, bool roundUp) const noexcept
+{
+  if (time <= m_startTime)
+  {
+    return 0;
+  }
+
+  auto elapsed = time - m_startTime;
+  uint64_t tick = static_cast<uint64_t>(elapsed / TickDuration);
+  if (roundUp && tick * TickDuration < elapsed)
+  {
+    ++tick;
+  }
+
+  return tick;
+}
+
+void TimerWheel::Insert(TimerWheelEntry* entry) noexcept
+{
+  // Find the highest tick digit that differs between the expire tick and the current tick.
+  uint64_t diff = entry->m_expireTick ^ m_currentTick;
+  uint32_t level = 0;
+  while (level < LevelCount && (diff >> ((level + 1) * SlotBits)) != 0)
+  {
+    ++level;
+  }
+
+  TimerWheelEntry** head = &m_overflow;
+  if (level < LevelCount)
+  {
+    uint32_t slot = static_cast<uint32_t>(entry->m_expireTick >> (level * SlotBits)) & (SlotCount - 1);
+    head = &m_levels[level].Slots[slot];
+    m_levels[level].OccupiedSlots |= uint64_t{1} << slot;
+  }
+
+  entry->m_level = level;
+  entry->m_next = *head;
+  if (entry->m_next)
+  {
+    entry->m_next->m_prevNext = &entry->m_next;
+  }
+
+  entry->m_prevNext = head;
+  *head = entry;
+}
+
+void TimerWheel::Remove(TimerWheelEntry* entry) noexcept
+{
+  *entry->m_prevNext = entry->m_next;
+  if (entry->m_next)
+  {
+    entry->m_next->m_prevNext = entry->m_prevNext;
+  }
+
+  if (entry->m_level < LevelCount)
+  {
+    Level& level = m_levels[entry->m_level];
+    uint32_t slot = static_cast<uint32_t>(entry->m_expireTick >> (entry->m_level * SlotBits)) & (SlotCount - 1);
+    if (!level.Slots[slot])
+    {
+      level.OccupiedSlots &= ~(uint64_t{1} << slot);
+    }
+  }
+
+  entry->m_next = nullptr;
+  entry->m_prevNext = nullptr;
+}
+
+void TimerWheel::Advance(uint64_t tick, /*out*/ std::vector<TimerWheelEntry*>& expiredEntries) noexcept
+{
+  if (tick <= m_currentTick)
+  {
+    return;
+  }
+
+  size_t firstEntry = expiredEntries.size();
+  auto takeEntries = [&expiredEntries](TimerWheelEntry*& head) noexcept {
+    for (TimerWheelEntry* entry = std::exchange(head, nullptr); entry;)
+    {
+      TimerWheelEntry* next = entry->m_next;
+      entry->m_next = nullptr;
+      entry->m_prevNext = nullptr;
+      expiredEntries.push_back(entry);
+      entry = next;
+    }
+  };
+
+  if ((m_currentTick >> (LevelCount * SlotBits)) != (tick >> (LevelCount * SlotBits)))
+  {
+    takeEntries(m_overflow);
+  }
+
+  // Take entries from all slots that the current tick passes. If a slot does not change at some level, then it does
+  // not change at the higher levels either.
+  for (uint32_t levelIndex = 0; levelIndex < LevelCount; ++levelIndex)
+  {
+    uint64_t prevSlot = m_currentTick >> (levelIndex * SlotBits);
+    uint64_t newSlot = tick >> (levelIndex * SlotBits);
+    if (prevSlot == newSlot)
+    {
+      break;
+    }
+
+    Level& level = m_levels[levelIndex];
+    uint64_t passedSlotCount = std::min<uint64_t>(newSlot - prevSlot, SlotCount);
+    for (uint64_t i = 1; i <= passedSlotCount && level.OccupiedSlots != 0; ++i)
+    {
+      uint32_t slot = static_cast<uint32_t>(prevSlot + i) & (SlotCount - 1);
+      takeEntries(level.Slots[slot]);
+      level.OccupiedSlots &= ~(uint64_t{1} << slot);
+    }
+  }
+
+  m_currentTick = tick;
+
+  // Move entries that are not expired yet to the lower levels.
+  auto notExpired = std::remove_if(
+      expiredEntries.begin() + firstEntry, expiredEntries.end(), [this](TimerWheelEntry* entry) noexcept {
+        if (entry->m_expireTick > m_currentTick)
+        {
+          Insert(entry);
+          return true;
+        }
+
+        return false;
+      });
+  expiredEntries.erase(notExpired, expiredEntries.end());
+}
+
+uint64_t TimerWheel::NextWakeUpTick() const noexcept
+{
+  // All entries at a level are in the slots after the current tick slot, and they expire before entries at the
+  // higher levels. For levels above zero we wake up at the slot start to move its entries to the lower levels.
+  for (uint32_t levelIndex = 0; levelIndex < LevelCount; ++levelIndex)
+  {
+    uint32_t shift = levelIndex * SlotBits;
+    uint32_t currentSlot = static_cast<uint32_t>(m_currentTick >> shift) & (SlotCount - 1);
+    uint64_t laterSlots =
+        (currentSlot + 1 < SlotCount) ? m_levels[levelIndex].OccupiedSlots & (~uint64_t{0} << (currentSlot + 1)) : 0;
+    if (laterSlots != 0)
+    {
+      uint32_t slot = currentSlot + 1;
+      while ((laterSlots & (uint64_t{1} << slot)) == 0)
+      {
+        ++slot;
+      }
+
+      uint32_t blockShift = shift + SlotBits;
+      return ((m_currentTick >> blockShift) << blockShift) | (uint64_t{slot} << shift);
+    }
+  }
+
+  if (m_overflow)
+  {
+    uint32_t blockShift = LevelCount * SlotBits;
+    return ((m_currentTick >> blockShift) + 1) << blockShift;
+  }
+
+  return NoWakeUpTick;
+}
+
+} // namespace Mso
@@ -0,0 +1,85 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Mso {
+
+//! An entry scheduled in the TimerWheel.
+//! The entry owner must keep the entry alive while it is scheduled and while OnTimerExpired is running.
+struct TimerWheelEntry
+{
+  //! Called by the timer thread after the entry is removed from the wheel. It is called outside of the wheel lock,
+  //! and it must return quickly because it delays all other timers.
+  virtual void OnTimerExpired() noexcept = 0;
+
+protected:
+  ~TimerWheelEntry() = default;
+
+private:
+  friend struct TimerWheel;
+
+  TimerWheelEntry* m_next{nullptr};
+  TimerWheelEntry** m_prevNext{nullptr}; // Address of the pointer to this entry. It is null when not scheduled.
+  uint64_t m_expireTick{0};
+  uint32_t m_level{0};
+};
+
+//! Process-wide hierarchical timer wheel with a single timer thread.
+//!
+//! Time is divided into ticks of TickDuration. Each level has SlotCount slots, and a slot at level N covers
+//! SlotCount^N ticks. An entry is added to the level of the highest tick digit that differs between its expire tick
+//! and the current tick. When the current tick reaches a slot of a higher level, its entries are moved to the lower
+//! levels. Schedule and Cancel are O(1), and the timer thread sleeps until the nearest slot with entries is due.
+struct TimerWheel
+{
+  //! The wheel is created on demand and is never destroyed because dispatch queues may be used in static destructors.
+  static TimerWheel& Instance() noexcept;
+
+  //! Schedule the entry to expire at the provided time. The entry must not be already scheduled.
+  void Schedule(TimerWheelEntry* entry, std::chrono::steady_clock::time_point expireTime) noexcept;
+
+  //! Remove the entry from the wheel. It returns false if the entry is not scheduled, e.g. because it has expired.
+  bool Cancel(TimerWheelEntry* entry) noexcept;
+
+private:
+  constexpr static std::chrono::milliseconds TickDuration{1};
+  constexpr static uint32_t SlotBits{6};
+  constexpr static uint32_t SlotCount{1u << SlotBits};
+  constexpr static uint32_t LevelCount{4}; // Levels cover up to 2^24 ticks. Later entries are kept in m_overflow.
+  constexpr static uint64_t NoWakeUpTick{UINT64_MAX};
+
+  struct Level
+  {
+    std::array<TimerWheelEntry*, SlotCount> Slots{};
+    uint64_t OccupiedSlots{0}; // A bit per slot that has entries.
+  };
+
+  TimerWheel() noexcept;
+
+  void Run() noexcept;
+  uint64_t ToTick(std::chrono::steady_clock::time_point time, bool roundUp) const noexcept;
+  void Insert(TimerWheelEntry* entry) noexcept;
+  void Remove(TimerWheelEntry* entry) noexcept;
+  void Advance(uint64_t tick, /*out*/ std::vector<TimerWheelEntry*>& expiredEntries) noexcept;
+  uint64_t NextWakeUpTick() const noexcept;
+
+private:
+  std::mutex m_mutex;
+  std::condition_variable m_wakeUp;
+  const std::chrono::steady_clock::time_point m_startTime;
+  uint64_t m_currentTick{0};
+  uint64_t m_wakeUpTick{NoWakeUpTick}; // The tick the timer thread sleeps until.
+  std::array<Level, LevelCount> m_levels;
+  TimerWheelEntry* m_overflow{nullptr};
+  std::thread m_thread;
+};
+
+} // namespace Mso
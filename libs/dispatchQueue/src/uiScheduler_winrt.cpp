@@ -51,7 +51,7 @@ public: // IDispatchQueueScheduler
   void IntializeScheduler(Mso::WeakPtr<IDispatchQueueService>&& queue) noexcept override;
   bool HasThreadAccess() noexcept override;
   bool IsSerial() noexcept override;
-  void Post() noexcept override;
+  void Post(size_t taskCount) noexcept override;
   void Shutdown() noexcept override;
   void AwaitTermination() noexcept override;
 
@@ -213,19 +213,24 @@ bool UISchedulerWinRT::IsSerial() noexcept
   return true;
 }
 
-void UISchedulerWinRT::Post() noexcept
+void UISchedulerWinRT::Post(size_t taskCount) noexcept
 {
-  DispatchedHandler handler;
+  // Each dispatched handler invokes one task to let the CoreDispatcher process UI events between tasks.
+  std::vector<DispatchedHandler> handlers;
   {
     std::lock_guard lock{m_mutex};
     if (!m_isShutdown)
     {
-      ++m_taskCount;
-      handler = MakeDispatchedHandler();
+      m_taskCount += static_cast<uint32_t>(taskCount);
+      handlers.reserve(taskCount);
+      for (size_t i = 0; i < taskCount; ++i)
+      {
+        handlers.push_back(MakeDispatchedHandler());
+      }
     }
   }
 
-  if (handler)
+  for (DispatchedHandler& handler : handlers)
   {
     m_coreDispatcher.RunAsync(CoreDispatcherPriority::Normal, std::move(handler));
   }
@@ -0,0 +1,130 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "workStealingDeque.h"
+
+namespace Mso {
+
+//=============================================================================
+// WorkStealingDeque implementation details.
+//=============================================================================
+
+struct WorkStealingDeque::Buffer
+{
+  Buffer(int64_t capacity) noexcept : Capacity{capacity}, Items{new std::atomic<IVoidFunctor*>[capacity]} {}
+
+  IVoidFunctor* Get(int64_t index) const noexcept
+  {
+    return Items[index & (Capacity - 1)].load(std::memory_order_relaxed);
+  }
+
+  void Put(int64_t index, IVoidFunctor* item) noexcept
+  {
+    Items[index & (Capacity - 1)].store(item, std::memory_order_relaxed);
+  }
+
+  const int64_t Capacity; // Must be a power of two.
+  std::unique_ptr<std::atomic<IVoidFunctor*>[]> Items;
+};
+
+//=============================================================================
+// WorkStealingDeque implementation.
+//=============================================================================
+
+WorkStealingDeque::WorkStealingDeque() noexcept
+{
+  m_buffers.push_back(std::make_unique<Buffer>(InitialCapacity));
+  m_buffer.store(m_buffers.back().get(), std::memory_order_relaxed);
+}
+
+WorkStealingDeque::~WorkStealingDeque() noexcept
+{
+  VerifyElseCrashSz(IsEmpty(), "Deque must be empty before destruction.");
+}
+
+void WorkStealingDeque::Push(DispatchTask&& task) noexcept
+{
+  int64_t bottom = m_bottom.load(std::memory_order_relaxed);
+  int64_t top = m_top.load(std::memory_order_acquire);
+  Buffer* buffer = m_buffer.load(std::memory_order_relaxed);
+  if (bottom - top > buffer->Capacity - 1)
+  {
+    buffer = Grow(buffer, top, bottom);
+  }
+
+  buffer->Put(bottom, task.Detach());
+  std::atomic_thread_fence(std::memory_order_release);
+  m_bottom.store(bottom + 1, std::memory_order_relaxed);
+}
+
+bool WorkStealingDeque::TryPop(/*out*/ DispatchTask& task) noexcept
+{
+  int64_t bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+  Buffer* buffer = m_buffer.load(std::memory_order_relaxed);
+  m_bottom.store(bottom, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  int64_t top = m_top.load(std::memory_order_relaxed);
+
+  if (top > bottom)
+  {
+    // The deque is empty.
+    m_bottom.store(bottom + 1, std::memory_order_relaxed);
+    return false;
+  }
+
+  IVoidFunctor* item = buffer->Get(bottom);
+  if (top == bottom)
+  {
+    // This is the last item. Compete with thieves for it.
+    bool isWon = m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+    m_bottom.store(bottom + 1, std::memory_order_relaxed);
+    if (!isWon)
+    {
+      return false;
+    }
+  }
+
+  task = DispatchTask{item, AttachTag};
+  return true;
+}
+
+bool WorkStealingDeque::TrySteal(/*out*/ DispatchTask& task) noexcept
+{
+  int64_t top = m_top.load(std::memory_order_acquire);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  int64_t bottom = m_bottom.load(std::memory_order_acquire);
+
+  if (top >= bottom)
+  {
+    return false;
+  }
+
+  IVoidFunctor* item = m_buffer.load(std::memory_order_acquire)->Get(top);
+  if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+  {
+    return false;
+  }
+
+  task = DispatchTask{item, AttachTag};
+  return true;
+}
+
+bool WorkStealingDeque::IsEmpty() const noexcept
+{
+  return m_bottom.load(std::memory_order_acquire) <= m_top.load(std::memory_order_acquire);
+}
+
+WorkStealingDeque::Buffer* WorkStealingDeque::Grow(Buffer* buffer, int64_t top, int64_t bottom) noexcept
+{
+  auto newBuffer = std::make_unique<Buffer>(buffer->Capacity * 2);
+  for (int64_t i = top; i < bottom; ++i)
+  {
+    newBuffer->Put(i, buffer->Get(i));
+  }
+
+  m_buffers.push_back(std::move(newBuffer));
+  m_buffer.store(m_buffers.back().get(), std::memory_order_release);
+  return m_buffers.back().get();
+}
+
+} // namespace Mso
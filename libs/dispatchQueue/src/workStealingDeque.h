@@ -0,0 +1,59 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#include "dispatchQueue/dispatchQueue.h"
+
+namespace Mso {
+
+//! Lock-free work-stealing deque of dispatch tasks.
+//!
+//! The owner thread pushes and pops tasks at the bottom in the LIFO order, and other threads steal tasks from the
+//! top in the FIFO order. The algorithm follows the Chase-Lev deque with the memory model from
+//! "Correct and Efficient Work-Stealing for Weak Memory Models" by Le, Pop, Cohen, and Nardelli.
+//!
+//! The deque stores raw IVoidFunctor pointers to allow speculative reads by thieves. The circular buffer grows
+//! when it is full, and the old buffers are kept until the deque is destroyed because thieves may still read them.
+//! Push moves inline tasks to the heap: a thief copies the slot before it wins the race for it, and the owner may
+//! copy the slots into a new buffer at the same time. Only a pointer can be copied safely in both cases.
+struct WorkStealingDeque
+{
+  WorkStealingDeque() noexcept;
+  ~WorkStealingDeque() noexcept;
+
+  // Prohibit copy and move
+  WorkStealingDeque(WorkStealingDeque const& other) = delete;
+  WorkStealingDeque& operator=(WorkStealingDeque const& other) = delete;
+
+  //! Push the task to the bottom. It must be called only by the owner thread.
+  void Push(DispatchTask&& task) noexcept;
+
+  //! Pop the task from the bottom. It must be called only by the owner thread.
+  bool TryPop(/*out*/ DispatchTask& task) noexcept;
+
+  //! Steal the task from the top. It can be called by any thread.
+  //! It returns false if the deque is empty or if another thread won the race for the top task.
+  bool TrySteal(/*out*/ DispatchTask& task) noexcept;
+
+  //! True if the deque has no tasks. The result is approximate if other threads change the deque.
+  bool IsEmpty() const noexcept;
+
+private:
+  struct Buffer;
+
+  Buffer* Grow(Buffer* buffer, int64_t top, int64_t bottom) noexcept;
+
+private:
+  constexpr static int64_t InitialCapacity{64};
+
+  std::atomic<int64_t> m_top{0};
+  std::atomic<int64_t> m_bottom{0};
+  std::atomic<Buffer*> m_buffer;
+  std::vector<std::unique_ptr<Buffer>> m_buffers; // All buffers allocated by the owner thread.
+};
+
+} // namespace Mso
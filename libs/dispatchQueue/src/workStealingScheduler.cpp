@@ -0,0 +1,392 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "dispatchQueue/dispatchQueue.h"
+#include "queueService.h"
+#include "workStealingDeque.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Mso {
+
+//! Concurrent queue scheduler where each worker thread has its own task deque.
+//! Tasks posted from a worker thread go to its deque, and the worker invokes them in the LIFO order. Tasks posted from
+//! other threads go to the shared injection queue. Idle workers take tasks from the injection queue or steal them
+//! from other workers' deques. Busy workers check the injection queue periodically to avoid its starvation.
+//! By default it starts at most one worker per available processor. The workers are not part of the WorkerPool:
+//! they never retire, and they do not compensate the blocked workers.
+struct WorkStealingScheduler : Mso::UnknownObject<IDispatchQueueScheduler, IDispatchTaskStore>
+{
+  WorkStealingScheduler(uint32_t maxThreads) noexcept;
+  ~WorkStealingScheduler() noexcept override;
+
+  void RunInThread(uint32_t workerIndex) noexcept;
+
+public: // IDispatchQueueScheduler
+  void IntializeScheduler(Mso::WeakPtr<IDispatchQueueService>&& queue) noexcept override;
+  bool HasThreadAccess() noexcept override;
+  bool IsSerial() noexcept override;
+  void Post(size_t taskCount) noexcept override;
+  void Shutdown() noexcept override;
+  void AwaitTermination() noexcept override;
+
+public: // IDispatchTaskStore
+  void Enqueue(DispatchTask&& task) noexcept override;
+  bool TryDequeue(/*out*/ DispatchTask& task) noexcept override;
+  bool DequeueAll(/*out*/ std::vector<DispatchTask>& tasks) noexcept override;
+  size_t Size() noexcept override;
+  bool IsEmpty() noexcept override;
+
+private:
+  struct Worker
+  {
+    Worker(uint32_t index) noexcept : Index{index} {}
+
+    const uint32_t Index;
+    WorkStealingDeque Deque;
+    uint32_t DequeueCount{0}; // Used only by the worker thread.
+  };
+
+  struct WorkerContext
+  {
+    WorkerContext(WorkStealingScheduler* scheduler, Worker* worker) noexcept;
+    ~WorkerContext() noexcept;
+
+    static Worker* CurrentWorker(WorkStealingScheduler* scheduler) noexcept;
+
+  private:
+    WorkStealingScheduler* m_prevScheduler{nullptr};
+    Worker* m_prevWorker{nullptr};
+    static thread_local WorkStealingScheduler* tls_scheduler;
+    static thread_local Worker* tls_worker;
+  };
+
+  bool TrySteal(Worker* thief, /*out*/ DispatchTask& task) noexcept;
+  bool AreDequesEmpty() noexcept;
+  void OnTaskRemoved() noexcept;
+
+private:
+  constexpr static uint32_t InjectionQueueInterval{61}; // The same interval as the Tokio's global queue interval.
+
+  Mso::WeakPtr<IDispatchQueueService> m_queue;
+  std::optional<TaskQueue> m_injectionQueue;
+  std::atomic<size_t> m_taskCount{0};
+  const uint32_t m_maxThreads{1};
+
+  // Workers are read without the lock. Thus, the vectors are allocated for the m_maxThreads and never resized.
+  std::vector<std::unique_ptr<Worker>> m_workers;
+  std::atomic<uint32_t> m_workerCount{0};
+  std::atomic<uint32_t> m_idleThreads{0};
+  std::condition_variable m_wakeUpThread;
+  std::mutex m_threadMutex;
+  uint32_t m_wakeUpCount{0};
+  bool m_isShutdown{false};
+  std::vector<std::thread> m_threads;
+};
+
+//=============================================================================
+// WorkStealingScheduler implementation
+//=============================================================================
+
+WorkStealingScheduler::WorkStealingScheduler(uint32_t maxThreads) noexcept
+    : m_maxThreads{maxThreads == 0 ? GetAvailableProcessorCount() : maxThreads}
+    , m_workers(m_maxThreads)
+    , m_threads(m_maxThreads)
+{
+}
+
+WorkStealingScheduler::~WorkStealingScheduler() noexcept
+{
+  AwaitTermination();
+}
+
+void WorkStealingScheduler::RunInThread(uint32_t workerIndex) noexcept
+{
+  WorkerContext context{this, m_workers[workerIndex].get()};
+  for (;;)
+  {
+    if (auto queue = m_queue.GetStrongPtr())
+    {
+      DispatchTask task;
+      while (queue->TryDequeTask(/*ref*/ task))
+      {
+        queue->InvokeTask(std::move(task), std::nullopt);
+      }
+
+      std::unique_lock lock{m_threadMutex};
+      if (m_isShutdown)
+      {
+        break;
+      }
+
+      // Post checks m_idleThreads after adding a task. Thus, either we see the new task here, or Post wakes us up.
+      ++m_idleThreads;
+      if (queue->HasTasks())
+      {
+        --m_idleThreads;
+        continue;
+      }
+
+      // Release the queue outside of the lock because it may be the last reference.
+      lock.unlock();
+      queue = nullptr;
+      lock.lock();
+
+      m_wakeUpThread.wait(lock, [this]() noexcept { return m_wakeUpCount > 0 || m_isShutdown; });
+      if (m_wakeUpCount > 0)
+      {
+        --m_wakeUpCount;
+      }
+
+      --m_idleThreads;
+    }
+    else
+    {
+      break;
+    }
+  }
+}
+
+void WorkStealingScheduler::IntializeScheduler(Mso::WeakPtr<IDispatchQueueService>&& queue) noexcept
+{
+  m_queue = std::move(queue);
+  m_injectionQueue.emplace(Mso::WeakPtr<IUnknown>{m_queue});
+}
+
+bool WorkStealingScheduler::HasThreadAccess() noexcept
+{
+  return WorkerContext::CurrentWorker(this) != nullptr;
+}
+
+bool WorkStealingScheduler::IsSerial() noexcept
+{
+  return m_maxThreads == 1;
+}
+
+void WorkStealingScheduler::Post(size_t taskCount) noexcept
+{
+  // Avoid the lock when all workers are already busy.
+  if (m_idleThreads.load() == 0 && m_workerCount.load() == m_maxThreads)
+  {
+    return;
+  }
+
+  std::unique_lock lock{m_threadMutex};
+  if (m_isShutdown)
+  {
+    return;
+  }
+
+  // Wake up idle workers first, and then start new workers for the remaining tasks.
+  uint32_t idleThreads = m_idleThreads.load();
+  size_t wakeUpCount = (idleThreads > m_wakeUpCount) ? std::min<size_t>(taskCount, idleThreads - m_wakeUpCount) : 0;
+  if (wakeUpCount > 0)
+  {
+    m_wakeUpCount += static_cast<uint32_t>(wakeUpCount);
+    for (size_t i = 0; i < wakeUpCount; ++i)
+    {
+      m_wakeUpThread.notify_one();
+    }
+  }
+
+  for (size_t i = wakeUpCount; i < taskCount; ++i)
+  {
+    uint32_t workerIndex = m_workerCount.load();
+    if (workerIndex == m_maxThreads)
+    {
+      break;
+    }
+
+    // Workers keep the scheduler alive because the scheduler may be released in a worker thread.
+    m_workers[workerIndex] = std::make_unique<Worker>(workerIndex);
+    m_workerCount.store(workerIndex + 1);
+    m_threads[workerIndex] = std::thread([self = Mso::CntPtr{this}, workerIndex]() noexcept {
+      self->RunInThread(workerIndex);
+    });
+  }
+}
+
+void WorkStealingScheduler::Shutdown() noexcept
+{
+  std::unique_lock lock{m_threadMutex};
+  m_isShutdown = true;
+  m_wakeUpThread.notify_all();
+}
+
+void WorkStealingScheduler::AwaitTermination() noexcept
+{
+  Shutdown();
+  for (auto& thread : m_threads)
+  {
+    if (thread.joinable())
+    {
+      if (thread.get_id() == std::this_thread::get_id())
+      {
+        // The last reference to the scheduler may be released by its own worker thread.
+        thread.detach();
+      }
+      else
+      {
+        thread.join();
+      }
+    }
+  }
+}
+
+void WorkStealingScheduler::Enqueue(DispatchTask&& task) noexcept
+{
+  if (m_taskCount.fetch_add(1) == 0)
+  {
+    // Keep strong reference to the queue while it has tasks. It is released by the consumer that takes the last task.
+    Mso::CntPtr<IDispatchQueueService> queue = m_queue.GetStrongPtr();
+    VerifyElseCrashSz(queue, "Cannot enqueue a task into a destroyed queue");
+    queue.Detach();
+  }
+
+  if (Worker* worker = WorkerContext::CurrentWorker(this))
+  {
+    worker->Deque.Push(std::move(task));
+  }
+  else
+  {
+    m_injectionQueue->Enqueue(std::move(task));
+  }
+}
+
+bool WorkStealingScheduler::TryDequeue(/*out*/ DispatchTask& task) noexcept
+{
+  // The worker checks the injection queue first after each InjectionQueueInterval tasks. Otherwise, tasks that
+  // repost themselves into the worker deque would starve tasks posted from other threads.
+  Worker* worker = WorkerContext::CurrentWorker(this);
+  bool isInjectionQueueFirst = worker && (++worker->DequeueCount % InjectionQueueInterval == 0);
+  if ((isInjectionQueueFirst && m_injectionQueue->TryDequeue(/*out*/ task))
+      || (worker && worker->Deque.TryPop(/*out*/ task)) || m_injectionQueue->TryDequeue(/*out*/ task)
+      || TrySteal(worker, /*out*/ task))
+  {
+    OnTaskRemoved();
+    return true;
+  }
+
+  return false;
+}
+
+bool WorkStealingScheduler::DequeueAll(/*out*/ std::vector<DispatchTask>& tasks) noexcept
+{
+  // TrySteal fails when it loses the race for the top task to the deque owner or to another thief.
+  // Thus, retry until all deques are empty or other threads take all remaining tasks.
+  bool result = false;
+  DispatchTask task;
+  while (m_taskCount.load() != 0)
+  {
+    if (m_injectionQueue->TryDequeue(/*out*/ task) || TrySteal(nullptr, /*out*/ task))
+    {
+      tasks.push_back(std::move(task));
+      OnTaskRemoved();
+      result = true;
+    }
+    else if (m_injectionQueue->IsEmpty() && AreDequesEmpty())
+    {
+      break;
+    }
+    else
+    {
+      std::this_thread::yield();
+    }
+  }
+
+  return result;
+}
+
+size_t WorkStealingScheduler::Size() noexcept
+{
+  return m_taskCount.load();
+}
+
+bool WorkStealingScheduler::IsEmpty() noexcept
+{
+  return m_taskCount.load() == 0;
+}
+
+bool WorkStealingScheduler::TrySteal(Worker* thief, /*out*/ DispatchTask& task) noexcept
+{
+  // Start from the next worker for each thief to spread the contention.
+  uint32_t workerCount = m_workerCount.load();
+  uint32_t start = thief ? thief->Index + 1 : 0;
+  for (uint32_t i = 0; i < workerCount; ++i)
+  {
+    Worker* victim = m_workers[(start + i) % workerCount].get();
+    if (victim != thief && victim->Deque.TrySteal(/*out*/ task))
+    {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+bool WorkStealingScheduler::AreDequesEmpty() noexcept
+{
+  uint32_t workerCount = m_workerCount.load();
+  for (uint32_t i = 0; i < workerCount; ++i)
+  {
+    if (!m_workers[i]->Deque.IsEmpty())
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+void WorkStealingScheduler::OnTaskRemoved() noexcept
+{
+  if (m_taskCount.fetch_sub(1) == 1)
+  {
+    // Release the queue reference acquired by Enqueue.
+    // The queue is alive here because the consumer must hold a strong reference to it.
+    Mso::CntPtr<IDispatchQueueService> queue = m_queue.GetStrongPtr();
+    queue->Release();
+  }
+}
+
+//=============================================================================
+// WorkStealingScheduler::WorkerContext implementation
+//=============================================================================
+
+/*static*/ thread_local WorkStealingScheduler* WorkStealingScheduler::WorkerContext::tls_scheduler{nullptr};
+/*static*/ thread_local WorkStealingScheduler::Worker* WorkStealingScheduler::WorkerContext::tls_worker{nullptr};
+
+WorkStealingScheduler::WorkerContext::WorkerContext(WorkStealingScheduler* scheduler, Worker* worker) noexcept
+    : m_prevScheduler{tls_scheduler}, m_prevWorker{tls_worker}
+{
+  tls_scheduler = scheduler;
+  tls_worker = worker;
+}
+
+WorkStealingScheduler::WorkerContext::~WorkerContext() noexcept
+{
+  tls_scheduler = m_prevScheduler;
+  tls_worker = m_prevWorker;
+}
+
+/*static*/ WorkStealingScheduler::Worker* WorkStealingScheduler::WorkerContext::CurrentWorker(
+    WorkStealingScheduler* scheduler) noexcept
+{
+  return tls_scheduler == scheduler ? tls_worker : nullptr;
+}
+
+//=============================================================================
+// DispatchQueueStatic::MakeWorkStealingScheduler implementation
+//=============================================================================
+
+/*static*/ Mso::CntPtr<IDispatchQueueScheduler> DispatchQueueStatic::MakeWorkStealingScheduler(
+    uint32_t maxThreads) noexcept
+{
+  return Mso::Make<WorkStealingScheduler, IDispatchQueueScheduler>(maxThreads);
+}
+
+} // namespace Mso
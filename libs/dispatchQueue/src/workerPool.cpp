@@ -0,0 +1,706 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "workerPool.h"
+#include <algorithm>
+#if defined(__linux__)
+#include <fstream>
+#endif
+
+namespace Mso {
+
+namespace {
+
+//! Hint the processor that the thread spins in a wait loop.
+void CpuPause() noexcept
+{
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+  __asm__ __volatile__("yield");
+#endif
+}
+
+#if defined(__linux__)
+//! Returns the CPU quota of the process cgroup rounded up to whole processors, or zero if there is no quota.
+uint32_t GetCgroupProcessorQuota() noexcept
+{
+  int64_t quota{-1};
+  int64_t period{0};
+
+  // The cgroup v2 cpu.max has "<quota> <period>" or "max <period>" if there is no quota.
+  if (std::ifstream cpuMax{"/sys/fs/cgroup/cpu.max"})
+  {
+    if (!(cpuMax >> quota >> period))
+    {
+      quota = -1;
+    }
+  }
+  else
+  {
+    // The cgroup v1 has the quota in a separate file, and it is -1 if there is no quota.
+    std::ifstream quotaFile{"/sys/fs/cgroup/cpu/cpu.cfs_quota_us"};
+    std::ifstream periodFile{"/sys/fs/cgroup/cpu/cpu.cfs_period_us"};
+    if (!(quotaFile >> quota) || !(periodFile >> period))
+    {
+      quota = -1;
+    }
+  }
+
+  if (quota <= 0 || period <= 0)
+  {
+    return 0;
+  }
+
+  return static_cast<uint32_t>(std::max<int64_t>((quota + period - 1) / period, 1));
+}
+#endif
+
+} // namespace
+
+//=============================================================================
+// WorkerPool implementation
+//=============================================================================
+
+/*static*/ thread_local bool WorkerPool::tls_isWorker{false};
+/*static*/ thread_local uint32_t WorkerPool::tls_blockingDepth{0};
+
+/*static*/ WorkerPool& WorkerPool::Instance() noexcept
+{
+  static WorkerPool* instance{new WorkerPool()};
+  return *instance;
+}
+
+WorkerPool::WorkerPool() noexcept
+{
+  ApplyConfig(ThreadPoolConfig{});
+}
+
+void WorkerPool::Submit(
+    WorkerPoolCallback callback,
+    Mso::CntPtr<IUnknown>&& context,
+    size_t count,
+    bool isHighPriority) noexcept
+{
+  if (count == 0)
+  {
+    return;
+  }
+
+  // High priority work items are kept in their own queue to run them before other work items.
+  TaskQueue& workItems = isHighPriority ? m_highPriorityWorkItems : m_workItems;
+  for (size_t i = 1; i < count; ++i)
+  {
+    workItems.Enqueue(MakeWorkItem(callback, Mso::CntPtr<IUnknown>{context}));
+  }
+
+  workItems.Enqueue(MakeWorkItem(callback, std::move(context)));
+  NotifyWorkSubmitted(count);
+}
+
+DispatchTask WorkerPool::MakeWorkItem(WorkerPoolCallback callback, Mso::CntPtr<IUnknown>&& context) noexcept
+{
+  return [this, callback, context = std::move(context)]() noexcept {
+    m_completedTaskCount.fetch_add(callback(context.Get()), std::memory_order_relaxed);
+  };
+}
+
+void WorkerPool::NotifyWorkSubmitted(size_t count) noexcept
+{
+  // The enqueued work items and the idle thread count are sequentially consistent. Thus, either we see the worker
+  // that is going to park, or the worker sees the new work items before it parks. See ParkWorker.
+  size_t pendingWorkCount = GetPendingWorkCount();
+  size_t idleThreadCount = m_idleThreadCount.load();
+  size_t awakeThreadCount = GetAwakeIdleThreadCount();
+
+  // Spinning and already woken up workers pick up the work items without being woken up. Take the lock only to wake
+  // up parked workers for the remaining work items, to start threads, or to wake up the monitor when the pool starts
+  // to have pending work while all workers are busy.
+  bool shouldWakeUpWorker = idleThreadCount > 0 && pendingWorkCount > awakeThreadCount;
+  bool hasPendingWork = pendingWorkCount > idleThreadCount + awakeThreadCount;
+  bool shouldStartThread = hasPendingWork
+      && m_threadCount.load(std::memory_order_relaxed) < GetActiveTargetThreadCount();
+  bool shouldWakeUpMonitor = idleThreadCount + awakeThreadCount == 0 && pendingWorkCount == count
+      && m_isMonitorWaiting.load(std::memory_order_relaxed);
+  if (hasPendingWork && !m_hasPendingWork.load(std::memory_order_relaxed))
+  {
+    m_hasPendingWork.store(true, std::memory_order_relaxed);
+  }
+
+  if (!shouldWakeUpWorker && !shouldStartThread && !shouldWakeUpMonitor)
+  {
+    return;
+  }
+
+  std::unique_lock lock{m_mutex};
+  pendingWorkCount = GetPendingWorkCount();
+  idleThreadCount = m_idleThreadCount.load();
+  awakeThreadCount = GetAwakeIdleThreadCount();
+
+  // Move the woken up workers from the idle count to the wake-up requests. Then, the next Submit calls do not take
+  // the lock to wake them up again before they run.
+  size_t wakeUpCount = (pendingWorkCount > awakeThreadCount)
+      ? std::min({count, pendingWorkCount - awakeThreadCount, idleThreadCount})
+      : 0;
+  if (wakeUpCount > 0)
+  {
+    m_idleThreadCount -= wakeUpCount;
+    m_wakeUpRequestCount += wakeUpCount;
+    if (wakeUpCount == idleThreadCount)
+    {
+      m_wakeUpWorker.notify_all();
+    }
+    else
+    {
+      for (size_t i = 0; i < wakeUpCount; ++i)
+      {
+        m_wakeUpWorker.notify_one();
+      }
+    }
+  }
+
+  size_t availableThreadCount = GetAvailableThreadCount();
+  if (pendingWorkCount > availableThreadCount)
+  {
+    size_t targetThreadCount = GetActiveTargetThreadCount();
+    if (m_threadCount < targetThreadCount)
+    {
+      size_t newThreadCount = std::min(pendingWorkCount - availableThreadCount, targetThreadCount - m_threadCount);
+      for (size_t i = 0; i < newThreadCount; ++i)
+      {
+        StartThread(lock);
+      }
+    }
+    else if (shouldWakeUpMonitor)
+    {
+      m_wakeUpMonitor.notify_one();
+    }
+  }
+}
+
+void WorkerPool::RunWorker() noexcept
+{
+  tls_isWorker = true;
+  for (;;)
+  {
+    DispatchTask workItem;
+    if (!TryPopWorkItem(/*out*/ workItem))
+    {
+      if (!WaitForWork())
+      {
+        return;
+      }
+
+      continue;
+    }
+
+    m_startedWorkCount.fetch_add(1, std::memory_order_relaxed);
+    workItem.Get()->Invoke();
+    workItem = nullptr; // Release the context before taking the lock.
+
+    if (ShouldRetireAfterWork())
+    {
+      return;
+    }
+  }
+}
+
+bool WorkerPool::TryPopWorkItem(/*out*/ DispatchTask& workItem) noexcept
+{
+  bool hasWorkItems = !m_workItems.IsEmpty();
+  if (hasWorkItems && m_highPriorityStreak.load(std::memory_order_relaxed) >= HighPriorityStarvationLimit)
+  {
+    // Let the oldest normal work item run after too many high priority work items passed it.
+    if (m_workItems.TryDequeue(/*out*/ workItem))
+    {
+      m_highPriorityStreak.store(0, std::memory_order_relaxed);
+      return true;
+    }
+  }
+
+  if (m_highPriorityWorkItems.TryDequeue(/*out*/ workItem))
+  {
+    if (hasWorkItems)
+    {
+      m_highPriorityStreak.fetch_add(1, std::memory_order_relaxed);
+    }
+    else
+    {
+      m_highPriorityStreak.store(0, std::memory_order_relaxed);
+    }
+
+    return true;
+  }
+
+  return m_workItems.TryDequeue(/*out*/ workItem);
+}
+
+size_t WorkerPool::GetPendingWorkCount() const noexcept
+{
+  return m_highPriorityWorkItems.Size() + m_workItems.Size();
+}
+
+size_t WorkerPool::GetAwakeIdleThreadCount() const noexcept
+{
+  return m_spinningThreadCount.load() + m_wakeUpRequestCount.load();
+}
+
+size_t WorkerPool::GetAvailableThreadCount() const noexcept
+{
+  return m_idleThreadCount.load() + GetAwakeIdleThreadCount();
+}
+
+bool WorkerPool::WaitForWork() noexcept
+{
+  if (TryStartSpinning())
+  {
+    bool hasPendingWork = SpinWaitForWork();
+    --m_spinningThreadCount;
+    if (hasPendingWork)
+    {
+      // Take the work item without the lock. The worker spins again if another worker took it first.
+      return true;
+    }
+  }
+
+  std::unique_lock lock{m_mutex};
+  return ParkWorker(lock);
+}
+
+bool WorkerPool::TryStartSpinning() noexcept
+{
+  if (m_spinCount.load(std::memory_order_relaxed) == 0 && m_yieldCount.load(std::memory_order_relaxed) == 0)
+  {
+    return false;
+  }
+
+  size_t spinningThreadCount = m_spinningThreadCount.load();
+  do
+  {
+    if (spinningThreadCount >= m_maxSpinningThreadCount.load(std::memory_order_relaxed))
+    {
+      return false;
+    }
+  } while (!m_spinningThreadCount.compare_exchange_weak(spinningThreadCount, spinningThreadCount + 1));
+
+  return true;
+}
+
+bool WorkerPool::ShouldRetireAfterWork() noexcept
+{
+  auto hasExtraThreads = [this]() noexcept {
+    return m_retireRequestCount.load() > 0
+        || (m_controller.IsEnabled.load(std::memory_order_relaxed) && m_threadCount > GetActiveTargetThreadCount());
+  };
+
+  // Check the condition without the lock first because it is rarely true.
+  if (!hasExtraThreads())
+  {
+    return false;
+  }
+
+  std::lock_guard lock{m_mutex};
+  if (m_retireRequestCount > 0)
+  {
+    // A blocked worker returned to work. Let this worker exit to keep the number of running workers.
+    --m_retireRequestCount;
+    --m_threadCount;
+    return true;
+  }
+
+  if (m_controller.IsEnabled && m_threadCount > GetActiveTargetThreadCount())
+  {
+    // The controller lowered the target thread count.
+    --m_threadCount;
+    return true;
+  }
+
+  return false;
+}
+
+void WorkerPool::RunMonitor() noexcept
+{
+  std::unique_lock lock{m_mutex};
+  for (;;)
+  {
+    RunController(lock);
+
+    // Submit wakes up the monitor in most cases, but the pool may also start starving when an idle worker takes
+    // a work item. Thus, we check the pool state periodically.
+    auto isStarving = [this]() noexcept {
+      return GetPendingWorkCount() > 0 && GetAvailableThreadCount() == 0;
+    };
+    std::chrono::steady_clock::duration waitTime = m_controller.IsEnabled
+        ? std::min<std::chrono::steady_clock::duration>(StarvationTimeout, m_controller.Interval)
+        : StarvationTimeout;
+    m_isMonitorWaiting.store(true, std::memory_order_relaxed);
+    bool isStarved = m_wakeUpMonitor.wait_for(lock, waitTime, isStarving);
+    m_isMonitorWaiting.store(false, std::memory_order_relaxed);
+    if (!isStarved)
+    {
+      continue;
+    }
+
+    // Add a new thread only if workers did not start any work during the StarvationTimeout.
+    // It protects the pool from deadlocks when all workers are blocked by tasks that wait for the pending work.
+    uint64_t startedWorkCount = m_startedWorkCount.load(std::memory_order_relaxed);
+    bool hasProgress = m_wakeUpMonitor.wait_for(lock, StarvationTimeout, [&]() noexcept {
+      return m_startedWorkCount.load(std::memory_order_relaxed) != startedWorkCount || !isStarving();
+    });
+
+    if (!hasProgress && m_threadCount < m_maxThreadCount.load(std::memory_order_relaxed))
+    {
+      StartThread(lock);
+
+      // Do not let the controller retire the thread that replaces a blocked worker.
+      if (m_controller.IsEnabled)
+      {
+        m_targetThreadCount = std::max(m_targetThreadCount.load(), m_threadCount - m_blockedThreadCount);
+      }
+    }
+  }
+}
+
+void WorkerPool::RunController(std::unique_lock<std::mutex>& lock) noexcept
+{
+  auto now = std::chrono::steady_clock::now();
+  auto elapsed = now - m_controller.IntervalStartTime;
+  if (!m_controller.IsEnabled || elapsed < m_controller.Interval)
+  {
+    return;
+  }
+
+  uint64_t totalCompletedTaskCount = m_completedTaskCount.load(std::memory_order_relaxed);
+  uint64_t completedTaskCount = totalCompletedTaskCount - m_controller.IntervalStartTaskCount;
+  uint64_t throughput =
+      static_cast<uint64_t>(completedTaskCount / std::chrono::duration<double>(elapsed).count());
+
+  // The throughput depends on the thread count only when the work items wait for workers.
+  int32_t adjustment{0};
+  if (m_hasPendingWork.load(std::memory_order_relaxed) || GetPendingWorkCount() > 0)
+  {
+    if (throughput < m_controller.Throughput)
+    {
+      m_controller.Direction = -m_controller.Direction;
+    }
+
+    size_t targetThreadCount = std::clamp<size_t>(
+        m_targetThreadCount + m_controller.Direction,
+        m_minTargetThreadCount,
+        m_maxThreadCount.load(std::memory_order_relaxed));
+    adjustment = static_cast<int32_t>(targetThreadCount) - static_cast<int32_t>(m_targetThreadCount);
+    if (adjustment != 0)
+    {
+      m_targetThreadCount = targetThreadCount;
+      ++m_controller.AdjustmentCount;
+    }
+    else
+    {
+      // Turn back at the thread count limits.
+      m_controller.Direction = -m_controller.Direction;
+    }
+  }
+
+  m_controller.Throughput = throughput;
+  m_controller.LastAdjustment = adjustment;
+  m_controller.IntervalStartTime = now;
+  m_controller.IntervalStartTaskCount = totalCompletedTaskCount;
+  m_hasPendingWork.store(false, std::memory_order_relaxed);
+
+  // Start workers for the pending work items up to the new target.
+  size_t availableThreadCount = GetAvailableThreadCount();
+  while (m_threadCount < m_targetThreadCount && GetPendingWorkCount() > availableThreadCount)
+  {
+    StartThread(lock);
+    ++availableThreadCount;
+  }
+}
+
+bool WorkerPool::ParkWorker(std::unique_lock<std::mutex>& lock) noexcept
+{
+  // Do not count the worker as idle when the work is already there. Otherwise, Submit sees the idle worker and
+  // takes the lock to wake it up.
+  if (GetPendingWorkCount() > 0)
+  {
+    return true;
+  }
+
+  // The idle thread count is incremented before the wait predicate checks the work item queues. It pairs with
+  // NotifyWorkSubmitted that checks the idle thread count after the work items are enqueued.
+  // The parked workers are counted either as idle or as woken up by the wake-up requests. A worker that stops
+  // waiting takes a wake-up request if there is one, and otherwise it leaves the idle count.
+  m_idleCounters.ParkCount.fetch_add(1, std::memory_order_relaxed);
+  ++m_idleThreadCount;
+  auto stopWaiting = [this]() noexcept {
+    if (m_wakeUpRequestCount > 0)
+    {
+      --m_wakeUpRequestCount;
+    }
+    else
+    {
+      --m_idleThreadCount;
+    }
+  };
+
+  for (;;)
+  {
+    bool isWokenUp = m_wakeUpWorker.wait_for(lock, m_idleTimeout, [this]() noexcept {
+      return m_wakeUpRequestCount > 0 || GetPendingWorkCount() > 0 || m_retireRequestCount > 0
+          || m_threadCount > m_maxThreadCount.load(std::memory_order_relaxed);
+    });
+
+    if (m_wakeUpRequestCount > 0 || GetPendingWorkCount() > 0)
+    {
+      stopWaiting();
+      return true;
+    }
+
+    // Exit if a blocked worker returned to work, if the max thread count was lowered, or if the worker stayed idle
+    // for the whole idle timeout.
+    if (m_retireRequestCount > 0 || m_threadCount > m_maxThreadCount.load(std::memory_order_relaxed)
+        || (!isWokenUp && m_threadCount > m_minThreadCount))
+    {
+      if (m_retireRequestCount > 0)
+      {
+        --m_retireRequestCount;
+      }
+
+      m_idleCounters.RetireCount.fetch_add(1, std::memory_order_relaxed);
+      stopWaiting();
+      --m_threadCount;
+      return false;
+    }
+  }
+}
+
+bool WorkerPool::SpinWaitForWork() noexcept
+{
+  if (uint32_t spinCount = m_spinCount.load(std::memory_order_relaxed))
+  {
+    m_idleCounters.SpinCount.fetch_add(1, std::memory_order_relaxed);
+    for (uint32_t i = 0; i < spinCount; ++i)
+    {
+      if (GetPendingWorkCount() > 0)
+      {
+        m_idleCounters.SpinWakeUpCount.fetch_add(1, std::memory_order_relaxed);
+        return true;
+      }
+
+      CpuPause();
+    }
+  }
+
+  if (uint32_t yieldCount = m_yieldCount.load(std::memory_order_relaxed))
+  {
+    m_idleCounters.YieldCount.fetch_add(1, std::memory_order_relaxed);
+    for (uint32_t i = 0; i < yieldCount; ++i)
+    {
+      if (GetPendingWorkCount() > 0)
+      {
+        m_idleCounters.YieldWakeUpCount.fetch_add(1, std::memory_order_relaxed);
+        return true;
+      }
+
+      std::this_thread::yield();
+    }
+  }
+
+  return false;
+}
+
+void WorkerPool::SetIdlePolicy(ThreadPoolIdlePolicy const& policy) noexcept
+{
+  m_spinCount.store(policy.SpinCount, std::memory_order_relaxed);
+  m_yieldCount.store(policy.YieldCount, std::memory_order_relaxed);
+}
+
+ThreadPoolIdleStats WorkerPool::GetIdleStats() const noexcept
+{
+  ThreadPoolIdleStats stats;
+  stats.SpinCount = m_idleCounters.SpinCount.load(std::memory_order_relaxed);
+  stats.SpinWakeUpCount = m_idleCounters.SpinWakeUpCount.load(std::memory_order_relaxed);
+  stats.YieldCount = m_idleCounters.YieldCount.load(std::memory_order_relaxed);
+  stats.YieldWakeUpCount = m_idleCounters.YieldWakeUpCount.load(std::memory_order_relaxed);
+  stats.ParkCount = m_idleCounters.ParkCount.load(std::memory_order_relaxed);
+  stats.RetireCount = m_idleCounters.RetireCount.load(std::memory_order_relaxed);
+  return stats;
+}
+
+void WorkerPool::SetConfig(ThreadPoolConfig const& config) noexcept
+{
+  // Validate the config before taking the lock.
+  VerifyElseCrashSz(
+      config.MinThreadCount <= GetMaxThreadCount(config), "MinThreadCount must not exceed MaxThreadCount");
+  VerifyElseCrashSz(config.IdleTimeout.count() > 0, "The idle timeout must be positive");
+  VerifyElseCrashSz(
+      !config.UseThreadCountController || config.ControllerInterval.count() > 0,
+      "The controller interval must be positive");
+
+  std::unique_lock lock{m_mutex};
+  ApplyConfig(config);
+  while (m_threadCount < m_minThreadCount)
+  {
+    StartThread(lock);
+  }
+
+  // Let the parked workers above the new max thread count exit.
+  m_wakeUpWorker.notify_all();
+}
+
+uint32_t WorkerPool::GetMaxThreadCount() const noexcept
+{
+  return m_maxThreadCount.load(std::memory_order_relaxed);
+}
+
+ThreadPoolControllerState WorkerPool::GetControllerState() noexcept
+{
+  std::lock_guard lock{m_mutex};
+  ThreadPoolControllerState state;
+  state.IsEnabled = m_controller.IsEnabled;
+  state.ThreadCount = static_cast<uint32_t>(m_threadCount.load());
+  state.TargetThreadCount = static_cast<uint32_t>(m_targetThreadCount.load());
+  state.Throughput = m_controller.Throughput;
+  state.LastAdjustment = m_controller.LastAdjustment;
+  state.AdjustmentCount = m_controller.AdjustmentCount;
+  state.BlockedThreadCount = static_cast<uint32_t>(m_blockedThreadCount.load());
+  return state;
+}
+
+void WorkerPool::BeginBlocking() noexcept
+{
+  if (tls_blockingDepth++ > 0 || !tls_isWorker)
+  {
+    return;
+  }
+
+  std::unique_lock lock{m_mutex};
+  ++m_blockedThreadCount;
+  if (m_retireRequestCount > 0)
+  {
+    // The worker that was going to exit replaces this worker instead.
+    --m_retireRequestCount;
+    return;
+  }
+
+  // Start a worker for the pending work that no available worker is going to pick up.
+  // Otherwise, the next Submit starts it because the blocked workers do not count toward the target.
+  if (GetPendingWorkCount() > GetAvailableThreadCount() && m_threadCount < GetActiveTargetThreadCount())
+  {
+    StartThread(lock);
+  }
+}
+
+void WorkerPool::EndBlocking() noexcept
+{
+  VerifyElseCrashSz(tls_blockingDepth > 0, "EndDispatchBlocking must be balanced with BeginDispatchBlocking");
+  if (--tls_blockingDepth > 0 || !tls_isWorker)
+  {
+    return;
+  }
+
+  std::unique_lock lock{m_mutex};
+  --m_blockedThreadCount;
+  if (m_threadCount > m_retireRequestCount + GetActiveTargetThreadCount())
+  {
+    // Ask the next worker that runs out of work or completes a work item to exit.
+    ++m_retireRequestCount;
+    if (m_idleThreadCount > 0)
+    {
+      m_wakeUpWorker.notify_one();
+    }
+  }
+}
+
+size_t WorkerPool::GetActiveTargetThreadCount() const noexcept
+{
+  return std::min<size_t>(
+      m_targetThreadCount + m_blockedThreadCount, m_maxThreadCount.load(std::memory_order_relaxed));
+}
+
+/*static*/ size_t WorkerPool::GetMaxThreadCount(ThreadPoolConfig const& config) noexcept
+{
+  return config.MaxThreadCount != 0 ? config.MaxThreadCount
+                                    : std::max<size_t>(DefaultMaxThreadCount, GetAvailableProcessorCount());
+}
+
+void WorkerPool::ApplyConfig(ThreadPoolConfig const& config) noexcept
+{
+  size_t processorCount = GetAvailableProcessorCount();
+  size_t maxThreadCount = GetMaxThreadCount(config);
+  m_minThreadCount = config.MinThreadCount;
+  m_minTargetThreadCount = std::min(std::max(MinTargetThreadCount, m_minThreadCount), maxThreadCount);
+  m_targetThreadCount = std::clamp(processorCount, m_minTargetThreadCount, maxThreadCount);
+  m_maxSpinningThreadCount.store(std::max<size_t>(processorCount / 2, 1), std::memory_order_relaxed);
+  m_maxThreadCount.store(static_cast<uint32_t>(maxThreadCount), std::memory_order_relaxed);
+  m_idleTimeout = config.IdleTimeout;
+
+  m_controller.IsEnabled = config.UseThreadCountController;
+  m_controller.Interval = config.ControllerInterval;
+  m_controller.IntervalStartTime = std::chrono::steady_clock::now();
+  m_controller.IntervalStartTaskCount = m_completedTaskCount.load(std::memory_order_relaxed);
+  m_controller.Direction = 1;
+  m_hasPendingWork.store(false, std::memory_order_relaxed);
+}
+
+void WorkerPool::StartThread(std::unique_lock<std::mutex>& /*lock*/) noexcept
+{
+  std::thread(&WorkerPool::RunWorker, this).detach();
+  ++m_threadCount;
+
+  if (!m_monitorThread.joinable())
+  {
+    m_monitorThread = std::thread(&WorkerPool::RunMonitor, this);
+  }
+}
+
+//=============================================================================
+// Thread pool configuration functions
+//=============================================================================
+
+uint32_t GetAvailableProcessorCount() noexcept
+{
+  static const uint32_t processorCount = []() noexcept {
+    uint32_t count = std::max(std::thread::hardware_concurrency(), 1u);
+#if defined(__linux__)
+    if (uint32_t quota = GetCgroupProcessorQuota())
+    {
+      count = std::min(count, quota);
+    }
+#endif
+    return count;
+  }();
+
+  return processorCount;
+}
+
+void SetThreadPoolIdlePolicy(ThreadPoolIdlePolicy const& policy) noexcept
+{
+  WorkerPool::Instance().SetIdlePolicy(policy);
+}
+
+ThreadPoolIdleStats GetThreadPoolIdleStats() noexcept
+{
+  return WorkerPool::Instance().GetIdleStats();
+}
+
+void SetThreadPoolConfig(ThreadPoolConfig const& config) noexcept
+{
+  WorkerPool::Instance().SetConfig(config);
+}
+
+ThreadPoolControllerState GetThreadPoolControllerState() noexcept
+{
+  return WorkerPool::Instance().GetControllerState();
+}
+
+void BeginDispatchBlocking() noexcept
+{
+  WorkerPool::Instance().BeginBlocking();
+}
+
+void EndDispatchBlocking() noexcept
+{
+  WorkerPool::Instance().EndBlocking();
+}
+
+} // namespace Mso
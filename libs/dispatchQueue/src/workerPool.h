@@ -0,0 +1,181 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include "dispatchQueue/dispatchQueue.h"
+#include "object/unknownObject.h"
+#include "taskQueue.h"
+
+namespace Mso {
+
+//! Callback that is invoked by a WorkerPool thread for the submitted work.
+//! It returns the number of completed tasks that the thread count controller uses to measure the throughput.
+using WorkerPoolCallback = size_t (*)(IUnknown* context) noexcept;
+
+//! Process-wide pool of worker threads shared by all thread pool schedulers.
+//!
+//! Schedulers do not own threads. Instead, they submit a callback when their queue has tasks to run, and the
+//! callback runs the queue tasks on a worker thread. The number of worker threads stays close to the number of
+//! available processors regardless of the number of queues. If all workers are blocked and no submitted work makes
+//! progress for the StarvationTimeout, then the pool adds one more thread up to the max thread count. The thread
+//! count limits are set by the ThreadPoolConfig.
+//!
+//! The work items are kept in two lock-free TaskQueues: one for the high priority work items and one for others.
+//! Submit and workers that take work items do not take the lock. Submit takes the lock only when it must wake up
+//! a parked worker, start a thread, or wake up the monitor. The thread counts are atomic to check these conditions
+//! without the lock, but they are changed under the lock.
+//!
+//! A worker that runs out of work follows the ThreadPoolIdlePolicy: it spins and yields without the lock while
+//! watching the work item queues, and only then parks on the condition variable. At most half of the available
+//! processors have spinning workers, and other idle workers park right away. Submit does not wake up parked workers
+//! for the work items that the spinning workers are going to pick up. A parked worker exits after the idle timeout
+//! unless it is one of the min thread count workers. Worker threads are detached because they may exit at any time.
+//!
+//! The optional thread count controller runs in the monitor thread. It changes the target thread count by one after
+//! each interval with pending work in the direction that increases the number of completed tasks. Workers above the
+//! target exit after they complete their work item.
+//!
+//! A worker in a DispatchBlockingScope does not count toward the target thread count. The pool starts or wakes up
+//! another worker for the pending work while the worker is blocked, and asks one worker to exit after it unblocks.
+struct WorkerPool
+{
+  //! The pool is created on demand and is never destroyed because dispatch queues may be used in static destructors.
+  static WorkerPool& Instance() noexcept;
+
+  //! Submit the callback to be invoked count times in worker threads.
+  //! The context is kept alive until all callbacks are invoked.
+  //! High priority work items run before other work items unless those were passed HighPriorityStarvationLimit times.
+  void Submit(
+      WorkerPoolCallback callback,
+      Mso::CntPtr<IUnknown>&& context,
+      size_t count,
+      bool isHighPriority = false) noexcept;
+
+  void SetIdlePolicy(ThreadPoolIdlePolicy const& policy) noexcept;
+  ThreadPoolIdleStats GetIdleStats() const noexcept;
+
+  void SetConfig(ThreadPoolConfig const& config) noexcept;
+
+  //! Max number of workers that can run the submitted work concurrently. It can be read without the lock.
+  uint32_t GetMaxThreadCount() const noexcept;
+
+  ThreadPoolControllerState GetControllerState() noexcept;
+
+  //! Begin and end a blocking region. They do nothing if the current thread is not a worker.
+  void BeginBlocking() noexcept;
+  void EndBlocking() noexcept;
+
+private:
+  WorkerPool() noexcept;
+
+  void RunWorker() noexcept;
+  void RunMonitor() noexcept;
+  void StartThread(std::unique_lock<std::mutex>& lock) noexcept;
+
+  //! Wrap up the callback into a work item task that adds its completed tasks to m_completedTaskCount.
+  DispatchTask MakeWorkItem(WorkerPoolCallback callback, Mso::CntPtr<IUnknown>&& context) noexcept;
+
+  //! Wake up parked workers, start threads, or wake up the monitor for the submitted work items if it is needed.
+  void NotifyWorkSubmitted(size_t count) noexcept;
+
+  //! Take the next work item to run. Returns false if there are no work items.
+  bool TryPopWorkItem(/*out*/ DispatchTask& workItem) noexcept;
+
+  //! Number of work items in both queues.
+  size_t GetPendingWorkCount() const noexcept;
+
+  //! Idle workers that are going to pick up work items without being woken up: the spinning and woken up workers.
+  size_t GetAwakeIdleThreadCount() const noexcept;
+
+  //! Idle workers including the parked ones.
+  size_t GetAvailableThreadCount() const noexcept;
+
+  //! Spin and then park until there is pending work. Returns false if the worker must exit.
+  bool WaitForWork() noexcept;
+
+  //! True if the worker must exit after it completed a work item because there are more workers than needed.
+  bool ShouldRetireAfterWork() noexcept;
+
+  //! Count the worker as spinning unless there are enough spinning workers or the idle policy does not spin.
+  bool TryStartSpinning() noexcept;
+
+  //! Spin and then yield while there is no pending work. Returns true if the pending work appeared.
+  bool SpinWaitForWork() noexcept;
+
+  //! Park the worker until there is pending work. Returns false if the worker must exit.
+  bool ParkWorker(std::unique_lock<std::mutex>& lock) noexcept;
+
+  static size_t GetMaxThreadCount(ThreadPoolConfig const& config) noexcept;
+  void ApplyConfig(ThreadPoolConfig const& config) noexcept;
+
+  //! Target thread count plus the blocked workers that do not count toward it.
+  size_t GetActiveTargetThreadCount() const noexcept;
+
+  //! Change the target thread count if the controller interval has passed.
+  void RunController(std::unique_lock<std::mutex>& lock) noexcept;
+
+private:
+  constexpr static size_t MinTargetThreadCount{2};
+  constexpr static size_t DefaultMaxThreadCount{256};
+  constexpr static std::chrono::milliseconds StarvationTimeout{100};
+  constexpr static size_t HighPriorityStarvationLimit{16};
+
+  std::mutex m_mutex;
+  std::condition_variable m_wakeUpWorker;
+  std::condition_variable m_wakeUpMonitor;
+  TaskQueue m_highPriorityWorkItems;
+  TaskQueue m_workItems;
+  std::atomic<size_t> m_highPriorityStreak{0}; // High priority work items that started while other work items waited.
+  std::thread m_monitorThread;
+  std::atomic<size_t> m_threadCount{0}; // Started workers that did not exit yet.
+  size_t m_minThreadCount{0};
+  std::atomic<size_t> m_targetThreadCount{0}; // Workers started on demand without waiting for the StarvationTimeout.
+  size_t m_minTargetThreadCount{0};
+  std::atomic<uint32_t> m_maxThreadCount{0};
+  std::chrono::steady_clock::duration m_idleTimeout{};
+  std::atomic<size_t> m_blockedThreadCount{0}; // Workers in a blocking region.
+  std::atomic<size_t> m_retireRequestCount{0}; // Workers that must exit because the blocking regions ended.
+  std::atomic<size_t> m_idleThreadCount{0}; // Parked workers that are not woken up yet.
+  std::atomic<size_t> m_wakeUpRequestCount{0}; // Parked workers that are woken up, but did not stop waiting yet.
+  std::atomic<size_t> m_spinningThreadCount{0}; // Workers that spin or yield outside of the lock.
+  std::atomic<size_t> m_maxSpinningThreadCount{1}; // Half of the available processors, but at least one.
+  std::atomic<uint64_t> m_startedWorkCount{0}; // Used by the monitor to detect that workers do not make any progress.
+  std::atomic<uint64_t> m_completedTaskCount{0}; // Used by the controller to measure the throughput.
+  std::atomic<bool> m_hasPendingWork{false}; // Work items waited for workers during the controller interval.
+  std::atomic<bool> m_isMonitorWaiting{false}; // The monitor waits for the pool to start starving.
+
+  std::atomic<uint32_t> m_spinCount{ThreadPoolIdlePolicy{}.SpinCount};
+  std::atomic<uint32_t> m_yieldCount{ThreadPoolIdlePolicy{}.YieldCount};
+
+  struct IdleCounters
+  {
+    std::atomic<uint64_t> SpinCount{0};
+    std::atomic<uint64_t> SpinWakeUpCount{0};
+    std::atomic<uint64_t> YieldCount{0};
+    std::atomic<uint64_t> YieldWakeUpCount{0};
+    std::atomic<uint64_t> ParkCount{0};
+    std::atomic<uint64_t> RetireCount{0};
+  } m_idleCounters;
+
+  struct Controller
+  {
+    std::atomic<bool> IsEnabled{false};
+    std::chrono::steady_clock::duration Interval{};
+    std::chrono::steady_clock::time_point IntervalStartTime{};
+    uint64_t IntervalStartTaskCount{0};
+    uint64_t Throughput{0};
+    int32_t Direction{1};
+    int32_t LastAdjustment{0};
+    uint64_t AdjustmentCount{0};
+  } m_controller;
+
+  static thread_local bool tls_isWorker;
+  static thread_local uint32_t tls_blockingDepth;
+};
+
+} // namespace Mso
@@ -18,9 +18,11 @@
 
   For throwing function objects you can use Mso::FunctorThrow.
 
-  If you want to avoid the heap allocation overhead then you have two other choices:
+  If you want to avoid the heap allocation overhead then you have other choices:
   - If the functor is not long lived and won't outlive the function object, use Mso::FunctorRef.
   - If you need to keep the functor for longer, use Mso::SmallFunctor.
+  - If the functor is a task posted to a dispatch queue, use the move-only Mso::DispatchTask. It stores small
+  function objects inline.
 */
 
 #include <object/unknownObject.h>
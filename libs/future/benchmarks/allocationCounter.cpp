@@ -0,0 +1,152 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+// Counts the heap allocations by replacing the allocation functions in the benchmark executable.
+// With glibc it replaces the malloc family functions and forwards them to the glibc implementation. Thus, it counts
+// the allocations of Mso::Memory, the standard library, and operator new. Other platforms and sanitizer builds that
+// intercept malloc themselves count only the operator new calls.
+
+#include "allocationCounter.h"
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <new>
+
+#if defined(__SANITIZE_ADDRESS__) || defined(__SANITIZE_THREAD__)
+#define FUTURE_BENCHMARK_SANITIZED 1
+#elif defined(__has_feature)
+#if __has_feature(address_sanitizer) || __has_feature(thread_sanitizer)
+#define FUTURE_BENCHMARK_SANITIZED 1
+#endif
+#endif
+
+#if defined(__GLIBC__) && !defined(FUTURE_BENCHMARK_SANITIZED)
+#define FUTURE_BENCHMARK_COUNT_MALLOC 1
+#endif
+
+namespace FutureBenchmarks {
+
+// The counter is shared by all threads to count the allocations made by the thread pool on behalf of the measured
+// operations. Its contention adds the same cost to all benchmarks.
+static std::atomic<uint64_t> s_allocationCount{0};
+
+static void CountAllocation() noexcept
+{
+  s_allocationCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+bool IsCountingMallocCalls() noexcept
+{
+#if defined(FUTURE_BENCHMARK_COUNT_MALLOC)
+  return true;
+#else
+  return false;
+#endif
+}
+
+uint64_t GetAllocationCount() noexcept
+{
+  return s_allocationCount.load(std::memory_order_relaxed);
+}
+
+} // namespace FutureBenchmarks
+
+#if defined(FUTURE_BENCHMARK_COUNT_MALLOC)
+
+extern "C" {
+
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+void* __libc_memalign(size_t alignment, size_t size);
+
+void* malloc(size_t size) noexcept
+{
+  FutureBenchmarks::CountAllocation();
+  return __libc_malloc(size);
+}
+
+void* calloc(size_t count, size_t size) noexcept
+{
+  FutureBenchmarks::CountAllocation();
+  return __libc_calloc(count, size);
+}
+
+void* realloc(void* ptr, size_t size) noexcept
+{
+  FutureBenchmarks::CountAllocation();
+  return __libc_realloc(ptr, size);
+}
+
+void* memalign(size_t alignment, size_t size) noexcept
+{
+  FutureBenchmarks::CountAllocation();
+  return __libc_memalign(alignment, size);
+}
+
+void* aligned_alloc(size_t alignment, size_t size) noexcept
+{
+  FutureBenchmarks::CountAllocation();
+  return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void** ptr, size_t alignment, size_t size) noexcept
+{
+  // Unlike memalign, posix_memalign rejects the alignments that are not a power of two multiple of sizeof(void*).
+  if (alignment < sizeof(void*) || (alignment & (alignment - 1)) != 0)
+  {
+    return EINVAL;
+  }
+
+  FutureBenchmarks::CountAllocation();
+  void* result = __libc_memalign(alignment, size);
+  if (!result)
+  {
+    return ENOMEM;
+  }
+
+  *ptr = result;
+  return 0;
+}
+
+} // extern "C"
+
+#else
+
+void* operator new(size_t size)
+{
+  FutureBenchmarks::CountAllocation();
+  if (void* ptr = std::malloc(size != 0 ? size : 1))
+  {
+    return ptr;
+  }
+
+  throw std::bad_alloc{};
+}
+
+void* operator new[](size_t size)
+{
+  return ::operator new(size);
+}
+
+void operator delete(void* ptr) noexcept
+{
+  std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+  std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t /*size*/) noexcept
+{
+  std::free(ptr);
+}
+
+void operator delete[](void* ptr, size_t /*size*/) noexcept
+{
+  std::free(ptr);
+}
+
+#endif
@@ -0,0 +1,17 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include <cstdint>
+
+namespace FutureBenchmarks {
+
+//! True if GetAllocationCount counts the malloc family calls. Otherwise, it counts only the operator new calls and
+//! misses the blocks allocated by Mso::Memory, including the future blocks.
+bool IsCountingMallocCalls() noexcept;
+
+//! Returns the number of heap allocations made by all threads since the process start.
+uint64_t GetAllocationCount() noexcept;
+
+} // namespace FutureBenchmarks
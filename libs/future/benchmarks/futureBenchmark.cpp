@@ -0,0 +1,264 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+// Measures the future library: PostFuture with Then chains of different depth, WhenAll and WhenAny with 10 to 100k
+// inputs, SharedFuture fan-out to many continuations, Promise set/observe latency between threads,
+// CancellationTokenSource cancel storms, and the FutureWait round trip.
+// Each result reports the time and the heap allocations per operation, because the allocations are the main cost of
+// creating futures.
+//
+// Usage: future_benchmarks [--format=text|json|csv] [--output=<path>] [--filter=<substring>] [--runs=<count>] [--quick]
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+#include "allocationCounter.h"
+#include "benchmarkReporter/benchmarkReporter.h"
+#include "future/cancellationToken.h"
+#include "future/future.h"
+#include "future/futureWait.h"
+
+namespace FutureBenchmarks {
+
+namespace {
+
+constexpr uint32_t ChainDepths[]{1, 10, 100};
+constexpr uint32_t ChainFutureCount{100000};
+constexpr uint32_t WhenInputCounts[]{10, 1000, 100000};
+constexpr uint32_t WhenTotalInputCount{200000};
+constexpr uint32_t FanOutCounts[]{10, 1000, 100000};
+constexpr uint32_t FanOutTotalContinuationCount{200000};
+constexpr uint32_t RoundTripCount{20000};
+constexpr uint32_t CancelListenerCounts[]{1, 10, 100};
+constexpr uint32_t CancelTotalListenerCount{200000};
+constexpr uint32_t CancelThreadCount{4};
+constexpr uint32_t WaitCount{100000};
+
+// Posts chains of futures where each future has depth continuations. Operations are the futures.
+uint64_t RunThenChain(uint32_t depth, uint32_t futureCount) noexcept
+{
+  uint32_t chainCount = std::max(futureCount / (depth + 1), 1u);
+  std::vector<Mso::Future<uint32_t>> chains;
+  chains.reserve(chainCount);
+  for (uint32_t i = 0; i < chainCount; ++i)
+  {
+    Mso::Future<uint32_t> future = Mso::PostFuture([]() noexcept { return 0u; });
+    for (uint32_t j = 0; j < depth; ++j)
+    {
+      future = future.Then([](uint32_t value) noexcept { return value + 1; });
+    }
+
+    chains.push_back(std::move(future));
+  }
+
+  for (auto& chain : chains)
+  {
+    (void)Mso::FutureWait(chain);
+  }
+
+  return uint64_t{chainCount} * (depth + 1);
+}
+
+// Completes inputCount promises observed by WhenAll or WhenAny. Operations are the inputs.
+template <typename TWhen>
+uint64_t RunWhen(uint32_t inputCount, uint32_t totalInputCount, TWhen&& when) noexcept
+{
+  uint32_t iterationCount = std::max(totalInputCount / inputCount, 1u);
+  for (uint32_t i = 0; i < iterationCount; ++i)
+  {
+    std::vector<Mso::Promise<uint32_t>> promises(inputCount);
+    std::vector<Mso::Future<uint32_t>> futures;
+    futures.reserve(inputCount);
+    for (auto& promise : promises)
+    {
+      futures.push_back(promise.AsFuture());
+    }
+
+    auto whenFuture = when(futures);
+    for (uint32_t j = 0; j < inputCount; ++j)
+    {
+      promises[j].SetValue(j);
+    }
+
+    (void)Mso::FutureWait(whenFuture);
+  }
+
+  return uint64_t{iterationCount} * inputCount;
+}
+
+// Completes a SharedFuture with continuationCount inline continuations. Operations are the continuations.
+uint64_t RunSharedFanOut(uint32_t continuationCount, uint32_t totalContinuationCount) noexcept
+{
+  uint32_t iterationCount = std::max(totalContinuationCount / continuationCount, 1u);
+  uint64_t invokeCount{0};
+  for (uint32_t i = 0; i < iterationCount; ++i)
+  {
+    Mso::Promise<uint32_t> promise;
+    Mso::SharedFuture<uint32_t> sharedFuture = promise.AsFuture().Share();
+    std::vector<Mso::Future<void>> continuations;
+    continuations.reserve(continuationCount);
+    for (uint32_t j = 0; j < continuationCount; ++j)
+    {
+      continuations.push_back(sharedFuture.Then(
+          Mso::Executors::Inline{}, [&invokeCount](uint32_t value) noexcept { invokeCount += value; }));
+    }
+
+    promise.SetValue(1);
+  }
+
+  return invokeCount;
+}
+
+// A promise set in this thread is observed by a continuation in the serial queue thread. The continuation sets
+// another promise that this thread waits for. Operations are the round trips.
+uint64_t RunPromiseRoundTrip(uint32_t roundTripCount) noexcept
+{
+  Mso::DispatchQueue queue = Mso::DispatchQueue::MakeSerialQueue();
+  for (uint32_t i = 0; i < roundTripCount; ++i)
+  {
+    Mso::Promise<void> ping;
+    Mso::Promise<void> pong;
+    (void)ping.AsFuture().Then(queue, [pong]() noexcept { pong.SetValue(); });
+    ping.SetValue();
+    (void)Mso::FutureWait(pong.AsFuture());
+  }
+
+  queue.AwaitTermination();
+  return roundTripCount;
+}
+
+// Creates sources with listenerCount listeners each and cancels every source from several threads at once.
+// Operations are the listeners.
+uint64_t RunCancelStorm(uint32_t listenerCount, uint32_t totalListenerCount) noexcept
+{
+  uint32_t sourceCount = std::max(totalListenerCount / listenerCount, 1u);
+  std::vector<Mso::CancellationTokenSource> sources(sourceCount);
+  std::atomic<uint64_t> canceledCount{0};
+  for (auto& source : sources)
+  {
+    for (uint32_t i = 0; i < listenerCount; ++i)
+    {
+      source.GetToken().WhenCanceled(
+          [&canceledCount]() noexcept { canceledCount.fetch_add(1, std::memory_order_relaxed); });
+    }
+  }
+
+  std::atomic<bool> isStarted{false};
+  std::vector<std::thread> threads;
+  for (uint32_t i = 0; i < CancelThreadCount; ++i)
+  {
+    threads.emplace_back([&sources, &isStarted]() noexcept {
+      while (!isStarted.load(std::memory_order_acquire))
+      {
+        std::this_thread::yield();
+      }
+
+      for (auto& source : sources)
+      {
+        source.Cancel();
+      }
+    });
+  }
+
+  isStarted.store(true, std::memory_order_release);
+  for (auto& thread : threads)
+  {
+    thread.join();
+  }
+
+  return canceledCount.load();
+}
+
+// Posts a future to the thread pool and waits for it. Operations are the waits.
+uint64_t RunFutureWait(uint32_t waitCount) noexcept
+{
+  for (uint32_t i = 0; i < waitCount; ++i)
+  {
+    (void)Mso::FutureWait(Mso::PostFuture([i]() noexcept { return i; }));
+  }
+
+  return waitCount;
+}
+
+// Runs the benchmark if it is selected by the filter. The run function returns the number of completed operations.
+template <typename TRun>
+void RunBenchmark(
+    Mso::BenchmarkReporter& reporter, char const* name, uint32_t size, uint32_t threadCount, TRun&& run) noexcept
+{
+  std::string variant = std::to_string(size);
+  if (reporter.ShouldRun(name, variant.c_str()))
+  {
+    uint64_t operations{0};
+    Mso::BenchmarkMeasurement best = reporter.MeasureBest([&]() noexcept {
+      auto start = std::chrono::steady_clock::now();
+      operations = run();
+      return std::chrono::steady_clock::now() - start;
+    });
+    reporter.Report({name, std::move(variant), threadCount, operations, best});
+  }
+}
+
+} // namespace
+
+} // namespace FutureBenchmarks
+
+int main(int argc, char** argv)
+{
+  using namespace FutureBenchmarks;
+  Mso::BenchmarkOptions options;
+  if (!Mso::TryParseBenchmarkOptions(argc, argv, /*out*/ options))
+  {
+    return 2;
+  }
+
+  if (!IsCountingMallocCalls())
+  {
+    std::fprintf(stderr, "Only operator new calls are counted as allocations in this build.\n");
+  }
+
+  Mso::BenchmarkReporter reporter{options, "size", &GetAllocationCount};
+  reporter.AddContext("counts_malloc", IsCountingMallocCalls());
+  for (uint32_t depth : ChainDepths)
+  {
+    uint32_t futureCount = reporter.Scale(ChainFutureCount);
+    RunBenchmark(reporter, "then-chain", depth, 1, [=]() noexcept { return RunThenChain(depth, futureCount); });
+  }
+
+  for (uint32_t inputCount : WhenInputCounts)
+  {
+    uint32_t totalInputCount = reporter.Scale(WhenTotalInputCount);
+    RunBenchmark(reporter, "when-all", inputCount, 1, [=]() noexcept {
+      return RunWhen(inputCount, totalInputCount, [](auto const& futures) noexcept { return Mso::WhenAll(futures); });
+    });
+    RunBenchmark(reporter, "when-any", inputCount, 1, [=]() noexcept {
+      return RunWhen(inputCount, totalInputCount, [](auto const& futures) noexcept { return Mso::WhenAny(futures); });
+    });
+  }
+
+  for (uint32_t continuationCount : FanOutCounts)
+  {
+    uint32_t totalContinuationCount = reporter.Scale(FanOutTotalContinuationCount);
+    RunBenchmark(reporter, "shared-fan-out", continuationCount, 1, [=]() noexcept {
+      return RunSharedFanOut(continuationCount, totalContinuationCount);
+    });
+  }
+
+  uint32_t roundTripCount = reporter.Scale(RoundTripCount);
+  RunBenchmark(reporter, "promise-round-trip", 1, 2, [=]() noexcept { return RunPromiseRoundTrip(roundTripCount); });
+
+  for (uint32_t listenerCount : CancelListenerCounts)
+  {
+    uint32_t totalListenerCount = reporter.Scale(CancelTotalListenerCount);
+    RunBenchmark(reporter, "cancel-storm", listenerCount, CancelThreadCount, [=]() noexcept {
+      return RunCancelStorm(listenerCount, totalListenerCount);
+    });
+  }
+
+  uint32_t waitCount = reporter.Scale(WaitCount);
+  RunBenchmark(reporter, "future-wait", 1, 1, [=]() noexcept { return RunFutureWait(waitCount); });
+  return reporter.Finish() ? 0 : 1;
+}
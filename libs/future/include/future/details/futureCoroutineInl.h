@@ -0,0 +1,240 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+// We do not use pragma once because the file is empty if FUTURE_INLINE_DEFS is not defined
+#ifdef MSO_FUTURE_INLINE_DEFS
+
+#ifndef MSO_FUTURE_DETAILS_FUTURECOROUTINEINL_H
+#define MSO_FUTURE_DETAILS_FUTURECOROUTINEINL_H
+
+#if MSO_HAS_COROUTINES
+
+namespace Mso {
+namespace Futures {
+
+//=============================================================================
+// Coroutine helpers
+//=============================================================================
+
+//! Task of the continuation future that resumes a coroutine awaiting for the parent future.
+//! The continuation is invoked for both succeeded and failed parent futures because the awaiter reads the parent
+//! result after the coroutine is resumed.
+struct CoroutineResumeTask
+{
+  CoroutineResumeTask() = delete;
+  ~CoroutineResumeTask() = delete;
+
+  static void Invoke(const ByteArrayView& taskBuffer, IFuture* future, IFuture* /*parentFuture*/) noexcept
+  {
+    std::coroutine_handle<> handle =
+        *static_cast<std::coroutine_handle<>*>(taskBuffer.VoidDataChecked(sizeof(std::coroutine_handle<>)));
+    (void)future->TrySetSuccess(/*crashIfFailed:*/ true);
+    handle.resume();
+  }
+
+  //! Add a continuation to the future that resumes the coroutine after the future completes.
+  static void AddContinuation(IFuture* future, std::coroutine_handle<> handle) noexcept
+  {
+    constexpr const auto& continuationTraits = Mso::Futures::FutureTraitsProvider<
+        /*Options:    */ FutureOptions::CallTaskInvokeOnError,
+        /*ResultType: */ void,
+        /*TaskType:   */ std::coroutine_handle<>,
+        /*PostType:   */ void,
+        /*InvokeType: */ CoroutineResumeTask,
+        /*CatchType:  */ void>::Traits;
+
+    ByteArrayView taskBuffer;
+    Mso::CntPtr<IFuture> continuation =
+        Mso::Futures::MakeFuture(continuationTraits, sizeof(std::coroutine_handle<>), &taskBuffer);
+    ::new (taskBuffer.VoidDataChecked(sizeof(std::coroutine_handle<>))) std::coroutine_handle<>(handle);
+    future->AddContinuation(std::move(continuation));
+  }
+};
+
+//! Convert the exception thrown from a coroutine to ErrorCode. The ErrorCodeException thrown for a failed awaited
+//! future gives back its original error. Thus, the cancellation of an awaited future cancels the coroutine future.
+inline Mso::ErrorCode CurrentExceptionToErrorCode() noexcept
+{
+  try
+  {
+    throw;
+  }
+  catch (const Mso::ErrorCodeException& exception)
+  {
+    return exception.Error();
+  }
+  catch (...)
+  {
+    return Mso::ExceptionErrorProvider().MakeErrorCode(std::current_exception());
+  }
+}
+
+//! Throw an exception for the failed future. The original exception is rethrown for the ExceptionErrorProvider
+//! errors. Other errors are thrown as ErrorCodeException to keep the error code intact for the awaiting coroutine.
+inline void ThrowIfFailed(IFuture* future)
+{
+  if (future->IsFailed())
+  {
+    const Mso::ErrorCode& error = future->GetError();
+    if (Mso::ExceptionErrorProvider().IsOwnedErrorCode(error))
+    {
+      error.Throw();
+    }
+
+    throw Mso::ErrorCodeException(error);
+  }
+}
+
+//=============================================================================
+// FutureAwaiter implementation
+//=============================================================================
+
+template <class T>
+inline bool FutureAwaiter<T>::await_ready() const noexcept
+{
+  IFuture* future = GetIFuture(Future);
+  VerifyElseCrashSz(future, "Cannot await an empty future");
+  return future->IsDone();
+}
+
+template <class T>
+inline void FutureAwaiter<T>::await_suspend(std::coroutine_handle<> handle) const noexcept
+{
+  CoroutineResumeTask::AddContinuation(GetIFuture(Future), handle);
+}
+
+template <class T>
+inline T FutureAwaiter<T>::await_resume() const
+{
+  IFuture* future = GetIFuture(Future);
+  ThrowIfFailed(future);
+  if constexpr (!std::is_void_v<T>)
+  {
+    // Future has only one consumer. Thus, we can move the value out.
+    return std::move(*future->GetValue().template As<T>());
+  }
+}
+
+//=============================================================================
+// SharedFutureAwaiter implementation
+//=============================================================================
+
+template <class T>
+inline bool SharedFutureAwaiter<T>::await_ready() const noexcept
+{
+  IFuture* future = GetIFuture(Future);
+  VerifyElseCrashSz(future, "Cannot await an empty future");
+  return future->IsDone();
+}
+
+template <class T>
+inline void SharedFutureAwaiter<T>::await_suspend(std::coroutine_handle<> handle) const noexcept
+{
+  CoroutineResumeTask::AddContinuation(GetIFuture(Future), handle);
+}
+
+template <class T>
+inline typename SharedFutureAwaiter<T>::ResultType SharedFutureAwaiter<T>::await_resume() const
+{
+  IFuture* future = GetIFuture(Future);
+  ThrowIfFailed(future);
+  if constexpr (!std::is_void_v<T>)
+  {
+    // The value is shared between all consumers. The awaiter keeps it alive while the reference is used.
+    return *future->GetValue().template As<T>();
+  }
+}
+
+//=============================================================================
+// FuturePromiseBase implementation
+//=============================================================================
+
+template <class T>
+inline FuturePromiseBase<T>::FuturePromiseBase() noexcept
+{
+  constexpr const auto& promiseTraits = Mso::Futures::FutureTraitsProvider<
+      /*Options:     */ Mso::Futures::FutureOptions::CancelIfUnfulfilled,
+      /*ResultType:  */ T,
+      /*TaskType:    */ void,
+      /*PostType:    */ void,
+      /*InvokeType:  */ void,
+      /*AbandonType: */ void>::Traits;
+
+  m_state = Mso::Futures::MakeFuture(promiseTraits, 0, nullptr);
+}
+
+template <class T>
+inline FuturePromiseBase<T>::~FuturePromiseBase() noexcept
+{
+  // The coroutine frame is destroyed before completion if it was canceled while suspended.
+  if (!m_state->IsDone())
+  {
+    (void)m_state->TrySetError(Mso::CancellationErrorProvider().MakeErrorCode(true));
+  }
+}
+
+template <class T>
+inline Mso::Future<T> FuturePromiseBase<T>::get_return_object() noexcept
+{
+  return Mso::Future<T>{Mso::CntPtr<IFuture>{m_state}};
+}
+
+template <class T>
+inline std::suspend_never FuturePromiseBase<T>::initial_suspend() const noexcept
+{
+  return {};
+}
+
+template <class T>
+inline std::suspend_never FuturePromiseBase<T>::final_suspend() const noexcept
+{
+  return {};
+}
+
+template <class T>
+inline void FuturePromiseBase<T>::unhandled_exception() noexcept
+{
+  (void)m_state->TrySetError(CurrentExceptionToErrorCode(), /*crashIfFailed:*/ true);
+}
+
+//=============================================================================
+// FuturePromise implementation
+//=============================================================================
+
+template <class T>
+template <class U>
+inline void FuturePromise<T>::return_value(U&& value) noexcept
+{
+  this->m_state->template SetValue<T>(std::forward<U>(value));
+}
+
+inline void FuturePromise<void>::return_void() noexcept
+{
+  (void)m_state->TrySetSuccess(/*crashIfFailed:*/ true);
+}
+
+} // namespace Futures
+
+//=============================================================================
+// Standalone coroutine functions
+//=============================================================================
+
+template <class T>
+inline Mso::Futures::FutureAwaiter<T> operator co_await(Mso::Future<T> future) noexcept
+{
+  return Mso::Futures::FutureAwaiter<T>{std::move(future)};
+}
+
+template <class T>
+inline Mso::Futures::SharedFutureAwaiter<T> operator co_await(Mso::SharedFuture<T> future) noexcept
+{
+  return Mso::Futures::SharedFutureAwaiter<T>{std::move(future)};
+}
+
+} // namespace Mso
+
+#endif // MSO_HAS_COROUTINES
+
+#endif // MSO_FUTURE_DETAILS_FUTURECOROUTINEINL_H
+
+#endif // MSO_FUTURE_INLINE_DEFS
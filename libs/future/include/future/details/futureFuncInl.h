@@ -169,6 +169,17 @@ auto PostFuture(TExecutor&& executor, TCallback&& callback) noexcept
   return typename ExecutorTraits::template FutureType<ValueType>(std::move(future));
 }
 
+inline Future<void> PostWhenSpace(const Mso::DispatchQueue& queue, Mso::DispatchTask&& task) noexcept
+{
+  Promise<void> promise;
+  Future<void> result = promise.AsFuture();
+  queue.PostWhenSpace(
+      std::move(task),
+      Mso::MakeDispatchTask(
+          [promise]() noexcept { promise.SetValue(); }, [promise]() noexcept { promise.TryCancel(); }));
+  return result;
+}
+
 } // namespace Mso
 
 #endif // MSO_FUTURE_DETAILS_FUTUREFUNCINL_H
@@ -112,6 +112,21 @@ struct IFuture : IUnknown
 LIBLET_PUBLICAPI Mso::CntPtr<IFuture>
 MakeFuture(const FutureTraits& traits, size_t taskSize = 0, _Out_opt_ ByteArrayView* taskBuffer = nullptr) noexcept;
 
+//! Counters of the allocator for the future memory blocks.
+//! ThreadCacheHitCount / AllocationCount is the hit rate of the per-thread free lists.
+struct FutureAllocatorStats
+{
+  uint64_t AllocationCount{0}; //!< All future block allocations.
+  uint64_t ThreadCacheHitCount{0}; //!< Allocations served from the free list of the allocating thread.
+  uint64_t CentralCacheHitCount{0}; //!< Allocations served from the central free list shared by all threads.
+  uint64_t HeapAllocationCount{0}; //!< Allocations that had to call the heap.
+  uint64_t CrossThreadFreeCount{0}; //!< Blocks released by a thread other than the allocating thread.
+};
+
+//! Returns the sum of the allocator counters of all threads since the process start.
+//! The counters of running threads are read without synchronization and the result is approximate.
+LIBLET_PUBLICAPI FutureAllocatorStats GetFutureAllocatorStats() noexcept;
+
 } // namespace Mso::Futures
 
 #endif // MSO_FUTURE_DETAILS_IFUTURE_H
@@ -63,6 +63,74 @@ private:
   uintptr_t m_ptr{0};
 };
 
+//! Open addressing hash table that maps parent futures to their indexes in WhenAllFutureTask::ParentFutures.
+//! The table is allocated in the task buffer right after the ParentFutures array. It lets a parent future continuation
+//! find its slot in O(1) instead of scanning all parent futures, which made WhenAll over N futures O(N^2).
+//! Table entries store the slot index plus one, and zero marks an empty entry.
+struct WhenAllSlotTable
+{
+  WhenAllSlotTable() = delete;
+  ~WhenAllSlotTable() = delete;
+
+  //! Number of table entries. It is a power of two that keeps the load factor at or below one half.
+  static constexpr size_t GetCapacity(size_t futureCount) noexcept
+  {
+    size_t capacity = 1;
+    while (capacity < futureCount * 2)
+    {
+      capacity <<= 1;
+    }
+
+    return capacity;
+  }
+
+  static constexpr size_t GetSize(size_t futureCount) noexcept
+  {
+    return GetCapacity(futureCount) * sizeof(uint32_t);
+  }
+
+  static void Build(uint32_t* table, RawOrCntPtr<IFuture>* futures, size_t futureCount) noexcept
+  {
+    const size_t mask = GetCapacity(futureCount) - 1;
+    std::fill(table, table + mask + 1, 0u);
+    for (size_t slot = 0; slot < futureCount; ++slot)
+    {
+      size_t i = GetHash(futures[slot].Get()) & mask;
+      while (table[i] != 0)
+      {
+        i = (i + 1) & mask;
+      }
+
+      table[i] = static_cast<uint32_t>(slot + 1);
+    }
+  }
+
+  //! Returns the parent future slot or null if the future is not in the table.
+  static RawOrCntPtr<IFuture>*
+  Find(const uint32_t* table, RawOrCntPtr<IFuture>* futures, size_t futureCount, IFuture* future) noexcept
+  {
+    const size_t mask = GetCapacity(futureCount) - 1;
+    for (size_t i = GetHash(future) & mask; table[i] != 0; i = (i + 1) & mask)
+    {
+      RawOrCntPtr<IFuture>* slot = &futures[table[i] - 1];
+      if (slot->Get() == future)
+      {
+        return slot;
+      }
+    }
+
+    return nullptr;
+  }
+
+private:
+  static size_t GetHash(IFuture* future) noexcept
+  {
+    // Fibonacci hashing spreads the aligned pointer values over the high bits.
+    uint64_t hash = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(future)) * 0x9E3779B97F4A7C15ull;
+    return static_cast<size_t>(hash >> 32);
+  }
+};
+
 template <class T>
 struct WhenAllFutureTask
 {
@@ -71,7 +139,7 @@ struct WhenAllFutureTask
 
   // List of pointers to parent futures. We use these pointers to copy values when setting result value.
   // This field must be the last one in the struct because we assume that other array elements are allocated after the
-  // WhenAllFutureTask struct. Also, after this array we allocate an array for result values.
+  // WhenAllFutureTask struct. After this array we allocate the WhenAllSlotTable and then an array for result values.
   RawOrCntPtr<Mso::Futures::IFuture> ParentFutures[1];
 
   // Used by Mso::WhenAll that returns tuple. We only have specialization for void type T.
@@ -85,19 +153,26 @@ struct WhenAllFutureTask
     return (size + std::alignment_of<T>::value - 1) & ~(std::alignment_of<T>::value - 1);
   }
 
+  static constexpr size_t GetValueOffset(size_t futureCount) noexcept
+  {
+    return GetAlignedSize(
+        sizeof(WhenAllFutureTask) + (futureCount - 1) * sizeof(RawOrCntPtr<Mso::Futures::IFuture>)
+        + WhenAllSlotTable::GetSize(futureCount));
+  }
+
   static constexpr size_t GetTaskSize(size_t futureCount) noexcept
   {
-    return (futureCount > 0)
-        ? GetAlignedSize(sizeof(WhenAllFutureTask) + (futureCount - 1) * sizeof(RawOrCntPtr<Mso::Futures::IFuture>))
-            + futureCount * sizeof(T)
-        : sizeof(WhenAllFutureTask);
+    return (futureCount > 0) ? GetValueOffset(futureCount) + futureCount * sizeof(T) : sizeof(WhenAllFutureTask);
+  }
+
+  uint32_t* GetSlotTable() noexcept
+  {
+    return reinterpret_cast<uint32_t*>(ParentFutures + FutureCount);
   }
 
   T* GetValuePtr() noexcept
   {
-    T* ptr = reinterpret_cast<T*>(
-        reinterpret_cast<uint8_t*>(this)
-        + GetAlignedSize(sizeof(WhenAllFutureTask) + (FutureCount - 1) * sizeof(RawOrCntPtr<Mso::Futures::IFuture>)));
+    T* ptr = reinterpret_cast<T*>(reinterpret_cast<uint8_t*>(this) + GetValueOffset(FutureCount));
     VerifyElseCrashSzTag(
         (reinterpret_cast<uintptr_t>(ptr) & (std::alignment_of<T>::value - 1)) == 0,
         "WhenAll value is not aligned",
@@ -135,7 +210,8 @@ struct WhenAllFutureTask<void>
 
   // List of pointers to parent futures. We use these pointers to copy values when setting result value.
   // This field must be the last one in the struct because we assume that other array elements are allocated after the
-  // WhenAllFutureTask struct. We do not store result array because type is void.
+  // WhenAllFutureTask struct. After this array we allocate the WhenAllSlotTable. We do not store result array because
+  // type is void.
   RawOrCntPtr<Mso::Futures::IFuture> ParentFutures[1];
 
   // Used by Mso::WhenAll that returns tuple.
@@ -148,9 +224,14 @@ struct WhenAllFutureTask<void>
 
   static constexpr size_t GetTaskSize(size_t futureCount) noexcept
   {
-    return (futureCount > 0)
-        ? sizeof(WhenAllFutureTask) + (futureCount - 1) * sizeof(RawOrCntPtr<Mso::Futures::IFuture>)
-        : sizeof(WhenAllFutureTask);
+    return (futureCount > 0) ? sizeof(WhenAllFutureTask)
+            + (futureCount - 1) * sizeof(RawOrCntPtr<Mso::Futures::IFuture>) + WhenAllSlotTable::GetSize(futureCount)
+                             : sizeof(WhenAllFutureTask);
+  }
+
+  uint32_t* GetSlotTable() noexcept
+  {
+    return reinterpret_cast<uint32_t*>(ParentFutures + FutureCount);
   }
 
   LIBLET_PUBLICAPI static void Destroy(const ByteArrayView& obj) noexcept;
@@ -172,19 +253,11 @@ struct WhenAllTaskInvoke
     VerifyElseCrashTag(
         taskBuffer.Size() == WhenAllFutureTask<T>::GetTaskSize(task->FutureCount), 0x016056dd /* tag_byf13 */);
 
-    bool found = false;
-    for (size_t i = 0; i < task->FutureCount; ++i)
-    {
-      auto& storedFuture = task->ParentFutures[i];
-      if (parentFuture == storedFuture.Get())
-      {
-        storedFuture.ConvertToCntPtr();
-        found = true;
-        break;
-      }
-    }
-
-    VerifyElseCrashSzTag(found, "parent future is not found", 0x012ca410 /* tag_blkqq */);
+    // Keep the parent future alive to take its value when all parent futures complete.
+    auto storedFuture =
+        WhenAllSlotTable::Find(task->GetSlotTable(), task->ParentFutures, task->FutureCount, parentFuture);
+    VerifyElseCrashSzTag(storedFuture, "parent future is not found", 0x012ca410 /* tag_blkqq */);
+    storedFuture->ConvertToCntPtr();
 
     if (++task->CompleteCount == task->FutureCount)
     {
@@ -238,19 +311,9 @@ struct WhenAllTupleTaskInvoke
     constexpr const size_t futureCount = sizeof...(Ts);
     constexpr const size_t taskSize = WhenAllFutureTask<void>::GetTaskSize(futureCount);
     auto task = reinterpret_cast<WhenAllFutureTask<void>*>(taskBuffer.VoidDataChecked(taskSize));
-    bool found = false;
-    for (size_t i = 0; i < futureCount; ++i)
-    {
-      auto& storedFuture = task->ParentFutures[i];
-      if (parentFuture == storedFuture.Get())
-      {
-        storedFuture.ConvertToCntPtr();
-        found = true;
-        break;
-      }
-    }
-
-    VerifyElseCrashSzTag(found, "parent future is not found", 0x012ca412 /* tag_blkqs */);
+    auto storedFuture = WhenAllSlotTable::Find(task->GetSlotTable(), task->ParentFutures, futureCount, parentFuture);
+    VerifyElseCrashSzTag(storedFuture, "parent future is not found", 0x012ca412 /* tag_blkqs */);
+    storedFuture->ConvertToCntPtr();
 
     if (++task->CompleteCount == futureCount)
     {
@@ -298,6 +361,8 @@ inline Future<Mso::Async::ArrayView<T>> WhenAll(Mso::Async::ArrayView<Future<T>>
     ::new (&task->ParentFutures[i++]) Mso::Futures::RawOrCntPtr<Mso::Futures::IFuture>(Mso::GetIFuture(parentFuture));
   }
 
+  Mso::Futures::WhenAllSlotTable::Build(task->GetSlotTable(), task->ParentFutures, task->FutureCount);
+
   // Use a separate loop to add whenAllFuture to the parent futures because parent futures may start
   // invoke our whenAllFuture while we still in this function.
   for (const Future<T>& parentFuture : futures)
@@ -0,0 +1,101 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+// We do not use pragma once because the file is empty if FUTURE_INLINE_DEFS is not defined
+#ifdef MSO_FUTURE_INLINE_DEFS
+
+#ifndef MSO_FUTURE_DETAILS_WHENDONEORTIMEOUTINL_H
+#define MSO_FUTURE_DETAILS_WHENDONEORTIMEOUTINL_H
+
+namespace Mso {
+namespace Futures {
+
+//! Task of the continuation that completes the WhenDoneOrTimeout future with the parent future result.
+//! The TimeoutTimer completes the same future with the TimeoutError. Whichever comes first wins, and the continuation
+//! cancels the timer to release its future reference without waiting for the timeout.
+struct WhenDoneOrTimeoutTask
+{
+  WhenDoneOrTimeoutTask() = delete;
+  ~WhenDoneOrTimeoutTask() = delete;
+
+  LIBLET_PUBLICAPI static void
+  Catch(const ByteArrayView& taskBuffer, IFuture* future, ErrorCode&& parentError) noexcept;
+  constexpr static FutureCatchCallback* CatchPtr = &Catch;
+
+  LIBLET_PUBLICAPI static void Destroy(const ByteArrayView& taskBuffer) noexcept;
+
+  //! Start the timer that sets the TimeoutError to the future when the timeout expires.
+  LIBLET_PUBLICAPI static Mso::DispatchTimer StartTimeoutTimer(
+      const Mso::CntPtr<IFuture>& future,
+      std::chrono::milliseconds timeout) noexcept;
+
+  Mso::CntPtr<IFuture> FutureToComplete;
+  Mso::DispatchTimer TimeoutTimer;
+};
+
+// ValueTraits specialization to enable use of WhenDoneOrTimeoutTask.
+template <>
+struct ValueTraits<WhenDoneOrTimeoutTask, false>
+{
+  constexpr static FutureDestroyCallback* DestroyPtr = &WhenDoneOrTimeoutTask::Destroy;
+};
+
+template <class T>
+struct WhenDoneOrTimeoutTaskInvoke
+{
+  static void Invoke(const ByteArrayView& taskBuffer, _In_ IFuture* future, _In_ IFuture* parentFuture) noexcept
+  {
+    auto task = taskBuffer.As<WhenDoneOrTimeoutTask>();
+    task->FutureToComplete->TrySetValue<T>(std::move(*parentFuture->GetValue().As<T>()));
+    task->TimeoutTimer.Cancel();
+    task->FutureToComplete.Clear();
+    future->TrySetSuccess(/*crashIfFailed:*/ true);
+  }
+};
+
+template <>
+struct WhenDoneOrTimeoutTaskInvoke<void>
+{
+  LIBLET_PUBLICAPI _Callback_ static void
+  Invoke(const ByteArrayView& taskBuffer, _In_ IFuture* future, _In_ IFuture* parentFuture) noexcept;
+};
+
+} // namespace Futures
+
+template <class T>
+Mso::Future<T> WhenDoneOrTimeout(const Mso::Future<T>& future, std::chrono::milliseconds timeout) noexcept
+{
+  constexpr const auto& resultTraits = Mso::Futures::FutureTraitsProvider<
+      /*Options:    */ Mso::Futures::FutureOptions::CancelIfUnfulfilled,
+      /*ResultType: */ T,
+      /*TaskType:   */ void,
+      /*PostType:   */ void,
+      /*InvokeType: */ void,
+      /*CatchType:  */ void>::Traits;
+
+  Mso::CntPtr<Mso::Futures::IFuture> resultFuture = Mso::Futures::MakeFuture(resultTraits, 0, nullptr);
+
+  using TaskType = Mso::Futures::WhenDoneOrTimeoutTask;
+  constexpr const auto& taskTraits = Mso::Futures::FutureTraitsProvider<
+      /*Options:    */ Mso::Futures::FutureOptions::UseParentValue,
+      /*ResultType: */ void,
+      /*TaskType:   */ TaskType,
+      /*PostType:   */ void,
+      /*InvokeType: */ Mso::Futures::WhenDoneOrTimeoutTaskInvoke<T>,
+      /*CatchType:  */ TaskType>::Traits;
+
+  Mso::Futures::ByteArrayView taskBuffer;
+  Mso::CntPtr<Mso::Futures::IFuture> taskFuture = Mso::Futures::MakeFuture(taskTraits, sizeof(TaskType), &taskBuffer);
+  ::new (std::addressof(taskBuffer.As<TaskType>()->FutureToComplete)) Mso::CntPtr<Mso::Futures::IFuture>(resultFuture);
+  ::new (std::addressof(taskBuffer.As<TaskType>()->TimeoutTimer))
+      Mso::DispatchTimer(TaskType::StartTimeoutTimer(resultFuture, timeout));
+
+  Mso::GetIFuture(future)->AddContinuation(std::move(taskFuture));
+
+  return Mso::Future<T>(std::move(resultFuture));
+}
+
+} // namespace Mso
+
+#endif // MSO_FUTURE_DETAILS_WHENDONEORTIMEOUTINL_H
+#endif // MSO_FUTURE_INLINE_DEFS
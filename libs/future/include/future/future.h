@@ -5,13 +5,19 @@
 #ifndef MSO_FUTURE_FUTURE_H
 #define MSO_FUTURE_FUTURE_H
 
+#include <algorithm>
 #include <chrono>
 #include <memory>
 #include <vector>
+#include "compilerAdapters/compilerFeatures.h"
 #include "compilerAdapters/managedCpp.h"
 #include "errorCode/maybe.h"
 #include "object/weakPtr.h"
 
+#if MSO_HAS_COROUTINES
+#include <coroutine>
+#endif
+
 MSO_PRAGMA_MANAGED_PUSH_OFF
 
 #include "details/cancellationErrorProvider.h"
@@ -228,9 +234,18 @@ LIBLET_PUBLICAPI Future<void> WhenAny(const std::vector<Future<void>>& futures)
 //! completes, or after a timeout.
 //! If the timeout expires, the resulting Future will contain an ErrorCode from the
 //! Mso::Async::TimeoutError provider.
-// TODO: implement
-// template <class T>
-// Mso::Future<T> WhenDoneOrTimeout(const Mso::Future<T>& future, std::chrono::milliseconds timeout) noexcept;
+//! The timeout does not block any thread: all timeouts share the dispatch queue timer thread.
+template <class T>
+Mso::Future<T> WhenDoneOrTimeout(const Mso::Future<T>& future, std::chrono::milliseconds timeout) noexcept;
+
+//=============================================================================
+// Mso::PostWhenSpace declaration.
+//=============================================================================
+
+//! Post the task to the queue when the number of its pending tasks drops below the queue capacity.
+//! The returned future succeeds after the task is posted, and it is canceled if the queue is shut down before that.
+//! Producers can wait for the future to slow down while a bounded queue falls behind.
+Future<void> PostWhenSpace(const Mso::DispatchQueue& queue, Mso::DispatchTask&& task) noexcept;
 
 //=============================================================================
 // Mso::GetIFuture declaration.
@@ -1034,6 +1049,81 @@ public:
   void Swap(WeakPtr& other) noexcept;
 };
 
+#if MSO_HAS_COROUTINES
+
+namespace Futures {
+
+//! Awaiter returned by co_await for a Future<T>. The coroutine is resumed in the thread that completes the future.
+//! If the future fails, then await_resume rethrows the original exception or throws ErrorCodeException with the error.
+template <class T>
+struct FutureAwaiter
+{
+  bool await_ready() const noexcept;
+  void await_suspend(std::coroutine_handle<> handle) const noexcept;
+  T await_resume() const;
+
+  Mso::Future<T> Future;
+};
+
+//! Awaiter returned by co_await for a SharedFuture<T>. It returns a const reference to the shared value.
+template <class T>
+struct SharedFutureAwaiter
+{
+  using ResultType = std::conditional_t<std::is_void_v<T>, void, const T&>;
+
+  bool await_ready() const noexcept;
+  void await_suspend(std::coroutine_handle<> handle) const noexcept;
+  ResultType await_resume() const;
+
+  Mso::SharedFuture<T> Future;
+};
+
+//! Common part of the promise_type for coroutines returning Future<T>.
+//! The coroutine starts eagerly and completes the returned future with the co_return value. An exception escaping the
+//! coroutine fails the future. A coroutine destroyed before completion, e.g. when a DispatchQueue cancels the task
+//! that resumes it, fails the future with the CancellationError.
+template <class T>
+struct FuturePromiseBase
+{
+  FuturePromiseBase() noexcept;
+  ~FuturePromiseBase() noexcept;
+
+  Mso::Future<T> get_return_object() noexcept;
+  std::suspend_never initial_suspend() const noexcept;
+  std::suspend_never final_suspend() const noexcept;
+  void unhandled_exception() noexcept;
+
+protected:
+  Mso::CntPtr<IFuture> m_state;
+};
+
+//! The promise_type for coroutines returning Future<T>.
+template <class T>
+struct FuturePromise : FuturePromiseBase<T>
+{
+  template <class U = T>
+  void return_value(U&& value) noexcept;
+};
+
+//! The promise_type for coroutines returning Future<void>.
+template <>
+struct FuturePromise<void> : FuturePromiseBase<void>
+{
+  void return_void() noexcept;
+};
+
+} // namespace Futures
+
+//! Await the future in a coroutine: auto value = co_await future;
+template <class T>
+Mso::Futures::FutureAwaiter<T> operator co_await(Mso::Future<T> future) noexcept;
+
+//! Await the shared future in a coroutine: const auto& value = co_await sharedFuture;
+template <class T>
+Mso::Futures::SharedFutureAwaiter<T> operator co_await(Mso::SharedFuture<T> future) noexcept;
+
+#endif // MSO_HAS_COROUTINES
+
 } // namespace Mso
 
 // std::swap specializations. They must be done in the std namespace because we override it for template classes.
@@ -1074,9 +1164,21 @@ inline void swap(Mso::WeakPtr<Mso::Future<T>>& weakPtr1, Mso::WeakPtr<Mso::Futur
   weakPtr1.Swap(weakPtr2);
 }
 
+#if MSO_HAS_COROUTINES
+
+/// Functions returning Mso::Future<T> can be coroutines.
+template <class T, class... TArgs>
+struct coroutine_traits<Mso::Future<T>, TArgs...>
+{
+  using promise_type = Mso::Futures::FuturePromise<T>;
+};
+
+#endif // MSO_HAS_COROUTINES
+
 } // namespace std
 
 #define MSO_FUTURE_INLINE_DEFS
+#include "details/futureCoroutineInl.h"
 #include "details/futureFuncInl.h"
 #include "details/futureInl.h"
 #include "details/futureWeakPtrInl.h"
@@ -1085,6 +1187,7 @@ inline void swap(Mso::WeakPtr<Mso::Future<T>>& weakPtr1, Mso::WeakPtr<Mso::Futur
 #include "details/sharedFutureInl.h"
 #include "details/whenAllInl.h"
 #include "details/whenAnyInl.h"
+#include "details/whenDoneOrTimeoutInl.h"
 #undef MSO_FUTURE_INLINE_DEFS
 
 MSO_PRAGMA_MANAGED_POP
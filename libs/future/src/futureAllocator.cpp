@@ -0,0 +1,372 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "futureAllocator.h"
+#include <array>
+#include <atomic>
+#include <mutex>
+#include "future/future.h"
+#include "memoryApi/memoryApi.h"
+
+namespace Mso {
+namespace Futures {
+
+namespace {
+
+constexpr size_t SizeClassGranularity{32};
+constexpr uint32_t SizeClassCount{16}; // Size classes cover blocks up to 512 bytes.
+constexpr uint32_t LargeSizeClass{SizeClassCount}; // Blocks allocated directly from the heap.
+constexpr uint32_t ThreadCacheMaxCount{64}; // Max count of free blocks per size class in a thread.
+constexpr uint32_t TransferBatchCount{32}; // Count of blocks moved between thread and central free lists at once.
+constexpr uint32_t CentralCacheMaxCount{4096}; // Max count of free blocks per size class in the central free list.
+
+//! Header in front of each block.
+struct BlockHeader
+{
+  uint32_t SizeClass;
+  uint32_t OwnerId; // Id of the thread cache that allocated the block, or zero if it was allocated without it.
+};
+
+static_assert(sizeof(BlockHeader) == 8, "BlockHeader must keep blocks aligned by 8 bytes");
+
+//! Free block reuses the memory after its header to link it into a free list.
+struct FreeBlock
+{
+  FreeBlock* Next;
+};
+
+struct FreeList
+{
+  void Push(FreeBlock* block) noexcept
+  {
+    block->Next = Head;
+    Head = block;
+    ++Count;
+  }
+
+  FreeBlock* Pop() noexcept
+  {
+    FreeBlock* block = Head;
+    Head = block->Next;
+    --Count;
+    return block;
+  }
+
+  FreeBlock* Head{nullptr};
+  uint32_t Count{0};
+};
+
+struct CentralFreeList
+{
+  std::mutex Mutex;
+  FreeList Blocks;
+};
+
+//! Thread cache counters are changed only by their owner thread. Thus, they do not need the atomic increment.
+//! They are atomic to let GetFutureAllocatorStats read them.
+void IncrementCounter(std::atomic<uint64_t>& counter) noexcept
+{
+  counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+struct AllocatorCounters
+{
+  void AddTo(FutureAllocatorStats& stats) const noexcept
+  {
+    stats.AllocationCount += AllocationCount.load(std::memory_order_relaxed);
+    stats.ThreadCacheHitCount += ThreadCacheHitCount.load(std::memory_order_relaxed);
+    stats.CentralCacheHitCount += CentralCacheHitCount.load(std::memory_order_relaxed);
+    stats.HeapAllocationCount += HeapAllocationCount.load(std::memory_order_relaxed);
+    stats.CrossThreadFreeCount += CrossThreadFreeCount.load(std::memory_order_relaxed);
+  }
+
+  std::atomic<uint64_t> AllocationCount{0};
+  std::atomic<uint64_t> ThreadCacheHitCount{0};
+  std::atomic<uint64_t> CentralCacheHitCount{0};
+  std::atomic<uint64_t> HeapAllocationCount{0};
+  std::atomic<uint64_t> CrossThreadFreeCount{0};
+};
+
+struct ThreadCache;
+
+//! Process-wide state shared by all threads.
+//! It is never destroyed because futures may be released in static destructors and by exiting threads.
+struct CentralCache
+{
+  static CentralCache& Instance() noexcept
+  {
+    static CentralCache* instance{new CentralCache()};
+    return *instance;
+  }
+
+  //! Take a batch of blocks to the thread free list. Returns false if the central free list is empty.
+  bool TakeBatch(uint32_t sizeClass, /*out*/ FreeList& blocks) noexcept;
+
+  //! Give blocks from the thread free list. Blocks beyond the central free list limit are returned to the heap.
+  void GiveBlocks(uint32_t sizeClass, FreeList& blocks, uint32_t count) noexcept;
+
+  void Register(ThreadCache* cache) noexcept;
+  void Unregister(ThreadCache* cache) noexcept;
+  FutureAllocatorStats GetStats() noexcept;
+
+  std::array<CentralFreeList, SizeClassCount> FreeLists;
+  std::atomic<uint32_t> NextCacheId{1};
+
+  // Counters of exited threads and of allocations in threads without a cache.
+  std::mutex CountersMutex;
+  AllocatorCounters RetiredCounters;
+  ThreadCache* Caches{nullptr}; // List of live thread caches.
+};
+
+//! Per-thread free lists.
+struct ThreadCache
+{
+  ThreadCache() noexcept;
+  ~ThreadCache() noexcept;
+
+  //! Returns null when the thread cache is already destroyed during the thread exit.
+  static ThreadCache* Current() noexcept;
+
+  void* Allocate(uint32_t sizeClass) noexcept;
+  void Deallocate(BlockHeader* header) noexcept;
+
+  const uint32_t Id;
+  std::array<FreeList, SizeClassCount> FreeLists;
+  AllocatorCounters Counters;
+  ThreadCache* Prev{nullptr};
+  ThreadCache* Next{nullptr};
+
+private:
+  static thread_local bool tls_isDestroyed;
+};
+
+size_t GetBlockSize(uint32_t sizeClass) noexcept
+{
+  return sizeof(BlockHeader) + (sizeClass + 1) * SizeClassGranularity;
+}
+
+void* AllocateFromHeap(size_t blockSize, uint32_t sizeClass, uint32_t ownerId) noexcept
+{
+  BlockHeader* header = static_cast<BlockHeader*>(
+      Mso::Memory::FailFast::AllocateEx(blockSize, Mso::Memory::AllocFlags::ShutdownLeak));
+  header->SizeClass = sizeClass;
+  header->OwnerId = ownerId;
+  return header + 1;
+}
+
+void* AllocateBlock(BlockHeader* header, uint32_t ownerId) noexcept
+{
+  header->OwnerId = ownerId;
+  return header + 1;
+}
+
+BlockHeader* GetHeader(FreeBlock* block) noexcept
+{
+  return reinterpret_cast<BlockHeader*>(block) - 1;
+}
+
+//=============================================================================
+// CentralCache implementation
+//=============================================================================
+
+bool CentralCache::TakeBatch(uint32_t sizeClass, /*out*/ FreeList& blocks) noexcept
+{
+  CentralFreeList& freeList = FreeLists[sizeClass];
+  std::lock_guard lock{freeList.Mutex};
+  for (uint32_t i = 0; i < TransferBatchCount && freeList.Blocks.Head; ++i)
+  {
+    blocks.Push(freeList.Blocks.Pop());
+  }
+
+  return blocks.Head != nullptr;
+}
+
+void CentralCache::GiveBlocks(uint32_t sizeClass, FreeList& blocks, uint32_t count) noexcept
+{
+  FreeList heapBlocks;
+  {
+    CentralFreeList& freeList = FreeLists[sizeClass];
+    std::lock_guard lock{freeList.Mutex};
+    for (uint32_t i = 0; i < count && blocks.Head; ++i)
+    {
+      if (freeList.Blocks.Count < CentralCacheMaxCount)
+      {
+        freeList.Blocks.Push(blocks.Pop());
+      }
+      else
+      {
+        heapBlocks.Push(blocks.Pop());
+      }
+    }
+  }
+
+  while (heapBlocks.Head)
+  {
+    Mso::Memory::Free(GetHeader(heapBlocks.Pop()));
+  }
+}
+
+void CentralCache::Register(ThreadCache* cache) noexcept
+{
+  std::lock_guard lock{CountersMutex};
+  cache->Next = Caches;
+  if (Caches)
+  {
+    Caches->Prev = cache;
+  }
+
+  Caches = cache;
+}
+
+void CentralCache::Unregister(ThreadCache* cache) noexcept
+{
+  std::lock_guard lock{CountersMutex};
+  FutureAllocatorStats stats;
+  cache->Counters.AddTo(stats);
+  RetiredCounters.AllocationCount += stats.AllocationCount;
+  RetiredCounters.ThreadCacheHitCount += stats.ThreadCacheHitCount;
+  RetiredCounters.CentralCacheHitCount += stats.CentralCacheHitCount;
+  RetiredCounters.HeapAllocationCount += stats.HeapAllocationCount;
+  RetiredCounters.CrossThreadFreeCount += stats.CrossThreadFreeCount;
+
+  (cache->Prev ? cache->Prev->Next : Caches) = cache->Next;
+  if (cache->Next)
+  {
+    cache->Next->Prev = cache->Prev;
+  }
+}
+
+FutureAllocatorStats CentralCache::GetStats() noexcept
+{
+  std::lock_guard lock{CountersMutex};
+  FutureAllocatorStats stats;
+  RetiredCounters.AddTo(stats);
+  for (ThreadCache* cache = Caches; cache; cache = cache->Next)
+  {
+    cache->Counters.AddTo(stats);
+  }
+
+  return stats;
+}
+
+//=============================================================================
+// ThreadCache implementation
+//=============================================================================
+
+/*static*/ thread_local bool ThreadCache::tls_isDestroyed{false};
+
+ThreadCache::ThreadCache() noexcept : Id{CentralCache::Instance().NextCacheId.fetch_add(1)}
+{
+  CentralCache::Instance().Register(this);
+}
+
+ThreadCache::~ThreadCache() noexcept
+{
+  tls_isDestroyed = true;
+  CentralCache& centralCache = CentralCache::Instance();
+  for (uint32_t sizeClass = 0; sizeClass < SizeClassCount; ++sizeClass)
+  {
+    centralCache.GiveBlocks(sizeClass, FreeLists[sizeClass], FreeLists[sizeClass].Count);
+  }
+
+  centralCache.Unregister(this);
+}
+
+/*static*/ ThreadCache* ThreadCache::Current() noexcept
+{
+  if (tls_isDestroyed)
+  {
+    return nullptr;
+  }
+
+  static thread_local ThreadCache cache;
+  return &cache;
+}
+
+void* ThreadCache::Allocate(uint32_t sizeClass) noexcept
+{
+  IncrementCounter(Counters.AllocationCount);
+  FreeList& freeList = FreeLists[sizeClass];
+  if (freeList.Head)
+  {
+    IncrementCounter(Counters.ThreadCacheHitCount);
+    return AllocateBlock(GetHeader(freeList.Pop()), Id);
+  }
+
+  if (CentralCache::Instance().TakeBatch(sizeClass, /*out*/ freeList))
+  {
+    IncrementCounter(Counters.CentralCacheHitCount);
+    return AllocateBlock(GetHeader(freeList.Pop()), Id);
+  }
+
+  IncrementCounter(Counters.HeapAllocationCount);
+  return AllocateFromHeap(GetBlockSize(sizeClass), sizeClass, Id);
+}
+
+void ThreadCache::Deallocate(BlockHeader* header) noexcept
+{
+  if (header->OwnerId != Id)
+  {
+    IncrementCounter(Counters.CrossThreadFreeCount);
+  }
+
+  FreeList& freeList = FreeLists[header->SizeClass];
+  freeList.Push(reinterpret_cast<FreeBlock*>(header + 1));
+  if (freeList.Count > ThreadCacheMaxCount)
+  {
+    CentralCache::Instance().GiveBlocks(header->SizeClass, freeList, TransferBatchCount);
+  }
+}
+
+} // namespace
+
+//=============================================================================
+// FutureAllocator implementation
+//=============================================================================
+
+/*static*/ void* FutureAllocator::Allocate(size_t size) noexcept
+{
+  const uint32_t sizeClass =
+      (size <= SizeClassCount * SizeClassGranularity) ? static_cast<uint32_t>((size - 1) / SizeClassGranularity)
+                                                       : LargeSizeClass;
+  if (sizeClass != LargeSizeClass)
+  {
+    if (ThreadCache* cache = ThreadCache::Current())
+    {
+      return cache->Allocate(sizeClass);
+    }
+  }
+
+  CentralCache& centralCache = CentralCache::Instance();
+  centralCache.RetiredCounters.AllocationCount.fetch_add(1, std::memory_order_relaxed);
+  centralCache.RetiredCounters.HeapAllocationCount.fetch_add(1, std::memory_order_relaxed);
+  const size_t blockSize = (sizeClass != LargeSizeClass) ? GetBlockSize(sizeClass) : sizeof(BlockHeader) + size;
+  return AllocateFromHeap(blockSize, sizeClass, /*ownerId:*/ 0);
+}
+
+/*static*/ void FutureAllocator::Deallocate(void* ptr) noexcept
+{
+  BlockHeader* header = static_cast<BlockHeader*>(ptr) - 1;
+  if (header->SizeClass != LargeSizeClass)
+  {
+    if (ThreadCache* cache = ThreadCache::Current())
+    {
+      cache->Deallocate(header);
+      return;
+    }
+  }
+
+  Mso::Memory::Free(header);
+}
+
+//=============================================================================
+// GetFutureAllocatorStats implementation
+//=============================================================================
+
+LIBLET_PUBLICAPI FutureAllocatorStats GetFutureAllocatorStats() noexcept
+{
+  return CentralCache::Instance().GetStats();
+}
+
+} // namespace Futures
+} // namespace Mso
@@ -0,0 +1,31 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include <cstddef>
+
+namespace Mso {
+namespace Futures {
+
+//! Allocator for the memory blocks that hold FutureWeakRef, FutureImpl, FutureCallback, value, and task.
+//!
+//! Blocks are grouped into size classes. Each thread keeps a free list per size class and reuses the blocks freed in
+//! this thread without calling the heap. When a thread free list grows too long, or when the thread exits, the thread
+//! moves a batch of blocks to the shared central free list of the size class. A thread with an empty free list takes
+//! a batch back from the central free list before it falls back to the heap. A block released by another thread goes
+//! to the releasing thread free list. Thus, a thread that creates futures and a thread that releases them exchange
+//! the blocks through the central free lists in batches instead of calling the heap for each block.
+//!
+//! Blocks bigger than the largest size class are allocated directly from the heap.
+struct FutureAllocator
+{
+  //! Allocate a block aligned by 8 bytes. It never returns null.
+  static void* Allocate(size_t size) noexcept;
+
+  //! Release the block allocated by Allocate. It can be called from any thread.
+  static void Deallocate(void* ptr) noexcept;
+};
+
+} // namespace Futures
+} // namespace Mso
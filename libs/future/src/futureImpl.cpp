@@ -2,6 +2,7 @@
 // Licensed under the MIT license.
 
 #include "futureImpl.h"
+#include "futureAllocator.h"
 #include <thread>
 #include "eventWaitHandle/eventWaitHandle.h"
 #include "future/future.h"
@@ -100,7 +101,7 @@ MakeFuture(const FutureTraits& traits, size_t taskSize, _Out_opt_ ByteArrayView*
       "taskBuffer pointer must not be null for not zero taskSize",
       0x012ca39b /* tag_blko1 */);
 
-  void* memory = Mso::Memory::FailFast::AllocateEx(memorySize, Mso::Memory::AllocFlags::ShutdownLeak);
+  void* memory = FutureAllocator::Allocate(memorySize);
   VerifyElseCrashSzTag(IsAligned(memory), "memory for FutureImpl must be aligned.", 0x012ca39d /* tag_blko3 */);
 
   ::new (memory) FutureWeakRef();
@@ -302,6 +303,7 @@ void FutureImpl::Invoke() noexcept
   if (TrySetInvoking(/*crashIfFailed:*/ IsSynchronousCall()))
   {
     CurrentFutureImpl current{*this};
+    RecordDispatchTraceEvent(DispatchTraceEventKind::FutureInvokeStart, reinterpret_cast<uintptr_t>(this), this);
 
     if (!m_error)
     {
@@ -330,6 +332,8 @@ void FutureImpl::Invoke() noexcept
         (void)TrySetError(std::move(m_error), /*crashIfFailed:*/ true);
       }
     }
+
+    RecordDispatchTraceEvent(DispatchTraceEventKind::FutureInvokeEnd, reinterpret_cast<uintptr_t>(this), this);
   }
 }
 
@@ -1027,6 +1031,9 @@ void FutureImpl::PostContinuation(Mso::CntPtr<FutureImpl>&& continuation) noexce
   while (continuation)
   {
     // TryPostInternal returns next continuation in the single linked list.
+    // The continuation address is the trace flow id that connects the post with the continuation invocation.
+    RecordDispatchTraceEvent(
+        DispatchTraceEventKind::FuturePost, reinterpret_cast<uintptr_t>(continuation.Get()), this);
     Mso::CntPtr<FutureImpl> next;
     (void)continuation->TryPostInternal(this, /*ref*/ next, /*crashIfFailed:*/ false);
     continuation = std::move(next);
@@ -1177,7 +1184,7 @@ void FutureWeakRef::ReleaseWeakRef() const noexcept
       static_cast<int32_t>(weakRefCount) >= 0, "Weak ref count must not be negative.", 0x01605604 /* tag_byfye */));
   if (weakRefCount == 0)
   {
-    Mso::MakeAllocator::Deallocate(const_cast<FutureWeakRef*>(this));
+    FutureAllocator::Deallocate(const_cast<FutureWeakRef*>(this));
   }
 }
 
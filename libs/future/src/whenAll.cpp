@@ -35,6 +35,8 @@ LIBLET_PUBLICAPI Future<void> WhenAll(Mso::Async::ArrayView<Future<void>> future
     ::new (&task->ParentFutures[i++]) Mso::Futures::RawOrCntPtr<Mso::Futures::IFuture>(Mso::GetIFuture(parentFuture));
   }
 
+  Mso::Futures::WhenAllSlotTable::Build(task->GetSlotTable(), task->ParentFutures, task->FutureCount);
+
   // Use a separate loop to add whenAllFuture to the parent futures because parent futures may start
   // invoke our whenAllFuture while we still in this function.
   for (const Future<void>& parentFuture : futures)
@@ -68,6 +70,8 @@ LIBLET_PUBLICAPI WhenAllFutureTask<void>::WhenAllFutureTask(
     ::new (&ParentFutures[i++]) RawOrCntPtr<Mso::Futures::IFuture>(parentFuture);
   }
 
+  WhenAllSlotTable::Build(GetSlotTable(), ParentFutures, FutureCount);
+
   for (Mso::Futures::IFuture* parentFuture : init)
   {
     parentFuture->AddContinuation(Mso::CntPtr{futureState});
@@ -94,19 +98,10 @@ LIBLET_PUBLICAPI _Callback_ void WhenAllTaskInvoke<void>::Invoke(
   VerifyElseCrashTag(
       taskBuffer.Size() == WhenAllFutureTask<void>::GetTaskSize(task->FutureCount), 0x01605623 /* tag_byfy9 */);
 
-  bool found = false;
-  for (size_t i = 0; i < task->FutureCount; ++i)
-  {
-    auto& storedFuture = task->ParentFutures[i];
-    if (parentFuture == storedFuture.Get())
-    {
-      storedFuture.ConvertToCntPtr();
-      found = true;
-      break;
-    }
-  }
-
-  VerifyElseCrashSzTag(found, "parent future is not found", 0x01605640 /* tag_byfza */);
+  auto storedFuture =
+      WhenAllSlotTable::Find(task->GetSlotTable(), task->ParentFutures, task->FutureCount, parentFuture);
+  VerifyElseCrashSzTag(storedFuture, "parent future is not found", 0x01605640 /* tag_byfza */);
+  storedFuture->ConvertToCntPtr();
 
   if (++task->CompleteCount == task->FutureCount)
   {
@@ -0,0 +1,55 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "future/future.h"
+
+namespace Mso::Futures {
+
+LIBLET_PUBLICAPI void
+WhenDoneOrTimeoutTask::Catch(const ByteArrayView& taskBuffer, IFuture* future, ErrorCode&& parentError) noexcept
+{
+  auto task = taskBuffer.As<WhenDoneOrTimeoutTask>();
+  task->FutureToComplete->TrySetError(ErrorCode(parentError), /*crashIfFailed:*/ false);
+  task->TimeoutTimer.Cancel();
+  task->FutureToComplete.Clear();
+  future->TrySetError(std::move(parentError), /*crashIfFailed:*/ true);
+}
+
+LIBLET_PUBLICAPI void WhenDoneOrTimeoutTask::Destroy(const ByteArrayView& taskBuffer) noexcept
+{
+  auto task = taskBuffer.As<WhenDoneOrTimeoutTask>();
+  task->TimeoutTimer.Cancel();
+  task->FutureToComplete.Clear();
+}
+
+LIBLET_PUBLICAPI Mso::DispatchTimer WhenDoneOrTimeoutTask::StartTimeoutTimer(
+    const Mso::CntPtr<IFuture>& future,
+    std::chrono::milliseconds timeout) noexcept
+{
+  // The timer shares the TimerWheel thread with all other dispatch queue timers. It only blocks a concurrent queue
+  // thread for the short time needed to set the error.
+  return Mso::DispatchQueue::ConcurrentQueue().StartTimer(
+      timeout,
+      Mso::MakeDispatchTask(
+          [future]() noexcept {
+            future->TrySetError(Mso::Async::TimeoutError().MakeErrorCode(0), /*crashIfFailed:*/ false);
+          },
+          [future]() noexcept {
+            // The timer is canceled when the future is done or when the concurrent queue is shut down.
+            future->TrySetError(Mso::CancellationErrorProvider().MakeErrorCode(true), /*crashIfFailed:*/ false);
+          }));
+}
+
+LIBLET_PUBLICAPI _Callback_ void WhenDoneOrTimeoutTaskInvoke<void>::Invoke(
+    const ByteArrayView& taskBuffer,
+    _In_ IFuture* future,
+    _In_ IFuture* /*parentFuture*/) noexcept
+{
+  auto task = taskBuffer.As<WhenDoneOrTimeoutTask>();
+  task->FutureToComplete->TrySetSuccess(/*crashIfFailed:*/ false);
+  task->TimeoutTimer.Cancel();
+  task->FutureToComplete.Clear();
+  future->TrySetSuccess(/*crashIfFailed:*/ true);
+}
+
+} // namespace Mso::Futures
@@ -1,7 +1,14 @@
 // Copyright (c) Microsoft Corporation.
 // Licensed under the MIT license.
 
+#include <algorithm>
+#include <array>
+#include <memory>
+#include <optional>
+#include <string>
+#include <thread>
 #include "dispatchQueue/dispatchQueue.h"
+#include "eventWaitHandle/eventWaitHandle.h"
 #include "future/future.h"
 #include "future/futureWait.h"
 #include "motifCpp/libletAwareMemLeakDetection.h"
@@ -10,6 +17,113 @@
 
 namespace FutureTests {
 
+//! Scheduler that records Post calls. Tests invoke the queue tasks manually.
+struct PostCountingScheduler : Mso::UnknownObject<Mso::IDispatchQueueScheduler>
+{
+  void IntializeScheduler(Mso::WeakPtr<Mso::IDispatchQueueService>&& queue) noexcept override
+  {
+    Queue = std::move(queue);
+  }
+
+  bool HasThreadAccess() noexcept override
+  {
+    return false;
+  }
+
+  bool IsSerial() noexcept override
+  {
+    return true;
+  }
+
+  void Post(size_t taskCount) noexcept override
+  {
+    ++PostCallCount;
+    PostedTaskCount += taskCount;
+  }
+
+  void Shutdown() noexcept override {}
+
+  void AwaitTermination() noexcept override {}
+
+  size_t InvokeAllTasks() noexcept
+  {
+    size_t invokeCount{0};
+    if (auto queue = Queue.GetStrongPtr())
+    {
+      Mso::DispatchTask task;
+      while (queue->TryDequeTask(/*out*/ task))
+      {
+        queue->InvokeTask(std::move(task), std::nullopt);
+        ++invokeCount;
+      }
+    }
+
+    return invokeCount;
+  }
+
+  Mso::WeakPtr<Mso::IDispatchQueueService> Queue;
+  size_t PostCallCount{0};
+  size_t PostedTaskCount{0};
+};
+
+//! Scheduler that lets the test threads invoke the queue tasks. Its Post can be called from any thread.
+struct ExternalThreadScheduler : Mso::UnknownObject<Mso::IDispatchQueueScheduler>
+{
+  void IntializeScheduler(Mso::WeakPtr<Mso::IDispatchQueueService>&& queue) noexcept override
+  {
+    Queue = std::move(queue);
+  }
+
+  bool HasThreadAccess() noexcept override
+  {
+    return false;
+  }
+
+  bool IsSerial() noexcept override
+  {
+    return false;
+  }
+
+  void Post(size_t /*taskCount*/) noexcept override {}
+
+  void Shutdown() noexcept override {}
+
+  void AwaitTermination() noexcept override {}
+
+  Mso::WeakPtr<Mso::IDispatchQueueService> Queue;
+};
+
+//! Returns the number of the pattern occurrences in the text.
+static size_t CountSubstrings(const std::string& text, const std::string& pattern) noexcept
+{
+  size_t count{0};
+  for (size_t pos = text.find(pattern); pos != std::string::npos; pos = text.find(pattern, pos + pattern.size()))
+  {
+    ++count;
+  }
+
+  return count;
+}
+
+//! Returns the number of the trace flows of the category that have both the start and the end events.
+static size_t CountCompletedTraceFlows(const std::string& json, const std::string& category) noexcept
+{
+  size_t count{0};
+  const std::string flowStart{"\"cat\":\"" + category + "\",\"ph\":\"s\""};
+  for (size_t pos = json.find(flowStart); pos != std::string::npos; pos = json.find(flowStart, pos + 1))
+  {
+    // The flow end event has the same id followed by the binding point.
+    size_t idPos = json.find("\"id\":", pos);
+    size_t idEndPos = json.find('}', idPos);
+    if (json.find(json.substr(idPos, idEndPos - idPos) + ",\"bp\":\"e\"") != std::string::npos)
+    {
+      ++count;
+    }
+  }
+
+  return count;
+}
+
 TEST_CLASS_EX (ExecutorTest, LibletAwareMemLeakDetection)
 {
   // MemoryLeakDetectionHook::TrackPerTest m_trackLeakPerTest;
@@ -92,6 +206,1487 @@ TEST_CLASS_EX (ExecutorTest, LibletAwareMemLeakDetection)
     Mso::FutureWait(future);
     TestCheckEqual(5, value);
   }
+
+  TEST_METHOD(DefaultExecutorWorkStealing)
+  {
+    Mso::UnitTest_UninitConcurrentQueue();
+    Mso::SetConcurrentQueueScheduler(Mso::ConcurrentQueueScheduler::WorkStealing);
+
+    // Futures posted from the concurrent queue tasks are stored in the worker thread deques.
+    std::atomic<int> value{0};
+    auto future = Mso::PostFuture([&]() noexcept {
+      std::vector<Mso::Future<void>> futures;
+      for (int i = 0; i < 100; ++i)
+      {
+        futures.push_back(Mso::PostFuture([&]() noexcept { ++value; }));
+      }
+
+      return Mso::WhenAll(futures);
+    });
+
+    Mso::FutureWait(future);
+    TestCheckEqual(100, value.load());
+
+    Mso::UnitTest_UninitConcurrentQueue();
+    Mso::SetConcurrentQueueScheduler(Mso::ConcurrentQueueScheduler::ThreadPool);
+  }
+
+  TEST_METHOD(DefaultExecutorWorkStealing_GrowingDequeKeepsTasks)
+  {
+    Mso::UnitTest_UninitConcurrentQueue();
+    Mso::SetConcurrentQueueScheduler(Mso::ConcurrentQueueScheduler::WorkStealing);
+
+    // The suspended queue keeps the tasks in the worker deque while it grows several times.
+    constexpr int TaskCount{1000};
+    std::vector<std::atomic<int>> invokeCounts(TaskCount);
+    std::atomic<int> remaining{TaskCount};
+    Mso::ManualResetEvent finished;
+    std::optional<Mso::DispatchSuspendGuard> suspendGuard;
+    auto queue = Mso::DispatchQueue::ConcurrentQueue();
+    Mso::FutureWait(Mso::PostFuture(queue, [&]() noexcept {
+      suspendGuard.emplace(queue.Suspend());
+      for (int i = 0; i < TaskCount; ++i)
+      {
+        queue.Post([&invokeCounts, &remaining, &finished, i]() noexcept {
+          ++invokeCounts[i];
+          if (--remaining == 0)
+          {
+            finished.Set();
+          }
+        });
+      }
+    }));
+
+    suspendGuard.reset();
+    finished.Wait();
+    for (auto& invokeCount : invokeCounts)
+    {
+      TestCheckEqual(1, invokeCount.load());
+    }
+
+    Mso::UnitTest_UninitConcurrentQueue();
+    Mso::SetConcurrentQueueScheduler(Mso::ConcurrentQueueScheduler::ThreadPool);
+  }
+
+  TEST_METHOD(DefaultExecutorWorkStealing_ShutdownCancelsWorkerTasks)
+  {
+    Mso::UnitTest_UninitConcurrentQueue();
+    Mso::SetConcurrentQueueScheduler(Mso::ConcurrentQueueScheduler::WorkStealing);
+
+    // The suspended queue keeps the tasks in the worker deque until the Shutdown steals and cancels them.
+    constexpr int TaskCount{1000};
+    std::atomic<int> invokeCount{0};
+    std::atomic<int> cancelCount{0};
+    std::optional<Mso::DispatchSuspendGuard> suspendGuard;
+    auto queue = Mso::DispatchQueue::ConcurrentQueue();
+    Mso::FutureWait(Mso::PostFuture(queue, [&]() noexcept {
+      suspendGuard.emplace(queue.Suspend());
+      for (int i = 0; i < TaskCount; ++i)
+      {
+        queue.Post(Mso::MakeDispatchTask(
+            [&invokeCount]() noexcept { ++invokeCount; }, [&cancelCount]() noexcept { ++cancelCount; }));
+      }
+    }));
+
+    queue.Shutdown(Mso::PendingTaskAction::Cancel);
+    suspendGuard.reset();
+    Mso::UnitTest_UninitConcurrentQueue();
+    TestCheckEqual(0, invokeCount.load());
+    TestCheckEqual(TaskCount, cancelCount.load());
+
+    Mso::SetConcurrentQueueScheduler(Mso::ConcurrentQueueScheduler::ThreadPool);
+  }
+
+  TEST_METHOD(DefaultExecutorWorkStealing_ShutdownRacesWithWorkerPop)
+  {
+    // The Shutdown steals the last tasks from the worker deque while the worker pops them.
+    // Each task must be either invoked or canceled exactly once.
+    for (int iteration = 0; iteration < 200; ++iteration)
+    {
+      Mso::UnitTest_UninitConcurrentQueue();
+      Mso::SetConcurrentQueueScheduler(Mso::ConcurrentQueueScheduler::WorkStealing);
+
+      const int taskCount = iteration % 4 + 1;
+      std::atomic<int> invokeCount{0};
+      std::atomic<int> cancelCount{0};
+      Mso::ManualResetEvent posted;
+      auto queue = Mso::DispatchQueue::ConcurrentQueue();
+      queue.Post([&queue, &invokeCount, &cancelCount, &posted, taskCount]() noexcept {
+        for (int i = 0; i < taskCount; ++i)
+        {
+          queue.Post(Mso::MakeDispatchTask(
+              [&invokeCount]() noexcept { ++invokeCount; }, [&cancelCount]() noexcept { ++cancelCount; }));
+        }
+
+        posted.Set();
+      });
+
+      posted.Wait();
+      queue.Shutdown(Mso::PendingTaskAction::Cancel);
+      Mso::UnitTest_UninitConcurrentQueue();
+      TestCheckEqual(taskCount, invokeCount.load() + cancelCount.load());
+    }
+
+    Mso::SetConcurrentQueueScheduler(Mso::ConcurrentQueueScheduler::ThreadPool);
+  }
+
+  TEST_METHOD(DefaultExecutorWorkStealing_SelfRepostingTasksDoNotStarveExternalPosts)
+  {
+    Mso::UnitTest_UninitConcurrentQueue();
+    Mso::SetConcurrentQueueScheduler(Mso::ConcurrentQueueScheduler::WorkStealing);
+
+    // Each worker runs a chain of tasks that repost themselves into the worker deque.
+    // The workers must still take the task posted from the test thread from the injection queue.
+    struct RepostingChains
+    {
+      void PostTask(bool isFirst) noexcept
+      {
+        Queue.Post([this, isFirst]() noexcept {
+          if (isFirst && ++StartedCount == Count)
+          {
+            Started.Set();
+          }
+
+          if (IsStopped.load())
+          {
+            if (++StoppedCount == Count)
+            {
+              Stopped.Set();
+            }
+
+            return;
+          }
+
+          PostTask(/*isFirst:*/ false);
+        });
+      }
+
+      Mso::DispatchQueue Queue{Mso::DispatchQueue::ConcurrentQueue()};
+      const uint32_t Count{std::max(std::thread::hardware_concurrency(), 1u)};
+      std::atomic<uint32_t> StartedCount{0};
+      std::atomic<uint32_t> StoppedCount{0};
+      std::atomic<bool> IsStopped{false};
+      Mso::ManualResetEvent Started;
+      Mso::ManualResetEvent Stopped;
+    } chains;
+
+    for (uint32_t i = 0; i < chains.Count; ++i)
+    {
+      chains.PostTask(/*isFirst:*/ true);
+    }
+
+    TestCheck(chains.Started.WaitFor(std::chrono::seconds{10}));
+
+    Mso::ManualResetEvent externalTaskInvoked;
+    chains.Queue.Post([&externalTaskInvoked]() noexcept { externalTaskInvoked.Set(); });
+    bool isInvoked = externalTaskInvoked.WaitFor(std::chrono::seconds{10});
+    chains.IsStopped = true;
+    chains.Stopped.Wait();
+    TestCheck(isInvoked);
+
+    Mso::UnitTest_UninitConcurrentQueue();
+    Mso::SetConcurrentQueueScheduler(Mso::ConcurrentQueueScheduler::ThreadPool);
+  }
+
+  TEST_METHOD(DispatchQueuePost_ManyProducersAndConsumers)
+  {
+    // The task queue blocks have 63 slots. The producers cross the block boundaries many times while the consumers
+    // race for the slots and hand the block destruction to each other.
+    constexpr uint32_t ProducerCount{4};
+    constexpr uint32_t ConsumerCount{4};
+    constexpr uint32_t TasksPerProducer{20000};
+    auto scheduler = Mso::Make<ExternalThreadScheduler>();
+    auto queue = Mso::DispatchQueue::MakeCustomQueue(Mso::CntPtr<Mso::IDispatchQueueScheduler>{scheduler});
+
+    // Each consumer logs ids of the invoked tasks: the producer index in the high bits and the task index in the low.
+    static thread_local std::vector<uint64_t>* t_invokeLog{nullptr};
+    std::vector<std::vector<uint64_t>> invokeLogs(ConsumerCount);
+    std::atomic<uint32_t> remaining{ProducerCount * TasksPerProducer};
+    std::vector<std::thread> threads;
+    for (uint32_t consumer = 0; consumer < ConsumerCount; ++consumer)
+    {
+      threads.emplace_back([&scheduler, &invokeLogs, &remaining, consumer]() noexcept {
+        t_invokeLog = &invokeLogs[consumer];
+        auto queueService = scheduler->Queue.GetStrongPtr();
+        Mso::DispatchTask task;
+        while (remaining.load() != 0)
+        {
+          if (queueService->TryDequeTask(/*out*/ task))
+          {
+            queueService->InvokeTask(std::move(task), std::nullopt);
+            --remaining;
+          }
+          else
+          {
+            std::this_thread::yield();
+          }
+        }
+      });
+    }
+
+    for (uint32_t producer = 0; producer < ProducerCount; ++producer)
+    {
+      threads.emplace_back([&queue, producer]() noexcept {
+        for (uint32_t i = 0; i < TasksPerProducer; ++i)
+        {
+          queue.Post([taskId = (uint64_t{producer} << 32) | i]() noexcept { t_invokeLog->push_back(taskId); });
+        }
+      });
+    }
+
+    for (auto& thread : threads)
+    {
+      thread.join();
+    }
+
+    // Each consumer sees the tasks of a producer in the posting order. All tasks are invoked exactly once.
+    std::vector<uint32_t> invokeCounts(ProducerCount * TasksPerProducer);
+    for (const auto& invokeLog : invokeLogs)
+    {
+      std::array<int64_t, ProducerCount> lastTaskIndex;
+      lastTaskIndex.fill(-1);
+      for (uint64_t taskId : invokeLog)
+      {
+        uint32_t producer = static_cast<uint32_t>(taskId >> 32);
+        uint32_t taskIndex = static_cast<uint32_t>(taskId);
+        TestCheck(lastTaskIndex[producer] < taskIndex);
+        lastTaskIndex[producer] = taskIndex;
+        ++invokeCounts[producer * TasksPerProducer + taskIndex];
+      }
+    }
+
+    TestCheck(
+        std::all_of(invokeCounts.begin(), invokeCounts.end(), [](uint32_t count) noexcept { return count == 1; }));
+  }
+
+  TEST_METHOD(DispatchQueuePostAfter)
+  {
+    auto queue = Mso::DispatchQueue::MakeSerialQueue();
+    auto startTime = std::chrono::steady_clock::now();
+    Mso::Promise<std::chrono::steady_clock::time_point> promise;
+    queue.PostAfter(std::chrono::milliseconds{20}, [promise]() noexcept {
+      promise.SetValue(std::chrono::steady_clock::now());
+    });
+
+    TestCheck(Mso::FutureWaitAndGetValue(promise.AsFuture()) - startTime >= std::chrono::milliseconds{20});
+  }
+
+  TEST_METHOD(DispatchQueuePostAtCanceledOnShutdown)
+  {
+    auto queue = Mso::DispatchQueue::MakeSerialQueue();
+    Mso::Promise<bool> promise;
+    queue.PostAt(
+        std::chrono::steady_clock::now() + std::chrono::hours{1},
+        Mso::MakeDispatchTask(
+            [promise]() noexcept { promise.SetValue(true); }, [promise]() noexcept { promise.SetValue(false); }));
+
+    queue.Shutdown(Mso::PendingTaskAction::Complete);
+    TestCheck(!Mso::FutureWaitAndGetValue(promise.AsFuture()));
+  }
+
+  TEST_METHOD(DispatchQueuePostPeriodic)
+  {
+    auto queue = Mso::DispatchQueue::MakeSerialQueue();
+    std::atomic<int> invokeCount{0};
+    Mso::Promise<void> invoked;
+    Mso::Promise<void> canceled;
+    auto timer = queue.PostPeriodic(
+        std::chrono::milliseconds{1},
+        Mso::MakeDispatchTask(
+            [&invokeCount, invoked]() noexcept {
+              if (++invokeCount == 3)
+              {
+                invoked.SetValue();
+              }
+            },
+            [canceled]() noexcept { canceled.SetValue(); }));
+
+    Mso::FutureWait(invoked.AsFuture());
+    timer.Cancel();
+    Mso::FutureWait(canceled.AsFuture());
+    TestCheck(invokeCount.load() >= 3);
+  }
+
+  TEST_METHOD(DispatchQueuePostPeriodic_AssignmentCancelsTimer)
+  {
+    auto queue = Mso::DispatchQueue::MakeSerialQueue();
+    Mso::Promise<void> invoked;
+    Mso::Promise<void> canceled;
+    auto timer = queue.PostPeriodic(
+        std::chrono::milliseconds{1},
+        Mso::MakeDispatchTask(
+            [invoked]() noexcept { invoked.TrySetValue(); }, [canceled]() noexcept { canceled.SetValue(); }));
+
+    Mso::FutureWait(invoked.AsFuture());
+    timer = queue.PostPeriodic(std::chrono::hours{1}, []() noexcept {});
+    Mso::FutureWait(canceled.AsFuture());
+    TestCheck(static_cast<bool>(timer));
+
+    timer = nullptr;
+    TestCheck(!timer);
+  }
+
+  TEST_METHOD(DispatchQueuePostRange_Serial)
+  {
+    auto queue = Mso::DispatchQueue::MakeSerialQueue();
+    std::vector<int> invokeOrder;
+    Mso::Promise<void> invoked;
+    std::vector<Mso::DispatchTask> tasks;
+    for (int i = 0; i < 100; ++i)
+    {
+      tasks.emplace_back([&invokeOrder, invoked, i]() noexcept {
+        invokeOrder.push_back(i);
+        if (i == 99)
+        {
+          invoked.SetValue();
+        }
+      });
+    }
+
+    queue.PostRange(Mso::Span<Mso::DispatchTask>{tasks.data(), tasks.size()});
+    TestCheck(!tasks[0]);
+    Mso::FutureWait(invoked.AsFuture());
+    TestCheckEqual(100u, invokeOrder.size());
+    for (int i = 0; i < 100; ++i)
+    {
+      TestCheckEqual(i, invokeOrder[i]);
+    }
+  }
+
+  TEST_METHOD(DispatchQueuePostRange_Concurrent)
+  {
+    auto queue = Mso::DispatchQueue::MakeConcurrentQueue(/*maxThreads:*/ 4);
+    std::atomic<int> invokeCount{0};
+    Mso::Promise<void> invoked;
+    std::vector<Mso::DispatchTask> tasks;
+    for (int i = 0; i < 1000; ++i)
+    {
+      tasks.emplace_back([&invokeCount, invoked]() noexcept {
+        if (++invokeCount == 1000)
+        {
+          invoked.SetValue();
+        }
+      });
+    }
+
+    queue.PostRange(Mso::Span<Mso::DispatchTask>{tasks.data(), tasks.size()});
+    Mso::FutureWait(invoked.AsFuture());
+    TestCheckEqual(1000, invokeCount.load());
+  }
+
+  TEST_METHOD(DispatchQueuePostRange_CanceledAfterShutdown)
+  {
+    auto queue = Mso::DispatchQueue::MakeSerialQueue();
+    queue.Shutdown(Mso::PendingTaskAction::Complete);
+
+    std::atomic<int> invokeCount{0};
+    std::atomic<int> cancelCount{0};
+    std::vector<Mso::DispatchTask> tasks;
+    for (int i = 0; i < 10; ++i)
+    {
+      tasks.emplace_back(Mso::MakeDispatchTask(
+          [&invokeCount]() noexcept { ++invokeCount; }, [&cancelCount]() noexcept { ++cancelCount; }));
+    }
+
+    queue.PostRange(Mso::Span<Mso::DispatchTask>{tasks.data(), tasks.size()});
+    TestCheckEqual(0, invokeCount.load());
+    TestCheckEqual(10, cancelCount.load());
+  }
+
+  TEST_METHOD(DispatchQueuePostRange_TaskBatching)
+  {
+    auto queue = Mso::DispatchQueue::MakeSerialQueue();
+    std::atomic<int> invokeCount{0};
+    Mso::Promise<void> invoked;
+    std::vector<Mso::DispatchTask> tasks;
+    for (int i = 0; i < 10; ++i)
+    {
+      tasks.emplace_back([&invokeCount]() noexcept { ++invokeCount; });
+    }
+
+    Mso::IDispatchQueueService* queueService = *Mso::GetRawState(queue);
+    queueService->BeginTaskBatching();
+    queue.PostRange(Mso::Span<Mso::DispatchTask>{tasks.data(), tasks.size()});
+    queue.Post([invoked]() noexcept { invoked.SetValue(); });
+    TestCheckEqual(0, invokeCount.load());
+    queue.Post(queueService->EndTaskBatching());
+
+    Mso::FutureWait(invoked.AsFuture());
+    TestCheckEqual(10, invokeCount.load());
+  }
+
+  TEST_METHOD(DispatchQueueTaskBatching_Nested)
+  {
+    auto queue = Mso::DispatchQueue::MakeSerialQueue();
+    std::vector<int> invokeOrder;
+    Mso::Promise<void> invoked;
+    Mso::IDispatchQueueService* queueService = *Mso::GetRawState(queue);
+    TestCheck(!queueService->HasTaskBatching());
+
+    queueService->BeginTaskBatching();
+    queue.Post([&invokeOrder]() noexcept { invokeOrder.push_back(1); });
+    queueService->BeginTaskBatching();
+    queue.Post([&invokeOrder]() noexcept { invokeOrder.push_back(2); });
+    queue.Post(queueService->EndTaskBatching());
+    TestCheck(queueService->HasTaskBatching());
+    queue.Post([&invokeOrder, invoked]() noexcept {
+      invokeOrder.push_back(3);
+      invoked.SetValue();
+    });
+    TestCheck(invokeOrder.empty());
+    queue.Post(queueService->EndTaskBatching());
+    TestCheck(!queueService->HasTaskBatching());
+
+    Mso::FutureWait(invoked.AsFuture());
+    TestCheckEqual(3u, invokeOrder.size());
+    TestCheckEqual(1, invokeOrder[0]);
+    TestCheckEqual(2, invokeOrder[1]);
+    TestCheckEqual(3, invokeOrder[2]);
+  }
+
+  TEST_METHOD(DispatchQueueTaskBatching_OtherThreadNotBatched)
+  {
+    auto queue = Mso::DispatchQueue::MakeSerialQueue();
+    Mso::IDispatchQueueService* queueService = *Mso::GetRawState(queue);
+    queueService->BeginTaskBatching();
+
+    // The task posted from another thread is not added to the current thread batch.
+    Mso::Promise<void> invoked;
+    auto future = Mso::PostFuture([queue, invoked]() noexcept {
+      queue.Post([invoked]() noexcept { invoked.SetValue(); });
+    });
+    Mso::FutureWait(future);
+    Mso::FutureWait(invoked.AsFuture());
+
+    queue.Post(queueService->EndTaskBatching());
+  }
+
+  TEST_METHOD(DispatchQueuePostRange_SinglePostToScheduler)
+  {
+    auto scheduler = Mso::Make<PostCountingScheduler>();
+    auto queue = Mso::DispatchQueue::MakeCustomQueue(Mso::CntPtr<Mso::IDispatchQueueScheduler>{scheduler});
+    std::vector<Mso::DispatchTask> tasks;
+    for (int i = 0; i < 100; ++i)
+    {
+      tasks.emplace_back([]() noexcept {});
+    }
+
+    queue.PostRange(Mso::Span<Mso::DispatchTask>{tasks.data(), tasks.size()});
+    TestCheckEqual(1u, scheduler->PostCallCount);
+    TestCheckEqual(100u, scheduler->PostedTaskCount);
+    TestCheckEqual(100u, scheduler->InvokeAllTasks());
+  }
+
+  TEST_METHOD(DispatchQueueResume_SinglePostToScheduler)
+  {
+    auto scheduler = Mso::Make<PostCountingScheduler>();
+    auto queue = Mso::DispatchQueue::MakeCustomQueue(Mso::CntPtr<Mso::IDispatchQueueScheduler>{scheduler});
+    auto queueService = scheduler->Queue.GetStrongPtr();
+    queueService->Suspend();
+    for (int i = 0; i < 100; ++i)
+    {
+      queue.Post([]() noexcept {});
+    }
+
+    TestCheckEqual(0u, scheduler->PostCallCount);
+    queueService->Resume();
+    TestCheckEqual(1u, scheduler->PostCallCount);
+    TestCheckEqual(100u, scheduler->PostedTaskCount);
+    TestCheckEqual(100u, scheduler->InvokeAllTasks());
+  }
+
+  TEST_METHOD(DispatchQueuePostWithPriority_HigherPriorityFirst)
+  {
+    auto scheduler = Mso::Make<PostCountingScheduler>();
+    auto queue = Mso::DispatchQueue::MakeCustomQueue(Mso::CntPtr<Mso::IDispatchQueueScheduler>{scheduler});
+    std::vector<int> invokeOrder;
+    for (int i = 0; i < 3; ++i)
+    {
+      queue.Post([&invokeOrder, i]() noexcept { invokeOrder.push_back(i); });
+      queue.Post([&invokeOrder, i]() noexcept { invokeOrder.push_back(10 + i); }, Mso::DispatchPriority::Low);
+      queue.Post([&invokeOrder, i]() noexcept { invokeOrder.push_back(20 + i); }, Mso::DispatchPriority::High);
+    }
+
+    TestCheckEqual(9u, scheduler->PostedTaskCount);
+    TestCheckEqual(9u, scheduler->InvokeAllTasks());
+    TestCheck((invokeOrder == std::vector<int>{20, 21, 22, 0, 1, 2, 10, 11, 12}));
+  }
+
+  TEST_METHOD(DispatchQueuePostWithPriority_LowPriorityNotStarved)
+  {
+    auto scheduler = Mso::Make<PostCountingScheduler>();
+    auto queue = Mso::DispatchQueue::MakeCustomQueue(Mso::CntPtr<Mso::IDispatchQueueScheduler>{scheduler});
+    std::vector<int> invokeOrder;
+    queue.Post([&invokeOrder]() noexcept { invokeOrder.push_back(-1); }, Mso::DispatchPriority::Low);
+    for (int i = 0; i < 100; ++i)
+    {
+      queue.Post([&invokeOrder, i]() noexcept { invokeOrder.push_back(i); }, Mso::DispatchPriority::High);
+    }
+
+    TestCheckEqual(101u, scheduler->InvokeAllTasks());
+    auto lowIndex = std::find(invokeOrder.begin(), invokeOrder.end(), -1) - invokeOrder.begin();
+    TestCheck(lowIndex > 0);
+    TestCheck(lowIndex < 100);
+  }
+
+  TEST_METHOD(DispatchQueuePostWithPriority_SerialQueueInvokesOneAtATime)
+  {
+    auto queue = Mso::DispatchQueue::MakeSerialQueue();
+    Mso::IDispatchQueueService* queueService = *Mso::GetRawState(queue);
+    std::atomic<int> runningCount{0};
+    std::atomic<bool> isOverlapped{false};
+    std::vector<int> invokeOrder;
+    Mso::Promise<void> invoked;
+    auto makeTask = [&](int id) {
+      return [&, id]() noexcept {
+        isOverlapped = isOverlapped || (++runningCount > 1);
+        invokeOrder.push_back(id);
+        std::this_thread::yield();
+        --runningCount;
+        if (invokeOrder.size() == 21)
+        {
+          invoked.SetValue();
+        }
+      };
+    };
+
+    queueService->Suspend();
+    queue.Post(makeTask(0), Mso::DispatchPriority::Low);
+    for (int i = 1; i <= 10; ++i)
+    {
+      queue.Post(makeTask(i));
+      queue.Post(makeTask(100 + i), Mso::DispatchPriority::High);
+    }
+
+    queueService->Resume();
+    Mso::FutureWait(invoked.AsFuture());
+    TestCheck(!isOverlapped);
+    TestCheckEqual(21u, invokeOrder.size());
+    TestCheckEqual(101, invokeOrder[0]);
+  }
+
+  TEST_METHOD(DispatchQueuePostWithPriority_CanceledAfterShutdown)
+  {
+    auto queue = Mso::DispatchQueue::MakeSerialQueue();
+    queue.Shutdown(Mso::PendingTaskAction::Complete);
+
+    std::atomic<int> cancelCount{0};
+    queue.Post(
+        Mso::MakeDispatchTask([]() noexcept {}, [&cancelCount]() noexcept { ++cancelCount; }),
+        Mso::DispatchPriority::High);
+    TestCheckEqual(1, cancelCount.load());
+  }
+
+  TEST_METHOD(DispatchPartitionedQueue_SameKeyInOrder)
+  {
+    constexpr uint64_t keyCount{8};
+    constexpr int taskCount{1000};
+    auto queue = Mso::DispatchQueue::MakePartitionedQueue(/*maxThreads:*/ 4);
+    std::array<std::vector<int>, keyCount> invokeOrders;
+    std::array<std::atomic<int>, keyCount> runningCounts{};
+    std::atomic<bool> isOverlapped{false};
+    std::atomic<uint64_t> invokeCount{0};
+    Mso::ManualResetEvent invoked;
+    for (int i = 0; i < taskCount; ++i)
+    {
+      for (uint64_t key = 0; key < keyCount; ++key)
+      {
+        queue.Post(key, [&, key, i]() noexcept {
+          isOverlapped = isOverlapped || (++runningCounts[key] > 1);
+          invokeOrders[key].push_back(i);
+          --runningCounts[key];
+          if (++invokeCount == keyCount * taskCount)
+          {
+            invoked.Set();
+          }
+        });
+      }
+    }
+
+    invoked.Wait();
+    TestCheck(!isOverlapped);
+    for (auto& invokeOrder : invokeOrders)
+    {
+      TestCheckEqual(static_cast<size_t>(taskCount), invokeOrder.size());
+      for (int i = 0; i < taskCount; ++i)
+      {
+        TestCheckEqual(i, invokeOrder[i]);
+      }
+    }
+  }
+
+  TEST_METHOD(DispatchPartitionedQueue_DifferentKeysRunConcurrently)
+  {
+    auto queue = Mso::DispatchQueue::MakePartitionedQueue(/*maxThreads:*/ 2);
+    Mso::ManualResetEvent firstStarted;
+    Mso::ManualResetEvent secondFinished;
+    Mso::ManualResetEvent firstFinished;
+    queue.Post(1, [firstStarted, secondFinished, firstFinished]() noexcept {
+      firstStarted.Set();
+      secondFinished.Wait();
+      firstFinished.Set();
+    });
+
+    // The second key task must not wait for the first key task that blocks until the second one completes.
+    firstStarted.Wait();
+    queue.Post(2, [secondFinished]() noexcept { secondFinished.Set(); });
+    firstFinished.Wait();
+  }
+
+  TEST_METHOD(DispatchPartitionedQueue_CanceledAfterShutdown)
+  {
+    auto queue = Mso::DispatchQueue::MakePartitionedQueue(/*maxThreads:*/ 2);
+    queue.Shutdown(Mso::PendingTaskAction::Complete);
+
+    std::atomic<int> invokeCount{0};
+    std::atomic<int> cancelCount{0};
+    queue.Post(
+        1,
+        Mso::MakeDispatchTask(
+            [&invokeCount]() noexcept { ++invokeCount; }, [&cancelCount]() noexcept { ++cancelCount; }));
+    queue.AwaitTermination();
+    TestCheckEqual(0, invokeCount.load());
+    TestCheckEqual(1, cancelCount.load());
+  }
+
+  TEST_METHOD(DispatchQueueTryPost_FailsWhenFull)
+  {
+    auto scheduler = Mso::Make<PostCountingScheduler>();
+    auto queue = Mso::DispatchQueue::MakeCustomQueue(Mso::CntPtr<Mso::IDispatchQueueScheduler>{scheduler});
+    queue.SetCapacity(2);
+    Mso::DispatchTask task1{[]() noexcept {}};
+    Mso::DispatchTask task2{[]() noexcept {}};
+    Mso::DispatchTask task3{[]() noexcept {}};
+    TestCheck(queue.TryPost(std::move(task1)));
+    TestCheck(queue.TryPost(std::move(task2)));
+    TestCheck(!queue.TryPost(std::move(task3)));
+    TestCheck(!!task3); // The task is not moved out on failure.
+    TestCheckEqual(2u, queue.GetHighWaterMark());
+
+    TestCheckEqual(2u, scheduler->InvokeAllTasks());
+    TestCheck(queue.TryPost(std::move(task3)));
+    TestCheckEqual(1u, scheduler->InvokeAllTasks());
+    TestCheckEqual(2u, queue.GetHighWaterMark());
+  }
+
+  TEST_METHOD(DispatchQueueTryPost_UnboundedAlwaysPosts)
+  {
+    auto scheduler = Mso::Make<PostCountingScheduler>();
+    auto queue = Mso::DispatchQueue::MakeCustomQueue(Mso::CntPtr<Mso::IDispatchQueueScheduler>{scheduler});
+    for (int i = 0; i < 100; ++i)
+    {
+      TestCheck(queue.TryPost([]() noexcept {}));
+    }
+
+    TestCheckEqual(100u, queue.GetHighWaterMark());
+    TestCheckEqual(100u, scheduler->InvokeAllTasks());
+  }
+
+  TEST_METHOD(DispatchQueuePostWhenSpace_PostedAfterDequeue)
+  {
+    auto scheduler = Mso::Make<PostCountingScheduler>();
+    auto queue = Mso::DispatchQueue::MakeCustomQueue(Mso::CntPtr<Mso::IDispatchQueueScheduler>{scheduler});
+    queue.SetCapacity(1);
+    std::vector<int> invokeOrder;
+    TestCheck(queue.TryPost([&invokeOrder]() noexcept { invokeOrder.push_back(1); }));
+    auto posted = Mso::PostWhenSpace(queue, [&invokeOrder]() noexcept { invokeOrder.push_back(2); });
+    TestCheck(!Mso::GetIFuture(posted)->IsDone());
+
+    // The waiting task goes first even if the queue has space.
+    Mso::DispatchTask task3{[&invokeOrder]() noexcept { invokeOrder.push_back(3); }};
+    TestCheck(!queue.TryPost(std::move(task3)));
+
+    // The onPosted callback completes the future in the concurrent queue.
+    TestCheckEqual(2u, scheduler->InvokeAllTasks());
+    Mso::FutureWait(posted);
+    TestCheck(Mso::GetIFuture(posted)->IsSucceeded());
+    TestCheck(queue.TryPost(std::move(task3)));
+    TestCheckEqual(1u, scheduler->InvokeAllTasks());
+    TestCheck((invokeOrder == std::vector<int>{1, 2, 3}));
+  }
+
+  TEST_METHOD(DispatchQueuePostWhenSpace_OnPostedInvokedOutsideOfDequeue)
+  {
+    auto scheduler = Mso::Make<PostCountingScheduler>();
+    auto queue = Mso::DispatchQueue::MakeCustomQueue(Mso::CntPtr<Mso::IDispatchQueueScheduler>{scheduler});
+    queue.SetCapacity(1);
+    TestCheck(queue.TryPost([]() noexcept {}));
+    std::thread::id onPostedThreadId;
+    Mso::ManualResetEvent onPostedInvoked;
+    queue.PostWhenSpace([]() noexcept {}, [&onPostedThreadId, &onPostedInvoked]() noexcept {
+      onPostedThreadId = std::this_thread::get_id();
+      onPostedInvoked.Set();
+    });
+
+    // The TryDequeTask posts the waiting task, and the concurrent queue invokes its onPosted callback.
+    TestCheckEqual(2u, scheduler->InvokeAllTasks());
+    onPostedInvoked.Wait();
+    TestCheck(onPostedThreadId != std::this_thread::get_id());
+  }
+
+  TEST_METHOD(DispatchQueuePostWhenSpace_CanceledOnShutdown)
+  {
+    auto scheduler = Mso::Make<PostCountingScheduler>();
+    auto queue = Mso::DispatchQueue::MakeCustomQueue(Mso::CntPtr<Mso::IDispatchQueueScheduler>{scheduler});
+    queue.SetCapacity(1);
+    std::atomic<int> cancelCount{0};
+    TestCheck(queue.TryPost([]() noexcept {}));
+    auto posted = Mso::PostWhenSpace(
+        queue, Mso::MakeDispatchTask([]() noexcept {}, [&cancelCount]() noexcept { ++cancelCount; }));
+
+    queue.Shutdown(Mso::PendingTaskAction::Cancel);
+    TestCheckEqual(1, cancelCount.load());
+    TestCheck(Mso::GetIFuture(posted)->IsFailed());
+  }
+
+  TEST_METHOD(DispatchQueuePostWhenSpace_ProducerKeepsQueueBounded)
+  {
+    constexpr int taskCount{1000};
+    auto queue = Mso::DispatchQueue::MakeSerialQueue();
+    queue.SetCapacity(4);
+    std::vector<int> invokeOrder;
+    Mso::ManualResetEvent invoked;
+    for (int i = 0; i < taskCount; ++i)
+    {
+      Mso::FutureWait(Mso::PostWhenSpace(queue, [&invokeOrder, invoked, i]() noexcept {
+        invokeOrder.push_back(i);
+        if (i == taskCount - 1)
+        {
+          invoked.Set();
+        }
+      }));
+    }
+
+    invoked.Wait();
+    TestCheck(queue.GetHighWaterMark() <= 4);
+    TestCheckEqual(static_cast<size_t>(taskCount), invokeOrder.size());
+    for (int i = 0; i < taskCount; ++i)
+    {
+      TestCheckEqual(i, invokeOrder[i]);
+    }
+  }
+
+  TEST_METHOD(DispatchQueueMetrics_CountsTasks)
+  {
+    auto scheduler = Mso::Make<PostCountingScheduler>();
+    auto queue = Mso::DispatchQueue::MakeCustomQueue(Mso::CntPtr<Mso::IDispatchQueueScheduler>{scheduler});
+    queue.Post([]() noexcept {}); // Not counted before metrics are enabled.
+    queue.EnableMetrics();
+
+    int invokeCount{0};
+    queue.Post([&invokeCount, queue]() noexcept {
+      ++invokeCount;
+      queue.DeferElsePost([&invokeCount]() noexcept { ++invokeCount; });
+    });
+    queue.Post([&invokeCount]() noexcept { ++invokeCount; });
+
+    Mso::IDispatchQueueService* queueService = *Mso::GetRawState(queue);
+    queueService->BeginTaskBatching();
+    queue.Post([&invokeCount]() noexcept { ++invokeCount; });
+    queue.Post([&invokeCount]() noexcept { ++invokeCount; });
+    queue.Post(queueService->EndTaskBatching());
+
+    Mso::DispatchQueueMetrics metrics = queue.GetMetrics();
+    TestCheckEqual(3u, metrics.EnqueueCount);
+    TestCheckEqual(0u, metrics.DequeueCount);
+    TestCheckEqual(4u, metrics.Depth);
+    TestCheckEqual(4u, metrics.PeakDepth);
+    TestCheckEqual(2u, metrics.BatchedCount);
+
+    TestCheckEqual(4u, scheduler->InvokeAllTasks());
+    TestCheckEqual(5, invokeCount);
+    metrics = queue.GetMetrics();
+    TestCheckEqual(4u, metrics.DequeueCount);
+    TestCheckEqual(0u, metrics.Depth);
+    TestCheckEqual(1u, metrics.DeferredCount);
+
+    // The task posted before EnableMetrics has no enqueue time. Other tasks are invoked after their wait.
+    uint64_t waitCount{0};
+    uint64_t executionCount{0};
+    for (size_t i = 0; i < Mso::DispatchQueueHistogramBucketCount; ++i)
+    {
+      waitCount += metrics.WaitTimeHistogram[i];
+      executionCount += metrics.ExecutionTimeHistogram[i];
+    }
+
+    TestCheckEqual(3u, waitCount);
+    TestCheckEqual(4u, executionCount);
+  }
+
+  TEST_METHOD(DispatchQueueMetrics_CountsPostsOverCapacity)
+  {
+    auto scheduler = Mso::Make<PostCountingScheduler>();
+    auto queue = Mso::DispatchQueue::MakeCustomQueue(Mso::CntPtr<Mso::IDispatchQueueScheduler>{scheduler});
+    queue.EnableMetrics();
+    queue.SetCapacity(2);
+    TestCheck(queue.TryPost([]() noexcept {}));
+    queue.Post([]() noexcept {});
+    TestCheckEqual(0u, queue.GetMetrics().OverCapacityCount);
+
+    // Post ignores the capacity, but the metrics count the tasks above it.
+    queue.Post([]() noexcept {});
+    std::vector<Mso::DispatchTask> tasks;
+    tasks.emplace_back([]() noexcept {});
+    tasks.emplace_back([]() noexcept {});
+    queue.PostRange(Mso::Span<Mso::DispatchTask>{tasks.data(), tasks.size()});
+    TestCheckEqual(3u, queue.GetMetrics().OverCapacityCount);
+    TestCheckEqual(5u, scheduler->InvokeAllTasks());
+  }
+
+  TEST_METHOD(DispatchQueueMetrics_DisabledByDefault)
+  {
+    auto scheduler = Mso::Make<PostCountingScheduler>();
+    auto queue = Mso::DispatchQueue::MakeCustomQueue(Mso::CntPtr<Mso::IDispatchQueueScheduler>{scheduler});
+    queue.Post([]() noexcept {});
+    TestCheckEqual(1u, scheduler->InvokeAllTasks());
+
+    Mso::DispatchQueueMetrics metrics = queue.GetMetrics();
+    TestCheckEqual(0u, metrics.EnqueueCount);
+    TestCheckEqual(0u, metrics.DequeueCount);
+    TestCheckEqual(1u, metrics.PeakDepth);
+  }
+
+  TEST_METHOD(DispatchQueueMetrics_ConcurrentPosts)
+  {
+    static constexpr uint64_t threadCount{4};
+    static constexpr uint64_t taskCount{1000};
+    auto queue = Mso::DispatchQueue::MakeConcurrentQueue(/*maxThreads:*/ 4);
+    queue.EnableMetrics();
+    std::atomic<uint64_t> invokeCount{0};
+    Mso::ManualResetEvent invoked;
+    std::vector<std::thread> threads;
+    for (uint64_t t = 0; t < threadCount; ++t)
+    {
+      threads.emplace_back([&]() noexcept {
+        for (uint64_t i = 0; i < taskCount; ++i)
+        {
+          queue.Post([&invokeCount, invoked]() noexcept {
+            if (++invokeCount == threadCount * taskCount)
+            {
+              invoked.Set();
+            }
+          });
+        }
+      });
+    }
+
+    for (auto& thread : threads)
+    {
+      thread.join();
+    }
+
+    invoked.Wait();
+    queue.AwaitTermination();
+    Mso::DispatchQueueMetrics metrics = queue.GetMetrics();
+    TestCheckEqual(threadCount * taskCount, metrics.EnqueueCount);
+    TestCheckEqual(threadCount * taskCount, metrics.DequeueCount);
+  }
+
+  TEST_METHOD(DispatchTracing_RecordsTaskFlows)
+  {
+    auto scheduler = Mso::Make<PostCountingScheduler>();
+    auto queue = Mso::DispatchQueue::MakeCustomQueue(Mso::CntPtr<Mso::IDispatchQueueScheduler>{scheduler});
+    queue.Post([]() noexcept {}); // Not traced because it is posted before the tracing starts.
+
+    Mso::StartDispatchTracing();
+    TestCheck(Mso::IsDispatchTracingEnabled());
+    int invokeCount{0};
+    queue.Post([&invokeCount, queue]() noexcept {
+      ++invokeCount;
+      queue.DeferElsePost([&invokeCount]() noexcept { ++invokeCount; });
+    });
+    TestCheckEqual(2u, scheduler->InvokeAllTasks());
+    TestCheckEqual(2, invokeCount);
+
+    queue.Shutdown(Mso::PendingTaskAction::Cancel);
+    queue.Post([]() noexcept { TestCheckFail(); }); // Canceled without posting because the queue is shut down.
+    Mso::StopDispatchTracing();
+    TestCheck(!Mso::IsDispatchTracingEnabled());
+    queue.Post([]() noexcept {}); // Not traced because it is posted after the tracing stops.
+
+    std::string json = Mso::GetDispatchTraceJson();
+    TestCheck(json.rfind("{\"traceEvents\":[", 0) == 0);
+    TestCheckEqual(1u, CountSubstrings(json, "\"name\":\"Post\""));
+    TestCheckEqual(1u, CountSubstrings(json, "\"name\":\"Defer\""));
+    TestCheckEqual(2u, CountSubstrings(json, "\"name\":\"Dequeue\""));
+    TestCheckEqual(2u, CountSubstrings(json, "\"name\":\"Invoke\",\"cat\":\"dispatch\",\"ph\":\"B\""));
+    TestCheckEqual(2u, CountSubstrings(json, "\"name\":\"Invoke\",\"cat\":\"dispatch\",\"ph\":\"E\""));
+    TestCheckEqual(2u, CountSubstrings(json, "\"name\":\"Task\",\"cat\":\"dispatch\",\"ph\":\"B\""));
+    TestCheckEqual(1u, CountSubstrings(json, "\"name\":\"Cancel\""));
+    TestCheckEqual(2u, CountCompletedTraceFlows(json, "dispatch"));
+  }
+
+  TEST_METHOD(DispatchTracing_RecordsFutureContinuationFlows)
+  {
+    auto scheduler = Mso::Make<PostCountingScheduler>();
+    auto queue = Mso::DispatchQueue::MakeCustomQueue(Mso::CntPtr<Mso::IDispatchQueueScheduler>{scheduler});
+    Mso::StartDispatchTracing();
+    int value{0};
+    auto future = Mso::PostFuture(queue, [&value]() noexcept { value = 1; }).Then(queue, [&value]() noexcept {
+      value *= 2;
+    });
+
+    while (scheduler->InvokeAllTasks() != 0)
+    {
+    }
+
+    Mso::StopDispatchTracing();
+    TestCheckEqual(2, value);
+
+    std::string json = Mso::GetDispatchTraceJson();
+    TestCheckEqual(1u, CountSubstrings(json, "\"name\":\"FuturePost\""));
+    TestCheckEqual(2u, CountSubstrings(json, "\"name\":\"Future\",\"cat\":\"dispatch\",\"ph\":\"B\""));
+    TestCheckEqual(2u, CountSubstrings(json, "\"name\":\"Future\",\"cat\":\"dispatch\",\"ph\":\"E\""));
+    TestCheckEqual(1u, CountCompletedTraceFlows(json, "future"));
+  }
+
+  TEST_METHOD(DispatchTracing_RingBufferKeepsLastEvents)
+  {
+    static constexpr size_t eventsPerThread{4};
+    Mso::StartDispatchTracing(eventsPerThread);
+    for (uint64_t i = 0; i < 10; ++i)
+    {
+      Mso::RecordDispatchTraceEvent(Mso::DispatchTraceEventKind::Cancel, 0, nullptr);
+    }
+
+    // Events recorded by other threads do not evict the events of this thread.
+    std::thread{[]() noexcept {
+      for (uint64_t i = 0; i < 10; ++i)
+      {
+        Mso::RecordDispatchTraceEvent(Mso::DispatchTraceEventKind::Dequeue, 0, nullptr);
+      }
+    }}.join();
+
+    Mso::StopDispatchTracing();
+    std::string json = Mso::GetDispatchTraceJson();
+    TestCheckEqual(eventsPerThread, CountSubstrings(json, "\"name\":\"Cancel\""));
+    TestCheckEqual(eventsPerThread, CountSubstrings(json, "\"name\":\"Dequeue\""));
+
+    // Starting a new tracing discards the recorded events.
+    Mso::StartDispatchTracing();
+    Mso::StopDispatchTracing();
+    TestCheckEqual(std::string{"{\"traceEvents\":[],\"displayTimeUnit\":\"ns\"}"}, Mso::GetDispatchTraceJson());
+  }
+
+  TEST_METHOD(DispatchTracing_GetJsonWhileRecording)
+  {
+    static constexpr size_t eventsPerThread{64};
+    static constexpr size_t threadCount{2};
+    Mso::StartDispatchTracing(eventsPerThread);
+    std::atomic<bool> isFinished{false};
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < threadCount; ++i)
+    {
+      threads.emplace_back([&isFinished]() noexcept {
+        for (size_t j = 0; j < 10000 || !isFinished.load(); ++j)
+        {
+          Mso::RecordDispatchTraceEvent(Mso::DispatchTraceEventKind::Dequeue, 0, nullptr);
+        }
+      });
+    }
+
+    // The threads overwrite their ring buffers while they are read. The overwritten events are skipped.
+    for (int i = 0; i < 100; ++i)
+    {
+      std::string json = Mso::GetDispatchTraceJson();
+      TestCheck(json.rfind("{\"traceEvents\":[", 0) == 0);
+      TestCheck(CountSubstrings(json, "\"name\":\"Dequeue\"") <= threadCount * eventsPerThread);
+    }
+
+    isFinished.store(true);
+    for (auto& thread : threads)
+    {
+      thread.join();
+    }
+
+    Mso::StopDispatchTracing();
+    TestCheckEqual(threadCount * eventsPerThread, CountSubstrings(Mso::GetDispatchTraceJson(), "\"name\":\"Dequeue\""));
+  }
+
+  TEST_METHOD(DispatchTask_SmallLambdaIsInline)
+  {
+    int value = 0;
+    int* valuePtr = &value;
+    Mso::DispatchTask task{[&value, valuePtr]() noexcept { value = (valuePtr == &value) ? 5 : -1; }};
+    TestCheck(task.IsInline());
+
+    Mso::DispatchTask movedTask{std::move(task)};
+    TestCheck(!task);
+    TestCheck(movedTask.IsInline());
+    movedTask.Get()->Invoke();
+    TestCheckEqual(5, value);
+  }
+
+  TEST_METHOD(DispatchTask_LargeLambdaIsNotInline)
+  {
+    std::array<int, 32> values{};
+    int sum = 0;
+    Mso::DispatchTask task{[values, &sum]() noexcept {
+      for (int value : values)
+      {
+        sum += value + 1;
+      }
+    }};
+    TestCheck(!task.IsInline());
+    task.Get()->Invoke();
+    TestCheckEqual(32, sum);
+  }
+
+  TEST_METHOD(DispatchTask_MoveOnlyCapture)
+  {
+    auto value = std::make_unique<int>(5);
+    int result = 0;
+    Mso::DispatchTask task{[value = std::move(value), &result]() noexcept { result = *value; }};
+    TestCheck(task.IsInline());
+
+    Mso::DispatchTask movedTask;
+    movedTask = std::move(task);
+    movedTask.Get()->Invoke();
+    TestCheckEqual(5, result);
+  }
+
+  TEST_METHOD(DispatchTask_InlineCaptureDestroyedOnce)
+  {
+    auto value = std::make_shared<int>(5);
+    {
+      Mso::DispatchTask task{[value]() noexcept {}};
+      TestCheck(task.IsInline());
+      TestCheckEqual(2, value.use_count());
+
+      Mso::DispatchTask movedTask{std::move(task)};
+      TestCheckEqual(2, value.use_count());
+    }
+
+    TestCheckEqual(1, value.use_count());
+  }
+
+  TEST_METHOD(DispatchTask_MakeDispatchTaskInlineCanceledOnce)
+  {
+    int invokeCount = 0;
+    int cancelCount = 0;
+    {
+      Mso::DispatchTask task = Mso::MakeDispatchTask(
+          [&invokeCount]() noexcept { ++invokeCount; }, [&cancelCount]() noexcept { ++cancelCount; });
+      TestCheck(task.IsInline());
+      TestCheck(query_cast<Mso::ICancellationListener*>(task.Get()) != nullptr);
+
+      Mso::DispatchTask movedTask{std::move(task)};
+      TestCheckEqual(0, cancelCount);
+    }
+
+    TestCheckEqual(0, invokeCount);
+    TestCheckEqual(1, cancelCount);
+  }
+
+  TEST_METHOD(DispatchTask_MakeDispatchTaskInlineOnCancel)
+  {
+    int cancelCount = 0;
+    {
+      Mso::DispatchTask task = Mso::MakeDispatchTask([]() noexcept {}, [&cancelCount]() noexcept { ++cancelCount; });
+      query_cast<Mso::ICancellationListener&>(*task.Get()).OnCancel();
+    }
+
+    TestCheckEqual(1, cancelCount);
+  }
+
+  TEST_METHOD(DispatchTask_DetachMovesInlineTaskToHeap)
+  {
+    int cancelCount = 0;
+    Mso::DispatchTask task = Mso::MakeDispatchTask([]() noexcept {}, [&cancelCount]() noexcept { ++cancelCount; });
+    TestCheck(task.IsInline());
+
+    Mso::DispatchTask heapTask{task.Detach(), Mso::AttachTag};
+    TestCheck(!task);
+    TestCheck(!heapTask.IsInline());
+    TestCheckEqual(0, cancelCount);
+
+    query_cast<Mso::ICancellationListener&>(*heapTask.Get()).OnCancel();
+    TestCheckEqual(1, cancelCount);
+    heapTask = nullptr;
+    TestCheckEqual(1, cancelCount);
+  }
+
+  TEST_METHOD(DispatchTask_DetachKeepsInvokedState)
+  {
+    // The inline task that was already invoked must not call onCancel after it is moved to the heap.
+    int invokeCount = 0;
+    int cancelCount = 0;
+    Mso::DispatchTask task = Mso::MakeDispatchTask(
+        [&invokeCount]() noexcept { ++invokeCount; }, [&cancelCount]() noexcept { ++cancelCount; });
+    TestCheck(task.IsInline());
+    task.Get()->Invoke();
+
+    Mso::DispatchTask heapTask{task.Detach(), Mso::AttachTag};
+    TestCheck(!heapTask.IsInline());
+    heapTask = nullptr;
+    TestCheckEqual(1, invokeCount);
+    TestCheckEqual(0, cancelCount);
+  }
+
+  TEST_METHOD(DispatchTask_ConvertToVoidFunctor)
+  {
+    int cancelCount = 0;
+    Mso::VoidFunctor functor = Mso::MakeDispatchTask([]() noexcept {}, [&cancelCount]() noexcept { ++cancelCount; });
+    query_cast<Mso::ICancellationListener&>(*functor.Get()).OnCancel();
+    TestCheckEqual(1, cancelCount);
+  }
+
+  TEST_METHOD(DispatchQueuePostInlineTasks)
+  {
+    auto queue = Mso::DispatchQueue::MakeConcurrentQueue(/*maxThreads:*/ 4);
+    std::atomic<int> invokeCount{0};
+    Mso::Promise<void> invoked;
+    for (int i = 0; i < 1000; ++i)
+    {
+      queue.Post(Mso::MakeDispatchTask(
+          [&invokeCount, invoked]() noexcept {
+            if (++invokeCount == 1000)
+            {
+              invoked.SetValue();
+            }
+          },
+          []() noexcept {}));
+    }
+
+    Mso::FutureWait(invoked.AsFuture());
+    TestCheckEqual(1000, invokeCount.load());
+  }
+
+  TEST_METHOD(DispatchQueueShouldYield_TimeExpired)
+  {
+    Mso::SetDispatchQueueTimeSlice(std::chrono::milliseconds{1});
+    auto queue = Mso::DispatchQueue::MakeSerialQueue();
+    auto future = Mso::PostFuture(queue, [queue]() noexcept {
+      Mso::TaskYieldReason yieldReason{Mso::TaskYieldReason::QueueShutdown};
+      auto timeout = std::chrono::steady_clock::now() + std::chrono::seconds{10};
+      while (!queue.ShouldYield(&yieldReason) && std::chrono::steady_clock::now() < timeout)
+      {
+        std::this_thread::yield();
+      }
+
+      return yieldReason;
+    });
+
+    TestCheck(Mso::TaskYieldReason::TimeExpired == Mso::FutureWaitAndGetValue(future));
+    Mso::SetDispatchQueueTimeSlice(std::chrono::milliseconds{100});
+  }
+
+  TEST_METHOD(DispatchQueueShouldYield_TimeNotExpired)
+  {
+    Mso::SetDispatchQueueTimeSlice(std::chrono::seconds{60});
+    auto queue = Mso::DispatchQueue::MakeSerialQueue();
+    auto future = Mso::PostFuture(queue, [queue]() noexcept { return queue.ShouldYield(); });
+
+    TestCheck(!Mso::FutureWaitAndGetValue(future));
+    TestCheck(!queue.ShouldYield()); // The time slice is not checked outside of the queue tasks.
+    Mso::SetDispatchQueueTimeSlice(std::chrono::milliseconds{100});
+  }
+
+  TEST_METHOD(DispatchQueueTimeSlice_QueueContinuesAfterExpiration)
+  {
+    Mso::SetDispatchQueueTimeSlice(std::chrono::milliseconds{1});
+    auto queue = Mso::DispatchQueue::MakeSerialQueue();
+    std::vector<int> invokeOrder;
+    for (int i = 0; i < 5; ++i)
+    {
+      queue.Post([&invokeOrder, i]() noexcept {
+        std::this_thread::sleep_for(std::chrono::milliseconds{2});
+        invokeOrder.push_back(i);
+      });
+    }
+
+    queue.Shutdown(Mso::PendingTaskAction::Complete);
+    queue.AwaitTermination();
+    TestCheckEqual(5u, invokeOrder.size());
+    for (int i = 0; i < 5; ++i)
+    {
+      TestCheckEqual(i, invokeOrder[i]);
+    }
+
+    Mso::SetDispatchQueueTimeSlice(std::chrono::milliseconds{100});
+  }
+
+  TEST_METHOD(DispatchQueueShouldYield_SuspendedAndShutdown)
+  {
+    auto queue = Mso::DispatchQueue::MakeSerialQueue();
+    Mso::IDispatchQueueService* queueService = *Mso::GetRawState(queue);
+    Mso::TaskYieldReason yieldReason{Mso::TaskYieldReason::TimeExpired};
+    TestCheck(!queue.ShouldYield(&yieldReason));
+
+    queueService->Suspend();
+    queueService->Suspend();
+    TestCheck(queue.ShouldYield(&yieldReason));
+    TestCheck(Mso::TaskYieldReason::QueueSuspended == yieldReason);
+
+    queueService->Resume();
+    TestCheck(queue.ShouldYield());
+    queueService->Resume();
+    TestCheck(!queue.ShouldYield());
+
+    queue.Shutdown(Mso::PendingTaskAction::Complete);
+    TestCheck(queue.ShouldYield(&yieldReason));
+    TestCheck(Mso::TaskYieldReason::QueueShutdown == yieldReason);
+  }
+
+  TEST_METHOD(DispatchQueueResume_UnbalancedCrashes)
+  {
+    auto queue = Mso::DispatchQueue::MakeSerialQueue();
+    Mso::IDispatchQueueService* queueService = *Mso::GetRawState(queue);
+    TestCheckCrash(queueService->Resume());
+
+    // The failed Resume does not change the queue state.
+    TestCheck(!queue.ShouldYield());
+    auto future = Mso::PostFuture(queue, []() noexcept { return 5; });
+    TestCheckEqual(5, Mso::FutureWaitAndGetValue(future));
+  }
+
+  TEST_METHOD(DispatchQueueSuspend_GuardSuspendsUntilDestroyed)
+  {
+    auto scheduler = Mso::Make<PostCountingScheduler>();
+    auto queue = Mso::DispatchQueue::MakeCustomQueue(Mso::CntPtr<Mso::IDispatchQueueScheduler>{scheduler});
+    int invokeCount{0};
+    {
+      Mso::DispatchSuspendGuard suspendGuard = queue.Suspend();
+      Mso::DispatchSuspendGuard suspendGuardCopy{suspendGuard};
+      queue.Post([&invokeCount]() noexcept { ++invokeCount; });
+      TestCheckEqual(0u, scheduler->InvokeAllTasks());
+    }
+
+    TestCheckEqual(1u, scheduler->InvokeAllTasks());
+    TestCheckEqual(1, invokeCount);
+  }
+
+  TEST_METHOD(ThreadPool_ManySerialQueuesInvokeOneAtATime)
+  {
+    // Serial queues share the pool workers, but each of them invokes its tasks one at a time.
+    constexpr size_t QueueCount{32};
+    constexpr int TasksPerQueue{200};
+    struct SerialQueueState
+    {
+      Mso::DispatchQueue Queue{Mso::DispatchQueue::MakeSerialQueue()};
+      std::atomic<int> RunningCount{0};
+      std::atomic<bool> IsOverlapped{false};
+      int InvokeCount{0};
+    };
+
+    std::vector<std::unique_ptr<SerialQueueState>> states;
+    for (size_t i = 0; i < QueueCount; ++i)
+    {
+      states.push_back(std::make_unique<SerialQueueState>());
+    }
+
+    for (int i = 0; i < TasksPerQueue; ++i)
+    {
+      for (auto& state : states)
+      {
+        state->Queue.Post([&state = *state]() noexcept {
+          if (++state.RunningCount > 1)
+          {
+            state.IsOverlapped = true;
+          }
+
+          ++state.InvokeCount;
+          std::this_thread::yield();
+          --state.RunningCount;
+        });
+      }
+    }
+
+    for (auto& state : states)
+    {
+      state->Queue.AwaitTermination();
+      TestCheck(!state->IsOverlapped);
+      TestCheckEqual(TasksPerQueue, state->InvokeCount);
+    }
+  }
+
+  TEST_METHOD(ThreadPool_ConcurrentQueueLimitsRunningTasks)
+  {
+    constexpr int MaxThreads{3};
+    constexpr int TaskCount{300};
+    auto queue = Mso::DispatchQueue::MakeConcurrentQueue(MaxThreads);
+    std::atomic<int> runningCount{0};
+    std::atomic<int> maxRunningCount{0};
+    std::atomic<int> invokeCount{0};
+    for (int i = 0; i < TaskCount; ++i)
+    {
+      queue.Post([&]() noexcept {
+        int count = ++runningCount;
+        int maxCount = maxRunningCount.load();
+        while (count > maxCount && !maxRunningCount.compare_exchange_weak(maxCount, count))
+        {
+        }
+
+        std::this_thread::sleep_for(std::chrono::microseconds{100});
+        --runningCount;
+        ++invokeCount;
+      });
+    }
+
+    queue.AwaitTermination();
+    TestCheckEqual(TaskCount, invokeCount.load());
+    TestCheck(maxRunningCount.load() <= MaxThreads);
+  }
+
+  TEST_METHOD(ThreadPoolIdlePolicy_SpinningWorkerPicksUpWork)
+  {
+    Mso::SetThreadPoolIdlePolicy(Mso::ThreadPoolIdlePolicy{/*SpinCount:*/ 1 << 22, /*YieldCount:*/ 0});
+    auto queue = Mso::DispatchQueue::MakeSerialQueue();
+    uint64_t spinWakeUpCount = Mso::GetThreadPoolIdleStats().SpinWakeUpCount;
+    for (int i = 0; i < 100 && Mso::GetThreadPoolIdleStats().SpinWakeUpCount == spinWakeUpCount; ++i)
+    {
+      // The worker that completed the task spins while we post the next one.
+      Mso::FutureWait(Mso::PostFuture(queue, []() noexcept {}));
+      std::this_thread::sleep_for(std::chrono::milliseconds{1});
+      Mso::FutureWait(Mso::PostFuture(queue, []() noexcept {}));
+    }
+
+    TestCheck(Mso::GetThreadPoolIdleStats().SpinWakeUpCount > spinWakeUpCount);
+    Mso::SetThreadPoolIdlePolicy(Mso::ThreadPoolIdlePolicy{});
+  }
+
+  TEST_METHOD(ThreadPoolIdlePolicy_NoSpinningParksWorker)
+  {
+    Mso::SetThreadPoolIdlePolicy(Mso::ThreadPoolIdlePolicy{/*SpinCount:*/ 0, /*YieldCount:*/ 0});
+    auto queue = Mso::DispatchQueue::MakeSerialQueue();
+    Mso::ThreadPoolIdleStats stats = Mso::GetThreadPoolIdleStats();
+    for (int i = 0; i < 100 && Mso::GetThreadPoolIdleStats().ParkCount == stats.ParkCount; ++i)
+    {
+      Mso::FutureWait(Mso::PostFuture(queue, []() noexcept {}));
+      std::this_thread::sleep_for(std::chrono::milliseconds{1});
+    }
+
+    Mso::ThreadPoolIdleStats newStats = Mso::GetThreadPoolIdleStats();
+    TestCheck(newStats.ParkCount > stats.ParkCount);
+    Mso::SetThreadPoolIdlePolicy(Mso::ThreadPoolIdlePolicy{});
+  }
+
+  TEST_METHOD(ThreadPoolConfig_IdleWorkerRetires)
+  {
+    Mso::SetThreadPoolIdlePolicy(Mso::ThreadPoolIdlePolicy{/*SpinCount:*/ 0, /*YieldCount:*/ 0});
+    Mso::ThreadPoolConfig config;
+    config.IdleTimeout = std::chrono::milliseconds{10};
+    Mso::SetThreadPoolConfig(config);
+
+    auto queue = Mso::DispatchQueue::MakeSerialQueue();
+    uint64_t retireCount = Mso::GetThreadPoolIdleStats().RetireCount;
+    for (int i = 0; i < 100 && Mso::GetThreadPoolIdleStats().RetireCount == retireCount; ++i)
+    {
+      Mso::FutureWait(Mso::PostFuture(queue, []() noexcept {}));
+      std::this_thread::sleep_for(std::chrono::milliseconds{20});
+    }
+
+    TestCheck(Mso::GetThreadPoolIdleStats().RetireCount > retireCount);
+
+    // The pool starts new workers after the idle workers exit.
+    TestCheckEqual(5, Mso::FutureWaitAndGetValue(Mso::PostFuture(queue, []() noexcept { return 5; })));
+
+    Mso::SetThreadPoolConfig(Mso::ThreadPoolConfig{});
+    Mso::SetThreadPoolIdlePolicy(Mso::ThreadPoolIdlePolicy{});
+  }
+
+  TEST_METHOD(ThreadPoolConfig_MinThreadCountAboveMaxCrashes)
+  {
+    Mso::ThreadPoolConfig config;
+    config.MinThreadCount = 4;
+    config.MaxThreadCount = 2;
+    TestCheckCrash(Mso::SetThreadPoolConfig(config));
+  }
+
+  TEST_METHOD(ThreadPoolController_AdjustsTargetThreadCount)
+  {
+    Mso::ThreadPoolConfig config;
+    config.UseThreadCountController = true;
+    config.ControllerInterval = std::chrono::milliseconds{5};
+    Mso::SetThreadPoolConfig(config);
+    Mso::ThreadPoolControllerState state = Mso::GetThreadPoolControllerState();
+    TestCheck(state.IsEnabled);
+
+    // Tasks that sleep keep the work items waiting for workers, and the controller adds threads to finish them faster.
+    // The pool may have idle workers left from other tests. Thus, we repeat until the work items have to wait.
+    auto queue = Mso::DispatchQueue::MakeConcurrentQueue(0);
+    for (int i = 0; i < 20 && Mso::GetThreadPoolControllerState().AdjustmentCount == state.AdjustmentCount; ++i)
+    {
+      std::vector<Mso::Future<void>> futures;
+      for (int j = 0; j < 200; ++j)
+      {
+        futures.push_back(Mso::PostFuture(
+            queue, []() noexcept { std::this_thread::sleep_for(std::chrono::milliseconds{1}); }));
+      }
+
+      for (auto& future : futures)
+      {
+        Mso::FutureWait(future);
+      }
+    }
+
+    Mso::ThreadPoolControllerState newState = Mso::GetThreadPoolControllerState();
+    TestCheck(newState.AdjustmentCount > state.AdjustmentCount);
+    TestCheck(newState.TargetThreadCount >= 2);
+
+    Mso::SetThreadPoolConfig(Mso::ThreadPoolConfig{});
+    TestCheck(!Mso::GetThreadPoolControllerState().IsEnabled);
+  }
+
+  TEST_METHOD(DispatchBlockingScope_CompensatesBlockedWorkers)
+  {
+    // Block more workers than the target thread count. The pool starts new workers for the pending blocked tasks.
+    const uint32_t taskCount = Mso::GetThreadPoolControllerState().TargetThreadCount + 2;
+    auto queue = Mso::DispatchQueue::MakeConcurrentQueue(0);
+    std::atomic<uint32_t> enteredCount{0};
+    Mso::ManualResetEvent allEntered;
+    Mso::ManualResetEvent release;
+    std::vector<Mso::Future<void>> futures;
+    for (uint32_t i = 0; i < taskCount; ++i)
+    {
+      futures.push_back(Mso::PostFuture(queue, [&enteredCount, taskCount, allEntered, release]() noexcept {
+        Mso::DispatchBlockingScope blockingScope;
+        if (++enteredCount == taskCount)
+        {
+          allEntered.Set();
+        }
+
+        release.Wait();
+      }));
+    }
+
+    allEntered.Wait();
+    Mso::ThreadPoolControllerState state = Mso::GetThreadPoolControllerState();
+    TestCheckEqual(taskCount, state.BlockedThreadCount);
+    TestCheck(state.ThreadCount >= taskCount);
+
+    release.Set();
+    for (auto& future : futures)
+    {
+      Mso::FutureWait(future);
+    }
+
+    TestCheckEqual(0u, Mso::GetThreadPoolControllerState().BlockedThreadCount);
+  }
+
+  TEST_METHOD(DispatchBlockingScope_NoEffectOutsideOfWorker)
+  {
+    uint32_t blockedThreadCount = Mso::GetThreadPoolControllerState().BlockedThreadCount;
+    {
+      Mso::DispatchBlockingScope blockingScope;
+      Mso::DispatchBlockingScope nestedBlockingScope;
+      TestCheckEqual(blockedThreadCount, Mso::GetThreadPoolControllerState().BlockedThreadCount);
+    }
+
+    TestCheckEqual(blockedThreadCount, Mso::GetThreadPoolControllerState().BlockedThreadCount);
+  }
+
+  TEST_METHOD(EndDispatchBlocking_UnbalancedCrashes)
+  {
+    TestCheckCrash(Mso::EndDispatchBlocking());
+  }
+
+  TEST_METHOD(GetAvailableProcessorCount_NotAboveHardwareConcurrency)
+  {
+    uint32_t processorCount = Mso::GetAvailableProcessorCount();
+    TestCheck(processorCount >= 1);
+    TestCheck(processorCount <= std::max(std::thread::hardware_concurrency(), 1u));
+  }
 };
 
 } // namespace FutureTests
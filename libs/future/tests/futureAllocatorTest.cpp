@@ -0,0 +1,54 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include <array>
+#include <thread>
+#include "future/future.h"
+#include "future/futureWait.h"
+#include "motifCpp/libletAwareMemLeakDetection.h"
+#include "testCheck.h"
+
+namespace FutureTests {
+
+TEST_CLASS_EX (FutureAllocatorTest, LibletAwareMemLeakDetection)
+{
+  TEST_METHOD(FutureAllocator_ReusesBlocksInThread)
+  {
+    constexpr uint64_t iterationCount = 100;
+    auto before = Mso::Futures::GetFutureAllocatorStats();
+    for (uint64_t i = 0; i < iterationCount; ++i)
+    {
+      Mso::Promise<int> p1;
+      auto f1 = p1.AsFuture().Then<Mso::Executors::Inline>([](int value) noexcept { return value + 1; });
+      p1.SetValue(5);
+      TestCheckEqual(6, Mso::FutureWaitAndGetValue(f1));
+    }
+
+    auto after = Mso::Futures::GetFutureAllocatorStats();
+    TestCheck(after.AllocationCount - before.AllocationCount >= 2 * iterationCount);
+
+    // Only the first iteration may need to take blocks from the central free list or the heap.
+    TestCheck(after.ThreadCacheHitCount - before.ThreadCacheHitCount >= 2 * (iterationCount - 1));
+  }
+
+  TEST_METHOD(FutureAllocator_CrossThreadFree)
+  {
+    auto before = Mso::Futures::GetFutureAllocatorStats();
+    auto f1 = Mso::MakeCompletedFuture(5);
+    std::thread([f1 = std::move(f1)]() mutable noexcept { f1 = nullptr; }).join();
+
+    auto after = Mso::Futures::GetFutureAllocatorStats();
+    TestCheck(after.CrossThreadFreeCount - before.CrossThreadFreeCount >= 1);
+  }
+
+  TEST_METHOD(FutureAllocator_LargeTask)
+  {
+    // Futures with a big task are allocated directly from the heap.
+    std::array<uint8_t, 1024> data{};
+    data[0] = 42;
+    auto f1 = Mso::MakeCompletedFuture().Then<Mso::Executors::Inline>([data]() noexcept { return data[0]; });
+    TestCheckEqual(42, Mso::FutureWaitAndGetValue(f1));
+  }
+};
+
+} // namespace FutureTests
@@ -0,0 +1,139 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include <stdexcept>
+#include "eventWaitHandle/eventWaitHandle.h"
+#include "future/future.h"
+#include "future/futureWait.h"
+#include "motifCpp/libletAwareMemLeakDetection.h"
+#include "testCheck.h"
+
+#if MSO_HAS_COROUTINES
+
+namespace FutureTests {
+
+static Mso::Future<int> AddAsync(Mso::Future<int> left, Mso::Future<int> right) noexcept
+{
+  int leftValue = co_await left;
+  int rightValue = co_await right;
+  co_return leftValue + rightValue;
+}
+
+static Mso::Future<void> SetFlagAsync(Mso::Future<void> trigger, bool& flag) noexcept
+{
+  co_await trigger;
+  flag = true;
+}
+
+static Mso::Future<int> ThrowAsync() noexcept
+{
+  co_await Mso::MakeCompletedFuture();
+  throw std::runtime_error("Test");
+}
+
+static Mso::Future<int> AddSharedAsync(Mso::SharedFuture<int> value) noexcept
+{
+  const int& first = co_await value;
+  const int& second = co_await value;
+  co_return first + second;
+}
+
+static Mso::Future<bool> RunInQueueAsync(Mso::DispatchQueue queue) noexcept
+{
+  co_await queue;
+  co_return queue.HasThreadAccess();
+}
+
+TEST_CLASS_EX (FutureCoroutineTest, LibletAwareMemLeakDetection)
+{
+  ~FutureCoroutineTest() noexcept
+  {
+    Mso::UnitTest_UninitConcurrentQueue();
+  }
+
+  TEST_METHOD(Coroutine_AwaitCompleted)
+  {
+    auto future = AddAsync(Mso::MakeCompletedFuture(1), Mso::MakeCompletedFuture(2));
+    TestCheckEqual(3, Mso::FutureWaitAndGetValue(future));
+  }
+
+  TEST_METHOD(Coroutine_AwaitPending)
+  {
+    Mso::Promise<int> p1;
+    Mso::Promise<int> p2;
+    auto future = AddAsync(p1.AsFuture(), p2.AsFuture());
+    p2.SetValue(5);
+    p1.SetValue(3);
+    TestCheckEqual(8, Mso::FutureWaitAndGetValue(future));
+  }
+
+  TEST_METHOD(Coroutine_AwaitPosted)
+  {
+    auto future = AddAsync(
+        Mso::PostFuture([]() noexcept { return 4; }), Mso::PostFuture([]() noexcept { return 6; }));
+    TestCheckEqual(10, Mso::FutureWaitAndGetValue(future));
+  }
+
+  TEST_METHOD(Coroutine_Void)
+  {
+    Mso::Promise<void> p1;
+    bool isSet = false;
+    auto future = SetFlagAsync(p1.AsFuture(), isSet);
+    TestCheck(!isSet);
+    p1.SetValue();
+    TestCheck(Mso::FutureWaitIsSucceeded(future));
+    TestCheck(isSet);
+  }
+
+  TEST_METHOD(Coroutine_AwaitFailed)
+  {
+    auto future = AddAsync(
+        Mso::MakeCompletedFuture(1),
+        Mso::MakeFailedFuture<int>(Mso::CancellationErrorProvider().MakeErrorCode(true)));
+    TestCheck(Mso::CancellationErrorProvider().IsOwnedErrorCode(Mso::FutureWaitAndGetError(future)));
+  }
+
+  TEST_METHOD(Coroutine_Exception)
+  {
+    auto future = ThrowAsync();
+    TestCheck(Mso::ExceptionErrorProvider().IsOwnedErrorCode(Mso::FutureWaitAndGetError(future)));
+  }
+
+  TEST_METHOD(Coroutine_AwaitShared)
+  {
+    Mso::Promise<int> p1;
+    auto future = AddSharedAsync(p1.AsFuture().Share());
+    p1.SetValue(21);
+    TestCheckEqual(42, Mso::FutureWaitAndGetValue(future));
+  }
+
+  TEST_METHOD(Coroutine_SwitchToQueue)
+  {
+    auto queue = Mso::DispatchQueue::MakeSerialQueue();
+    TestCheck(Mso::FutureWaitAndGetValue(RunInQueueAsync(queue)));
+  }
+
+  TEST_METHOD(Coroutine_CanceledOnQueueShutdown)
+  {
+    // Block the queue to keep the coroutine resume task pending until the queue shutdown cancels it.
+    auto queue = Mso::DispatchQueue::MakeSerialQueue();
+    Mso::ManualResetEvent started;
+    Mso::ManualResetEvent unblock;
+    queue.Post([started, unblock]() noexcept {
+      started.Set();
+      unblock.Wait();
+    });
+    started.Wait();
+
+    auto future = RunInQueueAsync(queue);
+    queue.Shutdown(Mso::PendingTaskAction::Cancel);
+    unblock.Set();
+
+    TestCheck(Mso::CancellationErrorProvider().IsOwnedErrorCode(Mso::FutureWaitAndGetError(future)));
+    queue.AwaitTermination();
+  }
+};
+
+} // namespace FutureTests
+
+#endif // MSO_HAS_COROUTINES
@@ -2,6 +2,7 @@
 // Licensed under the MIT license.
 
 #include "dispatchQueue/dispatchQueue.h"
+#include "eventWaitHandle/eventWaitHandle.h"
 #include "future/cancellationToken.h"
 #include "future/future.h"
 #include "future/futureWait.h"
@@ -132,12 +133,11 @@ TEST_CLASS_EX (FutureFuncTest, LibletAwareMemLeakDetection)
     TestCheckEqual(4u, result.size());
     TestCheckEqual(2, result[1]);
   }
-// TODO: implement Mso::PotsTimer and Mso::WhenDoneOrTimeout
-#if 0
-  TEST_METHOD(WhenDoneOrTimeout_TimeOut_int) {
-    Mso::ManualResetEvent finished;
 
-    auto future = Mso::PostFuture([&finished]() noexcept {
+  TEST_METHOD(WhenDoneOrTimeout_TimeOut_int)
+  {
+    Mso::ManualResetEvent finished;
+    auto future = Mso::PostFuture([finished]() noexcept {
       finished.Wait();
       return 3;
     });
@@ -149,174 +149,116 @@ TEST_CLASS_EX (FutureFuncTest, LibletAwareMemLeakDetection)
     TestCheck(result.GetError().As(Mso::Async::TimeoutError()));
   }
 
-	TEST_METHOD(WhenDoneOrTimeout_NoTimeOut_int)
-	{
-		auto future = Mso::PostFuture([]() noexcept
-		{
-			return 3;
-		});
-
-		auto result = Mso::FutureWait(Mso::WhenDoneOrTimeout(future, std::chrono::milliseconds(100)));
-		TestCheckEqual(3, result.GetValue());
-
-		// Wait for timer to finish to make sure that unit test does not show memory leak
-		Mso::Promise<void> timerPromise;
-		Mso::Async::PostTimer(120, [timerPromise]() noexcept
-		{
-			timerPromise.SetValue();
-		});
-		Mso::FutureWait(timerPromise.AsFuture());
-	}
-
-	TEST_METHOD(WhenDoneOrTimeout_Shutdown_int)
-	{
-		// This test applies only to win32!
-		if (!Mso::Async::IsBlockingShutdown())
-			return;
-
-		Mso::Promise<int> promise;
-		auto futureWithTimeout = Mso::WhenDoneOrTimeout(promise.AsFuture(), std::chrono::seconds(10));
-
-		RestartLiblets();
-
-		auto result = Mso::FutureWait(futureWithTimeout);
-		TestCheck(result.IsError());
-		TestCheck(Mso::CancellationErrorProvider().IsOwnedErrorCode(result.GetError()));
-
-		promise.SetValue(3);
-	}
-
-	TEST_METHOD(WhenDoneOrTimeout_TimeOut_void)
-	{
-		Mso::ManualResetEvent finished;
-		Mso::ManualResetEvent futureCompleted;
-		int value = 0;
-		auto future = Mso::PostFuture([&finished, &futureCompleted, &value]() noexcept
-		{
-			finished.Wait();
-			value = 3;
-			futureCompleted.Set();
-		});
-
-		auto result = Mso::FutureWait(Mso::WhenDoneOrTimeout(future, std::chrono::milliseconds(20)));
-		finished.Set();
-
-		TestCheck(result.IsError());
-		TestCheck(result.GetError().As(Mso::Async::TimeoutError()));
-		futureCompleted.Wait();
-	}
-
-	TEST_METHOD(WhenDoneOrTimeout_NoTimeOut_void)
-	{
-		int value = 0;
-		auto future = Mso::PostFuture([&value]() noexcept
-		{
-			value = 3;
-		});
-
-		Mso::FutureWait(Mso::WhenDoneOrTimeout(future, std::chrono::milliseconds(100)));
-		TestCheckEqual(3, value);
-
-		// Wait for timer to finish to make sure that unit test does not show memory leak
-		Mso::Promise<void> timerPromise;
-		Mso::Async::PostTimer(120, [timerPromise]() noexcept
-		{
-			timerPromise.SetValue();
-		});
-		Mso::FutureWait(timerPromise.AsFuture());
-	}
-
-	TEST_METHOD(WhenDoneOrTimeout_Shutdown_void)
-	{
-		// This test applies only to win32!
-		if (!Mso::Async::IsBlockingShutdown())
-			return;
-
-		Mso::Promise<void> promise;
-		auto futureWithTimeout = Mso::WhenDoneOrTimeout(promise.AsFuture(), std::chrono::seconds(10));
-
-		RestartLiblets();
-
-		auto result = Mso::FutureWait(futureWithTimeout);
-		TestCheck(result.IsError());
-		TestCheck(Mso::CancellationErrorProvider().IsOwnedErrorCode(result.GetError()));
-
-		promise.SetValue();
-	}
-
-	TEST_METHOD(WhenDoneOrTimeout_TimeOut_Maybe)
-	{
-		Mso::HandleHolder finished = CreateEvent(nullptr, false, false, nullptr);
-		auto future = Mso::PostFuture([&finished]() noexcept
-		{
-			WaitForSingleObject(finished, INFINITE);
-			return Mso::Maybe<int>(3);
-		});
-
-		auto result = Mso::FutureWait(Mso::WhenDoneOrTimeout(future, std::chrono::milliseconds(20)));
-		SetEvent(finished);
-
-		TestCheck(result.IsError());
-		TestCheck(result.GetError().As(Mso::Async::TimeoutError()));
-	}
-
-	TEST_METHOD(WhenDoneOrTimeout_NoTimeOut_Maybe)
-	{
-		auto future = Mso::PostFuture([]() noexcept
-		{
-			return Mso::Maybe<int>(3);
-		});
-
-		auto result = Mso::FutureWait(Mso::WhenDoneOrTimeout(future, std::chrono::milliseconds(100)));
-		TestCheckEqual(3, result.GetValue());
-
-		// Wait for timer to finish to make sure that unit test does not show memory leak
-		Mso::Promise<void> timerPromise;
-		Mso::Async::PostTimer(120, [timerPromise]() noexcept
-		{
-			timerPromise.SetValue();
-		});
-		Mso::FutureWait(timerPromise.AsFuture());
-	}
-
-	TEST_METHOD(WhenDoneOrTimeout_NoTimeOut_Maybe_Error)
-	{
-		auto future = Mso::PostFuture([]() noexcept
-		{
-			return Mso::CancellationErrorProvider().MakeMaybe<int>();
-		});
-
-		auto result = Mso::FutureWait(Mso::WhenDoneOrTimeout(future, std::chrono::milliseconds(100)));
-		TestCheck(result.IsError());
-		TestCheck(Mso::CancellationErrorProvider().IsOwnedErrorCode(result.GetError()));
-
-		// Wait for timer to finish to make sure that unit test does not show memory leak
-		Mso::Promise<void> timerPromise;
-		Mso::Async::PostTimer(120, [timerPromise]() noexcept
-		{
-			timerPromise.SetValue();
-		});
-		Mso::FutureWait(timerPromise.AsFuture());
-	}
-
-	TEST_METHOD(WhenDoneOrTimeout_Shutdown_Maybe)
-	{
-		// This test applies only to win32!
-		if (!Mso::Async::IsBlockingShutdown())
-			return;
-
-		Mso::Promise<int> promise;
-		auto futureWithTimeout = Mso::WhenDoneOrTimeout(promise.AsFuture(), std::chrono::seconds(10));
-
-		RestartLiblets();
-
-		auto result = Mso::FutureWait(futureWithTimeout);
-		TestCheck(result.IsError());
-		TestCheck(Mso::CancellationErrorProvider().IsOwnedErrorCode(result.GetError()));
-
-		promise.SetValue(3);
-	}
-#endif
+  TEST_METHOD(WhenDoneOrTimeout_NoTimeOut_int)
+  {
+    auto future = Mso::PostFuture([]() noexcept { return 3; });
+
+    // The timer is canceled when the future completes. We do not need to wait for the timeout.
+    auto result = Mso::FutureWait(Mso::WhenDoneOrTimeout(future, std::chrono::seconds(10)));
+    TestCheckEqual(3, result.GetValue());
+  }
+
+  TEST_METHOD(WhenDoneOrTimeout_Shutdown_int)
+  {
+    Mso::Promise<int> promise;
+    auto futureWithTimeout = Mso::WhenDoneOrTimeout(promise.AsFuture(), std::chrono::seconds(10));
+
+    Mso::UnitTest_UninitConcurrentQueue();
+
+    auto result = Mso::FutureWait(futureWithTimeout);
+    TestCheck(result.IsError());
+    TestCheck(Mso::CancellationErrorProvider().IsOwnedErrorCode(result.GetError()));
+
+    promise.SetValue(3);
+  }
+
+  TEST_METHOD(WhenDoneOrTimeout_TimeOut_void)
+  {
+    Mso::ManualResetEvent finished;
+    Mso::ManualResetEvent futureCompleted;
+    int value = 0;
+    auto future = Mso::PostFuture([finished, futureCompleted, &value]() noexcept {
+      finished.Wait();
+      value = 3;
+      futureCompleted.Set();
+    });
+
+    auto result = Mso::FutureWait(Mso::WhenDoneOrTimeout(future, std::chrono::milliseconds(20)));
+    finished.Set();
+
+    TestCheck(result.IsError());
+    TestCheck(result.GetError().As(Mso::Async::TimeoutError()));
+    futureCompleted.Wait();
+  }
+
+  TEST_METHOD(WhenDoneOrTimeout_NoTimeOut_void)
+  {
+    int value = 0;
+    auto future = Mso::PostFuture([&value]() noexcept { value = 3; });
+
+    Mso::FutureWait(Mso::WhenDoneOrTimeout(future, std::chrono::seconds(10)));
+    TestCheckEqual(3, value);
+  }
+
+  TEST_METHOD(WhenDoneOrTimeout_Shutdown_void)
+  {
+    Mso::Promise<void> promise;
+    auto futureWithTimeout = Mso::WhenDoneOrTimeout(promise.AsFuture(), std::chrono::seconds(10));
+
+    Mso::UnitTest_UninitConcurrentQueue();
+
+    auto result = Mso::FutureWait(futureWithTimeout);
+    TestCheck(result.IsError());
+    TestCheck(Mso::CancellationErrorProvider().IsOwnedErrorCode(result.GetError()));
+
+    promise.SetValue();
+  }
+
+  TEST_METHOD(WhenDoneOrTimeout_TimeOut_Maybe)
+  {
+    Mso::ManualResetEvent finished;
+    auto future = Mso::PostFuture([finished]() noexcept {
+      finished.Wait();
+      return Mso::Maybe<int>(3);
+    });
+
+    auto result = Mso::FutureWait(Mso::WhenDoneOrTimeout(future, std::chrono::milliseconds(20)));
+    finished.Set();
+
+    TestCheck(result.IsError());
+    TestCheck(result.GetError().As(Mso::Async::TimeoutError()));
+  }
+
+  TEST_METHOD(WhenDoneOrTimeout_NoTimeOut_Maybe)
+  {
+    auto future = Mso::PostFuture([]() noexcept { return Mso::Maybe<int>(3); });
+
+    auto result = Mso::FutureWait(Mso::WhenDoneOrTimeout(future, std::chrono::seconds(10)));
+    TestCheckEqual(3, result.GetValue());
+  }
+
+  TEST_METHOD(WhenDoneOrTimeout_NoTimeOut_Maybe_Error)
+  {
+    auto future = Mso::PostFuture([]() noexcept { return Mso::CancellationErrorProvider().MakeMaybe<int>(); });
+
+    auto result = Mso::FutureWait(Mso::WhenDoneOrTimeout(future, std::chrono::seconds(10)));
+    TestCheck(result.IsError());
+    TestCheck(Mso::CancellationErrorProvider().IsOwnedErrorCode(result.GetError()));
+  }
+
+  TEST_METHOD(WhenDoneOrTimeout_Shutdown_Maybe)
+  {
+    Mso::Promise<int> promise;
+    auto futureWithTimeout = Mso::WhenDoneOrTimeout(promise.AsFuture(), std::chrono::seconds(10));
+
+    Mso::UnitTest_UninitConcurrentQueue();
+
+    auto result = Mso::FutureWait(futureWithTimeout);
+    TestCheck(result.IsError());
+    TestCheck(Mso::CancellationErrorProvider().IsOwnedErrorCode(result.GetError()));
+
+    promise.SetValue(3);
+  }
 };
 
 } // namespace FutureTests
@@ -150,6 +150,38 @@ TEST_CLASS_EX (WhenAllTest, LibletAwareMemLeakDetection)
     TestCheck(Mso::CancellationErrorProvider().IsOwnedErrorCode(Mso::FutureWaitAndGetError(fr)));
   }
 
+  TEST_METHOD(WhenAll_Vector_Many)
+  {
+    // Parent futures complete in the reverse order to check that each one finds its own slot.
+    constexpr int futureCount = 10000;
+    std::vector<Mso::Promise<int>> promises(futureCount);
+    std::vector<Mso::Future<int>> futures;
+    futures.reserve(futureCount);
+    for (auto& promise : promises)
+    {
+      futures.push_back(promise.AsFuture());
+    }
+
+    auto fr = Mso::WhenAll(futures).Then([](Mso::Async::ArrayView<int> r) noexcept {
+      for (size_t i = 0; i < r.Size(); ++i)
+      {
+        if (r[i] != static_cast<int>(i))
+        {
+          return false;
+        }
+      }
+
+      return r.Size() == futureCount;
+    });
+
+    for (int i = futureCount - 1; i >= 0; --i)
+    {
+      promises[i].SetValue(i);
+    }
+
+    TestCheck(Mso::FutureWaitAndGetValue(fr));
+  }
+
   TEST_METHOD(WhenAll_Init_Void_Three)
   {
     struct State
@@ -280,6 +312,27 @@ TEST_CLASS_EX (WhenAllTest, LibletAwareMemLeakDetection)
     TestCheck(Mso::CancellationErrorProvider().IsOwnedErrorCode(Mso::FutureWaitAndGetError(fr)));
   }
 
+  TEST_METHOD(WhenAll_Vector_Void_Many)
+  {
+    constexpr int futureCount = 10000;
+    std::vector<Mso::Promise<void>> promises(futureCount);
+    std::vector<Mso::Future<void>> futures;
+    futures.reserve(futureCount);
+    for (auto& promise : promises)
+    {
+      futures.push_back(promise.AsFuture());
+    }
+
+    auto fr = Mso::WhenAll(futures).Then([]() noexcept { return 42; });
+
+    for (int i = futureCount - 1; i >= 0; --i)
+    {
+      promises[i].SetValue();
+    }
+
+    TestCheckEqual(42, Mso::FutureWaitAndGetValue(fr));
+  }
+
   TEST_METHOD(WhenAll_Tuple_Three)
   {
     auto f1 = Mso::PostFuture([]() noexcept { return 47; });
@@ -40,7 +40,7 @@ public:
   TOwnerPtr() noexcept {}
   /*explicit*/ TOwnerPtr(T* pT) noexcept : Super(pT) {}
   IMPLEMENT_THOLDER_OPERATOR_EQUALS(TOwnerPtr<T>)
-  IMPLEMENT_THOLDER_RVALUE_REFS(TOwnerPtr<T>);
+  IMPLEMENT_THOLDER_RVALUE_REFS(TOwnerPtr);
 
   T* get() noexcept
   {
@@ -60,7 +60,7 @@ public:
   }
 
 private:
-  MSO_NO_COPY_CTOR_AND_ASSIGNMENT(TOwnerPtr<T>);
+  MSO_NO_COPY_CTOR_AND_ASSIGNMENT(TOwnerPtr);
 };
 
 /**
@@ -38,7 +38,7 @@ struct SymbolSpace
 template <>
 struct SymbolSpace<char>
 {
-  SymbolSpace<char>() noexcept {};
+  SymbolSpace() noexcept {};
   SymbolSpace<char>& operator=(const SymbolSpace<char>&) = delete;
 
   const char lowAlpha = 'a';
@@ -52,7 +52,7 @@ struct SymbolSpace<char>
 template <>
 struct SymbolSpace<wchar_t>
 {
-  SymbolSpace<wchar_t>() noexcept {};
+  SymbolSpace() noexcept {};
   SymbolSpace<wchar_t>& operator=(const SymbolSpace<wchar_t>&) = delete;
 
   const wchar_t lowAlpha = L'a';
@@ -66,7 +66,7 @@ struct SymbolSpace<wchar_t>
 template <>
 struct SymbolSpace<char16_t>
 {
-  SymbolSpace<char16_t>() noexcept {};
+  SymbolSpace() noexcept {};
   SymbolSpace<char16_t>& operator=(const SymbolSpace<char16_t>&) = delete;
 
   const char16_t lowAlpha = u'a';
@@ -80,7 +80,7 @@ struct SymbolSpace<char16_t>
 template <>
 struct SymbolSpace<char32_t>
 {
-  SymbolSpace<char32_t>() noexcept {};
+  SymbolSpace() noexcept {};
   SymbolSpace<char32_t>& operator=(const SymbolSpace<char32_t>&) = delete;
 
   const char32_t lowAlpha = U'a';
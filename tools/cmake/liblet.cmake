@@ -30,12 +30,19 @@ message(STATUS "Enable testing: ${MSO_ENABLE_UNIT_TESTS}")
 option(MSO_ENABLE_INCLUDES_CHECKS "Enable checking of include files" ON)
 message(STATUS "Enable includes checks: ${MSO_ENABLE_INCLUDES_CHECKS}")
 
+# Performance benchmarks are not run as a part of the regular build.
+# Enable them to compare performance between changes.
+option(MSO_ENABLE_BENCHMARKS "Enable performance benchmarks" OFF)
+message(STATUS "Enable benchmarks: ${MSO_ENABLE_BENCHMARKS}")
+
 ###########################################
 # Compiler settings
 ###########################################
 
-# require C++14
-set(CMAKE_CXX_STANDARD 17)
+# require C++17. Builds can opt in to a newer standard, e.g. -DCMAKE_CXX_STANDARD=20 enables coroutine support.
+if(NOT CMAKE_CXX_STANDARD)
+  set(CMAKE_CXX_STANDARD 17)
+endif()
 #set(CMAKE_CXX_EXTENSIONS OFF)
 #set(CMAKE_CXX_STANDARD_REQUIRED ON)
 
@@ -92,6 +99,11 @@ function(liblet LIBLET_TARGET)
     add_subdirectory(tests)
   endif()
 
+  # Process benchmark files if benchmarks/CMakeLists.txt exists and benchmarks are enabled
+  if(MSO_ENABLE_BENCHMARKS AND EXISTS "${CMAKE_CURRENT_SOURCE_DIR}/benchmarks/CMakeLists.txt")
+    add_subdirectory(benchmarks)
+  endif()
+
   # Install target
   install(
     TARGETS ${LIBLET_TARGET}
@@ -218,6 +230,44 @@ function(liblet_tests)
   endif()
 endfunction()
 
+function(liblet_benchmarks)
+  # SOURCES         - benchmark sources for all platforms
+  # SOURCES_ANDROID - benchmark sources for Android
+  # SOURCES_APPLE   - benchmark sources for Apple platforms (macOS or iOS)
+  # SOURCES_IOS     - benchmark sources for iOS
+  # SOURCES_LINUX   - benchmark sources for Linux
+  # SOURCES_MAC     - benchmark sources for macOS
+  # SOURCES_POSIX   - benchmark sources for Android and Apple platforms
+  # SOURCES_WIN     - benchmark sources for all Windows platforms
+  # SOURCES_WIN32   - benchmark sources for Win32
+  # SOURCES_WINRT   - benchmark sources for WinRT
+  # DEPENDS         - additional dependencies for all platforms
+  # DEPENDS_ANDROID - additional dependencies for Android
+  # DEPENDS_APPLE   - additional dependencies for Apple platforms (macOS or iOS)
+  # DEPENDS_IOS     - additional dependencies for iOS
+  # DEPENDS_LINUX   - additional dependencies for Linux
+  # DEPENDS_MAC     - additional dependencies for macOS
+  # DEPENDS_POSIX   - additional dependencies for Android and Apple platforms
+  # DEPENDS_WIN     - additional dependencies for all Windows platforms
+  # DEPENDS_WIN32   - additional dependencies for Win32
+  # DEPENDS_WINRT   - additional dependencies for WinRT
+  set(LIBLET_BENCHMARKS_TARGET ${LIBLET_TARGET}_benchmarks)
+
+  _liblet_platform_args(${LIBLET_BENCHMARKS_TARGET} "SOURCES;DEPENDS" ${ARGN})
+
+  # Benchmarks are standalone executables. They are not registered with CTest
+  # because their run time and results depend on the machine they run on.
+  add_executable(${LIBLET_BENCHMARKS_TARGET} ${${LIBLET_BENCHMARKS_TARGET}_SOURCES})
+
+  _liblet_set_platform_definitions(${LIBLET_BENCHMARKS_TARGET})
+
+  target_link_libraries(${LIBLET_BENCHMARKS_TARGET}
+    PRIVATE
+      Mso::${LIBLET_TARGET}
+      ${${LIBLET_BENCHMARKS_TARGET}_DEPENDS}
+  )
+endfunction()
+
 function(_liblet_platform_args RESULT_PREFIX ARG_PREFIXES)
   set(ARG_KEYWORDS ${ARG_PREFIXES})
   foreach(ARG_PREFIX ${ARG_PREFIXES})